@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// Minimal benchmark harness. Run() times `fn` over `iIterations` calls a few times and prints the fastest pass,
+// per call, so one noisy pass doesn't skew the number. Numbers are meant to be compared between commits on one machine.
+namespace Bench
+{
+    // Keeps the compiler from optimising away a result
+    template<typename T>
+    inline void Keep(const T& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const T* sink;
+        sink = &value;
+#endif
+    }
+
+    template<typename F>
+    double Run(const char* sName, size_t iIterations, F fn, int iPasses = 5)
+    {
+        double dBestNs = 0.0;
+        for (int iPass = 0; iPass < iPasses; iPass++) {
+            auto tStart = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iIterations; i++)
+                fn(i);
+            double dNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - tStart).count() / (double)iIterations;
+            dBestNs = iPass == 0 ? dNs : std::min(dBestNs, dNs);
+        }
+        if (dBestNs >= 1e6)
+            printf("%-48s %12.2f ms\n", sName, dBestNs / 1e6);
+        else
+            printf("%-48s %12.2f ns\n", sName, dBestNs);
+        return dBestNs;
+    }
+}
@@ -0,0 +1,34 @@
+// Hook overhead outside the game: mid hooks (empty, GPR-only and xmm-writing callbacks) and inline hooks (call,
+// fastcall, unsafe_call) on the synthetic function from HookBench.hpp, the same numbers [Hook Benchmark] logs in game.
+
+#include "HookBench.hpp"
+
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <cstdio>
+
+int main()
+{
+    constexpr int kIterations = 1'000'000;
+
+    void* memory = mmap(nullptr, HookBench::kCodeSize, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        fprintf(stderr, "error: could not map the synthetic function\n");
+        return 1;
+    }
+
+    // Stay on one core so the TSC readings are comparable
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(sched_getcpu(), &cpus);
+    sched_setaffinity(0, sizeof(cpus), &cpus);
+
+    auto results = HookBench::RunVariants(static_cast<std::uint8_t*>(memory), kIterations,
+        [](const char* sName) { fprintf(stderr, "error: %s: could not create hook\n", sName); });
+    for (const auto& [sName, dCycles] : results)
+        printf("%-48s %12.2f cycles (%+.2f over baseline)\n", sName, dCycles, dCycles - results.front().second);
+
+    munmap(memory, HookBench::kCodeSize);
+    return 0;
+}
@@ -0,0 +1,30 @@
+// LOD multiplier lookups: the compiled table the hook uses against interpolating the parsed points directly.
+
+#include "Bench.hpp"
+#include "LodCurve.hpp"
+
+#include <random>
+#include <vector>
+
+int main()
+{
+    constexpr size_t kDistances = 1 << 16;
+    std::vector<float> vDistances(kDistances);
+    std::mt19937 rng(47);
+    std::uniform_real_distribution<float> distance(0.0f, 1500.0f);
+    for (auto& fDistance : vDistances)
+        fDistance = distance(rng);
+
+    for (const char* sCurve : { "0:1, 400:2", "0:1, 100:1, 200:1.2, 400:2, 600:2.5, 800:2.8, 1000:3, 1200:3.1",
+        "0:1, 50:1.1, 100:1.2, 150:1.3, 200:1.4, 250:1.5, 300:1.6, 350:1.7, 400:1.8, 450:1.9, 500:2, 600:2.2, 700:2.4, 800:2.6, 900:2.8, 1000:3" }) {
+        std::vector<LodCurve::Point> points;
+        LodCurve::Parse(sCurve, points);
+        auto table = LodCurve::Compile(points);
+        printf("%zu points\n", points.size());
+
+        Bench::Run("  Table::Evaluate", 1 << 22, [&](size_t i) { Bench::Keep(table.Evaluate(vDistances[i & (kDistances - 1)])); });
+        Bench::Run("  Interpolate", 1 << 22, [&](size_t i) { Bench::Keep(LodCurve::Interpolate(points, vDistances[i & (kDistances - 1)])); });
+        Bench::Run("  Compile", 1 << 12, [&](size_t) { Bench::Keep(LodCurve::Compile(points)); });
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+// Scan strategies (naive, anchor, Horspool) over a synthetic code section, with signatures taken from dllmain.cpp
+// placed near its end so every scan covers almost the whole buffer.
+
+#include "Bench.hpp"
+#include "Pattern.hpp"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Skewed towards the bytes x64 code is full of, like the game's .text
+    std::vector<uint8_t> SyntheticCode(size_t size)
+    {
+        static const uint8_t kCommon[] = { 0x00, 0x48, 0x8B, 0x89, 0x0F, 0xFF, 0xE8, 0xC3, 0xCC, 0x24, 0x44, 0x4C, 0x83, 0x85, 0x74, 0x75 };
+        std::mt19937 rng(1234);
+        std::vector<uint8_t> data(size);
+        for (auto& b : data)
+            b = rng() % 10 < 4 ? kCommon[rng() % std::size(kCommon)] : (uint8_t)rng();
+        return data;
+    }
+
+    const char* kSignatures[] = {
+        "48 89 ?? ?? 8B ?? ?? ?? ?? ?? C5 ?? ?? ?? C4 ?? ?? ?? ?? 8B ?? ?? ?? ?? ??",
+        "45 ?? ?? 0F 84 ?? ?? ?? ?? 8B ?? C5 ?? ?? ?? C4 ?? ?? ?? ?? 41 ?? ??",
+        "48 89 5c 24 08 56 48 83 ec ?? 41 8a f1 48 8b d9 85 d2",
+        "75 ?? 85 ?? 74 ?? 40 ?? 01 41 ?? ?? ?? ?? ?? ?? ??",
+    };
+}
+
+int main()
+{
+    constexpr size_t kSize = 32 * 1024 * 1024;
+    auto data = SyntheticCode(kSize);
+
+    Pattern::ByteHistogram histogram;
+    Bench::Run("ByteHistogram::Add (32 MB)", 1, [&](size_t) { histogram.Add(data.data(), data.size()); }, 3);
+
+    for (const char* sSignature : kSignatures) {
+        auto signature = Pattern::Parse(sSignature);
+        size_t iOffset = kSize - 4096;
+        for (size_t i = 0; i < signature.Size(); i++) {
+            if (signature.IsLiteral(i))
+                data[iOffset + i] = signature.bytes[i];
+        }
+
+        auto anchor = Pattern::ChooseAnchor(signature, histogram);
+        auto horspool = Pattern::BuildHorspool(signature);
+        printf("%s (auto = %s)\n", sSignature, Pattern::ChooseStrategy(signature, horspool) == Pattern::Strategy::Horspool ? "Horspool" : "Anchor");
+
+        Bench::Run("  Naive, per scan", 1, [&](size_t) { Bench::Keep(Pattern::Find(data.data(), data.size(), signature)); }, 3);
+        Bench::Run("  Anchor, per scan", 1, [&](size_t) { Bench::Keep(Pattern::Find(data.data(), data.size(), signature, anchor)); }, 3);
+        Bench::Run("  Horspool, per scan", 1, [&](size_t) { Bench::Keep(Pattern::Find(data.data(), data.size(), signature, horspool)); }, 3);
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Per-message cost of the window message filtering in NewWndProc and CallWndProcHook, replaying message streams.
+// Without arguments the streams are synthetic, modelled on what the game's window thread sees. A recorded stream can be
+// given as a text file with one "<hwnd> <message>" pair in hex per line (e.g. from Spy++ output, trimmed).
+//
+// user32 can't be called here, so foreground lookups and class name lookups are stand-ins. Besides the time per message
+// the number of lookups per stream is printed, that's the number the caching is meant to bring down.
+
+#include "Bench.hpp"
+#include "WindowFocus.hpp"
+
+#include <cwchar>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t kWakeMessage = 0xC123; // Registered messages are in 0xC000-0xFFFF
+
+    struct Message
+    {
+        uintptr_t hwnd;
+        uint32_t uMessage;
+    };
+
+    struct Stream
+    {
+        const char* sName;
+        std::vector<Message> messages;
+    };
+
+    constexpr uintptr_t kGameWindow = 0x10A2C;
+
+    // Mostly input, timers and painting for the game window with the odd focus change, like a play session
+    Stream Gameplay(size_t iCount)
+    {
+        static const uint32_t kCommon[] = { 0x00FF, 0x00FF, 0x00FF, 0x0113, 0x000F, 0x0200, 0x0020, 0x0084, 0x0100, 0x0101 };
+        static const uint32_t kFocus[] = { Focus::Message::NcActivate, Focus::Message::Activate, Focus::Message::ActivateApp,
+            Focus::Message::KillFocus, Focus::Message::SetFocus, kWakeMessage };
+        std::mt19937 rng(28);
+        Stream stream{ "Gameplay", {} };
+        for (size_t i = 0; i < iCount; i++) {
+            bool bFocus = rng() % 2000 == 0;
+            stream.messages.push_back({ kGameWindow, bFocus ? kFocus[rng() % std::size(kFocus)] : kCommon[rng() % std::size(kCommon)] });
+        }
+        return stream;
+    }
+
+    // Alt-tabbing back and forth, every change is a burst of activation messages
+    Stream AltTab(size_t iCount)
+    {
+        static const uint32_t kBurst[] = { Focus::Message::NcActivate, Focus::Message::Activate, Focus::Message::ActivateApp,
+            Focus::Message::SetFocus, Focus::Message::KillFocus, kWakeMessage, 0x000F, 0x0113 };
+        Stream stream{ "Alt-tab", {} };
+        for (size_t i = 0; i < iCount; i++)
+            stream.messages.push_back({ kGameWindow, kBurst[i % std::size(kBurst)] });
+        return stream;
+    }
+
+    // Before the game window exists: IME, console and helper windows on the game's thread
+    Stream Startup(size_t iCount)
+    {
+        static const uintptr_t kWindows[] = { 0x20F0E, 0x30A14, 0x10B32, 0x40C08, 0x50D1A, 0x60E26, kGameWindow };
+        std::mt19937 rng(29);
+        Stream stream{ "Startup (hook)", {} };
+        for (size_t i = 0; i < iCount; i++)
+            stream.messages.push_back({ kWindows[rng() % (std::size(kWindows) - 1)], 0x0024 + (uint32_t)(rng() % 64) });
+        return stream;
+    }
+
+    bool Load(const char* sPath, Stream& stream)
+    {
+        std::ifstream file(sPath);
+        unsigned long long hwnd = 0;
+        unsigned int uMessage = 0;
+        while (file >> std::hex >> hwnd >> uMessage)
+            stream.messages.push_back({ (uintptr_t)hwnd, uMessage });
+        return !stream.messages.empty();
+    }
+
+    // Stand-in for GetForegroundWindow, alternates so the state machine has something to do
+    size_t iForegroundLookups = 0;
+    [[gnu::noinline]] bool QueryForeground()
+    {
+        return ++iForegroundLookups % 2 != 0;
+    }
+
+    // Stand-in for RealGetWindowClassW
+    size_t iClassLookups = 0;
+    [[gnu::noinline]] void QueryClassName(uintptr_t hwnd, wchar_t* sName, size_t iLength)
+    {
+        iClassLookups++;
+        swprintf(sName, iLength, hwnd == kGameWindow ? L"FFXVI" : L"IME%llx", (unsigned long long)hwnd);
+    }
+
+    void ReplayWndProc(const Stream& stream, bool bCached)
+    {
+        size_t iActions = 0;
+        auto replay = [&](size_t) {
+            Focus::StateMachine state;
+            bool bFocusDirty = true;
+            iForegroundLookups = 0;
+            for (const Message& message : stream.messages) {
+                bool bCheck = bFocusDirty || !bCached || Focus::IsFocusMessage(message.uMessage, kWakeMessage);
+                bFocusDirty = false;
+                if (bCheck)
+                    iActions += state.OnEvent(QueryForeground() ? Focus::Event::Foreground : Focus::Event::Background) != Focus::Action::None;
+            }
+        };
+        double dNs = Bench::Run(bCached ? "  NewWndProc, cached focus" : "  NewWndProc, query every message", 1, replay) / stream.messages.size();
+        printf("    %.2f ns per message, %zu foreground lookups per replay\n", dNs, iForegroundLookups);
+        Bench::Keep(iActions);
+    }
+
+    void ReplayHook(const Stream& stream, bool bCached)
+    {
+        size_t iFound = 0;
+        auto replay = [&](size_t) {
+            Focus::CheckedWindows checked;
+            iClassLookups = 0;
+            for (const Message& message : stream.messages) {
+                if (bCached && !checked.CheckOnce((const void*)message.hwnd))
+                    continue;
+                wchar_t sClass[32];
+                QueryClassName(message.hwnd, sClass, 31);
+                iFound += wcscmp(sClass, L"FFXVI") == 0;
+            }
+        };
+        double dNs = Bench::Run(bCached ? "  CallWndProcHook, checked windows" : "  CallWndProcHook, look up every message", 1, replay) / stream.messages.size();
+        printf("    %.2f ns per message, %zu class lookups per replay\n", dNs, iClassLookups);
+        Bench::Keep(iFound);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    constexpr size_t kMessages = 1000000;
+    std::vector<Stream> wndProcStreams;
+    std::vector<Stream> hookStreams;
+    if (argc > 1) {
+        Stream recorded{ argv[1], {} };
+        if (!Load(argv[1], recorded)) {
+            fprintf(stderr, "error: no messages in %s\n", argv[1]);
+            return 1;
+        }
+        wndProcStreams.push_back(recorded);
+        hookStreams.push_back(recorded);
+    }
+    else {
+        wndProcStreams.push_back(Gameplay(kMessages));
+        wndProcStreams.push_back(AltTab(kMessages));
+        hookStreams.push_back(Startup(kMessages));
+    }
+
+    // Bench::Run prints the time for a whole replay, the lines below it are per message
+    for (const auto& stream : wndProcStreams) {
+        printf("%s, %zu messages\n", stream.sName, stream.messages.size());
+        ReplayWndProc(stream, false);
+        ReplayWndProc(stream, true);
+    }
+    for (const auto& stream : hookStreams) {
+        printf("%s, %zu messages\n", stream.sName, stream.messages.size());
+        ReplayHook(stream, false);
+        ReplayHook(stream, true);
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// Aspect ratio and HUD placement for a resolution. The HUD is kept at the native aspect, pillarboxed on wider
+// resolutions and letterboxed on narrower ones.
+namespace Aspect
+{
+    struct Layout
+    {
+        float fAspectRatio;
+        float fAspectMultiplier;
+        float fHUDWidth;
+        float fHUDHeight;
+        float fHUDWidthOffset;
+        float fHUDHeightOffset;
+    };
+
+    inline Layout Calculate(int iResX, int iResY, float fNativeAspect)
+    {
+        Layout layout{};
+        layout.fAspectRatio = (float)iResX / (float)iResY;
+        layout.fAspectMultiplier = layout.fAspectRatio / fNativeAspect;
+
+        layout.fHUDWidth = iResY * fNativeAspect;
+        layout.fHUDHeight = (float)iResY;
+        layout.fHUDWidthOffset = (float)(iResX - layout.fHUDWidth) / 2;
+        layout.fHUDHeightOffset = 0;
+        if (layout.fAspectRatio < fNativeAspect) {
+            layout.fHUDWidth = (float)iResX;
+            layout.fHUDHeight = (float)iResX / fNativeAspect;
+            layout.fHUDWidthOffset = 0;
+            layout.fHUDHeightOffset = (float)(iResY - layout.fHUDHeight) / 2;
+        }
+        return layout;
+    }
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "stdafx.h"
+#include "Ring.hpp"
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/bundled/args.h>
+
+// Binary log channel for per-frame hooks.
+// A call site records its ID and raw argument bits into a per-thread ring, formatting happens later on a background
+// thread that writes through spdlog. Each call site is rate limited so a hook running every frame can't flood the log,
+// records over the limit are counted and reported instead.
+//
+//   static BinLog::Callsite MovieSizeLog("Movie Size: {}x{}");
+//   MovieSizeLog.Write(iWidth, iHeight);
+namespace BinLog
+{
+    constexpr size_t kMaxArgs = 6;
+    constexpr size_t kMaxCallsites = 256;
+
+    enum class ArgType : uint8_t
+    {
+        Int,
+        UInt,
+        Float,
+        Bool,
+    };
+
+    struct Record
+    {
+        int64_t iTimestamp;
+        uint32_t iCallsite;
+        uint32_t iThreadId;
+        uint8_t iArgCount;
+        ArgType types[kMaxArgs];
+        uint64_t args[kMaxArgs];
+    };
+
+    class Callsite;
+
+    inline std::atomic<bool> bEnabled = false;
+    inline Callsite* Callsites[kMaxCallsites] = {};
+    inline std::atomic<uint32_t> iCallsiteCount = 0;
+    inline SpscRingPool<Record, 4096, 32> Records;
+
+    inline int64_t TicksPerSecond()
+    {
+        static const int64_t iFrequency = [] {
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            return frequency.QuadPart;
+        }();
+        return iFrequency;
+    }
+
+    class Callsite
+    {
+    public:
+        // `format` is an fmt format string and has to outlive the process (a string literal)
+        explicit Callsite(const char* format, uint32_t perSecond = 10) : sFormat(format), iPerSecond(perSecond)
+        {
+            iId = iCallsiteCount.fetch_add(1, std::memory_order_relaxed);
+            if (iId < kMaxCallsites)
+                Callsites[iId] = this;
+        }
+
+        template<typename... Args>
+        void Write(Args... args)
+        {
+            static_assert(sizeof...(Args) <= kMaxArgs, "Too many arguments for a binary log record");
+            if (!bEnabled.load(std::memory_order_relaxed) || iId >= kMaxCallsites)
+                return;
+
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            if (!Admit(now.QuadPart))
+                return;
+
+            Record record;
+            record.iTimestamp = now.QuadPart;
+            record.iCallsite = iId;
+            record.iThreadId = GetCurrentThreadId();
+            record.iArgCount = (uint8_t)sizeof...(Args);
+            size_t i = 0;
+            (Pack(record, i++, args), ...);
+            Records.Push(record);
+        }
+
+        const char* Format() const { return sFormat; }
+        uint64_t TakeSuppressed() { return iSuppressed.exchange(0, std::memory_order_relaxed); }
+
+    private:
+        const char* sFormat;
+        uint32_t iPerSecond;
+        uint32_t iId;
+        std::atomic<int64_t> iWindow = -1;
+        std::atomic<uint32_t> iInWindow = 0;
+        std::atomic<uint64_t> iSuppressed = 0;
+
+        // Fixed one second windows. Two threads crossing into a new window at once can let a record or two extra
+        // through, which is fine for a log.
+        bool Admit(int64_t iNow)
+        {
+            int64_t iCurrent = iNow / TicksPerSecond();
+            if (iWindow.load(std::memory_order_relaxed) != iCurrent) {
+                iWindow.store(iCurrent, std::memory_order_relaxed);
+                iInWindow.store(0, std::memory_order_relaxed);
+            }
+            if (iInWindow.fetch_add(1, std::memory_order_relaxed) < iPerSecond)
+                return true;
+
+            iSuppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        template<typename T>
+        static void Pack(Record& record, size_t i, T value)
+        {
+            if constexpr (std::is_same_v<T, bool>) {
+                record.types[i] = ArgType::Bool;
+                record.args[i] = value;
+            }
+            else if constexpr (std::is_floating_point_v<T>) {
+                double dValue = value;
+                record.types[i] = ArgType::Float;
+                memcpy(&record.args[i], &dValue, sizeof(dValue));
+            }
+            else if constexpr (std::is_pointer_v<T>) {
+                record.types[i] = ArgType::UInt;
+                record.args[i] = (uint64_t)(uintptr_t)value;
+            }
+            else if constexpr (std::is_enum_v<T> || std::is_unsigned_v<T>) {
+                record.types[i] = ArgType::UInt;
+                record.args[i] = (uint64_t)value;
+            }
+            else {
+                static_assert(std::is_integral_v<T>, "Unsupported binary log argument type");
+                record.types[i] = ArgType::Int;
+                record.args[i] = (uint64_t)(int64_t)value;
+            }
+        }
+    };
+
+    inline std::string FormatRecord(const Record& record)
+    {
+        fmt::dynamic_format_arg_store<fmt::format_context> store;
+        for (uint8_t i = 0; i < record.iArgCount; i++) {
+            switch (record.types[i]) {
+            case ArgType::Int:
+                store.push_back((int64_t)record.args[i]);
+                break;
+            case ArgType::UInt:
+                store.push_back(record.args[i]);
+                break;
+            case ArgType::Float: {
+                double dValue;
+                memcpy(&dValue, &record.args[i], sizeof(dValue));
+                store.push_back(dValue);
+                break;
+            }
+            case ArgType::Bool:
+                store.push_back(record.args[i] != 0);
+                break;
+            }
+        }
+
+        const char* sFormat = Callsites[record.iCallsite]->Format();
+        try {
+            return fmt::vformat(sFormat, store);
+        }
+        catch (const fmt::format_error&) {
+            return fmt::format("{} (bad format)", sFormat);
+        }
+    }
+
+    // Formats everything recorded so far. Runs on its own thread once the channel is enabled.
+    inline void FormatterThread()
+    {
+        const int64_t iOrigin = [] {
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            return now.QuadPart;
+        }();
+
+        uint64_t iLastDropped = 0;
+        while (true) {
+            Records.Drain([&](const Record& record) {
+                double dSeconds = (double)(record.iTimestamp - iOrigin) / TicksPerSecond();
+                spdlog::info("Diagnostics: [{:.3f}s, tid {}] {}", dSeconds, record.iThreadId, FormatRecord(record));
+                });
+
+            uint32_t iCount = std::min<uint32_t>(iCallsiteCount.load(std::memory_order_relaxed), kMaxCallsites);
+            for (uint32_t i = 0; i < iCount; i++) {
+                if (!Callsites[i])
+                    continue;
+                if (uint64_t iSuppressed = Callsites[i]->TakeSuppressed())
+                    spdlog::info("Diagnostics: {} records rate limited: {}", iSuppressed, Callsites[i]->Format());
+            }
+
+            if (uint64_t iDropped = Records.Dropped(); iDropped != iLastDropped) {
+                spdlog::warn("Diagnostics: {} records dropped so far (ring full).", iDropped);
+                iLastDropped = iDropped;
+            }
+            Sleep(100);
+        }
+    }
+
+    inline void Enable()
+    {
+        if (!bEnabled.exchange(true))
+            std::thread(FormatterThread).detach();
+    }
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Combat event log.
+// The damage, will and stagger hooks record fixed size events, a background thread encodes them into a file that
+// tools/combatlog turns into timelines. Everything here is plain C++ so the tool can share it.
+//
+// File layout (little endian):
+//   FileHeader
+//   events, each one:
+//     varint  zigzag(timestamp - previous timestamp)
+//     u8      kind | staggerType << 4
+//     varint  zigzag(combat - previous combat)
+//     varint  tableIndex
+//     varint  zigzag(delta)
+//     varint  before
+//     varint  after
+//     f32     timer (stagger events only)
+// Events from different game threads are interleaved, so timestamp deltas can be negative.
+namespace CombatLog
+{
+    constexpr uint32_t kMagic = 0x4C435846; // "FXCL"
+    constexpr uint32_t kVersion = 1;
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t ticksPerSecond; // Timestamp frequency (QueryPerformanceFrequency)
+    };
+
+    enum class Kind : uint8_t
+    {
+        Health,  // delta = health delta passed to the damage function, before/after = Health
+        Will,    // delta = will delta passed to the will function, before/after = Will
+        Stagger, // staggerType = Stagger Type 1/2/3 hook, timer = stagger timer being set (after scaling), before/after = StaggerType at that point
+    };
+
+    struct Event
+    {
+        uint64_t timestamp;
+        uint64_t combat;     // CombatDetail*
+        uint64_t tableIndex; // Entity class from the entity snapshot, 0 if unknown
+        int32_t delta;
+        uint32_t before;
+        uint32_t after;
+        float timer;
+        Kind kind;
+        uint8_t staggerType;
+    };
+
+    class Encoder
+    {
+    public:
+        void Header(std::vector<uint8_t>& out, uint64_t ticksPerSecond)
+        {
+            FileHeader header{ kMagic, kVersion, ticksPerSecond };
+            Append(out, &header, sizeof(header));
+        }
+
+        void Encode(std::vector<uint8_t>& out, const Event& event)
+        {
+            Varint(out, ZigZag((int64_t)(event.timestamp - iLastTimestamp)));
+            out.push_back((uint8_t)((uint8_t)event.kind | event.staggerType << 4));
+            Varint(out, ZigZag((int64_t)(event.combat - iLastCombat)));
+            Varint(out, event.tableIndex);
+            Varint(out, ZigZag(event.delta));
+            Varint(out, event.before);
+            Varint(out, event.after);
+            if (event.kind == Kind::Stagger)
+                Append(out, &event.timer, sizeof(event.timer));
+
+            iLastTimestamp = event.timestamp;
+            iLastCombat = event.combat;
+        }
+
+    private:
+        uint64_t iLastTimestamp = 0;
+        uint64_t iLastCombat = 0;
+
+        static uint64_t ZigZag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+
+        static void Varint(std::vector<uint8_t>& out, uint64_t value)
+        {
+            while (value >= 0x80) {
+                out.push_back((uint8_t)(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back((uint8_t)value);
+        }
+
+        static void Append(std::vector<uint8_t>& out, const void* data, size_t size)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            out.insert(out.end(), bytes, bytes + size);
+        }
+    };
+
+    class Decoder
+    {
+    public:
+        Decoder(const uint8_t* data, size_t size) : pData(data), pEnd(data + size) {}
+
+        bool Header(FileHeader& header)
+        {
+            if ((size_t)(pEnd - pData) < sizeof(header))
+                return false;
+            memcpy(&header, pData, sizeof(header));
+            pData += sizeof(header);
+            return header.magic == kMagic && header.version == kVersion && header.ticksPerSecond != 0;
+        }
+
+        // False at the end of the data or if the rest is truncated (the game was closed mid-write)
+        bool Next(Event& event)
+        {
+            uint64_t timestampDelta, combatDelta, tableIndex, delta, before, after;
+            if (!Varint(timestampDelta) || pData == pEnd)
+                return false;
+
+            uint8_t kindByte = *pData++;
+            if (!Varint(combatDelta) || !Varint(tableIndex) || !Varint(delta) || !Varint(before) || !Varint(after))
+                return false;
+
+            event = {};
+            event.timestamp = iLastTimestamp + (uint64_t)UnZigZag(timestampDelta);
+            event.combat = iLastCombat + (uint64_t)UnZigZag(combatDelta);
+            event.tableIndex = tableIndex;
+            event.delta = (int32_t)UnZigZag(delta);
+            event.before = (uint32_t)before;
+            event.after = (uint32_t)after;
+            event.kind = (Kind)(kindByte & 0xF);
+            event.staggerType = kindByte >> 4;
+            if (event.kind == Kind::Stagger) {
+                if ((size_t)(pEnd - pData) < sizeof(event.timer))
+                    return false;
+                memcpy(&event.timer, pData, sizeof(event.timer));
+                pData += sizeof(event.timer);
+            }
+
+            iLastTimestamp = event.timestamp;
+            iLastCombat = event.combat;
+            return true;
+        }
+
+    private:
+        const uint8_t* pData;
+        const uint8_t* pEnd;
+        uint64_t iLastTimestamp = 0;
+        uint64_t iLastCombat = 0;
+
+        static int64_t UnZigZag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+        bool Varint(uint64_t& value)
+        {
+            value = 0;
+            for (int shift = 0; shift < 64 && pData != pEnd; shift += 7) {
+                uint8_t byte = *pData++;
+                value |= (uint64_t)(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    return true;
+            }
+            return false;
+        }
+    };
+}
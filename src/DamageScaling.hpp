@@ -0,0 +1,51 @@
+#pragma once
+
+#include "GameObject.h"
+#include "FlatMap.hpp"
+
+#include <cmath>
+
+// Damage and will scaling per entity class (Unk9f30Struct::TableIndex).
+// Scales are stored as 16.16 fixed point so the damage hooks stay in integer math.
+namespace DamageScaling
+{
+    constexpr int kFractionBits = 16;
+    constexpr s32 kOne = 1 << kFractionBits;
+
+    inline s32 ToFixed(float scale)
+    {
+        return (s32)std::lround((double)scale * kOne);
+    }
+
+    // Truncates toward zero like the float multiply it replaces.
+    // The s64 product can't overflow, |delta| <= 2^31 and |scale| < 2^31 (ToFixed of anything below 32768) stay under 2^62.
+    // The narrowing back to s32 is only exact while |delta * scale / kOne| <= INT32_MAX. Config clamps scales to 100
+    // (6553600 fixed), which keeps any |delta| up to 21474836 safe, far more than a single hit in the game.
+    inline s32 Apply(s32 delta, s32 scale)
+    {
+        return (s32)((s64)delta * scale / kOne);
+    }
+
+    struct Scales
+    {
+        s32 Health;
+        s32 Will;
+    };
+
+    class Table
+    {
+    public:
+        // Returns false if the class already has a rule or the table is full
+        bool Add(u64 tableIndex, float health, float will)
+        {
+            return rules.Insert(tableIndex, Scales{ ToFixed(health), ToFixed(will) });
+        }
+
+        const Scales* Find(u64 tableIndex) const { return rules.Find(tableIndex); }
+        size_t Size() const { return rules.Size(); }
+        bool Empty() const { return rules.Size() == 0; }
+
+    private:
+        FlatMap<u64, Scales, 256> rules;
+    };
+}
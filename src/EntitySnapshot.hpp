@@ -0,0 +1,117 @@
+#pragma once
+
+#include "GameObject.h"
+#include "FlatMap.hpp"
+
+#include <atomic>
+
+// Per-frame copy of the entities in the game's object table, stored column by column.
+// The object table iterator hook rebuilds it once per frame, hooks that only have a CombatDetail* look the entity up here
+// instead of guessing from the CombatDetail fields. Two buffers are kept so a build never writes over the snapshot
+// readers are using, each buffer has a sequence count so a reader that is slow enough to overlap a second build notices.
+namespace Entities
+{
+    constexpr size_t kMaxEntities = 1024;
+
+    struct Record
+    {
+        u64 TableIndex;
+        CombatDetail* Combat;
+        u32 Health;
+        u32 Will;
+        u32 StaggerType;
+        float StaggerTimer;
+    };
+
+    struct Snapshot
+    {
+        u64 iFrame = 0;
+        size_t iCount = 0;
+
+        u64 TableIndex[kMaxEntities];
+        CombatDetail* Combat[kMaxEntities];
+        u32 Health[kMaxEntities];
+        u32 Will[kMaxEntities];
+        u32 StaggerType[kMaxEntities];
+        float StaggerTimer[kMaxEntities];
+
+        FlatMap<const CombatDetail*, u32, kMaxEntities * 2> Index; // CombatDetail* -> row
+
+        Record Row(size_t i) const
+        {
+            return { TableIndex[i], Combat[i], Health[i], Will[i], StaggerType[i], StaggerTimer[i] };
+        }
+    };
+
+    class SnapshotBuffer
+    {
+    public:
+        // Copies the table into the back buffer and publishes it. Only one thread may build at a time.
+        void Build(const Struct_Param2* table)
+        {
+            if (!table || !table->unk_0x00 || !table->unk_0x00->unk_0x08)
+                return;
+
+            u32 iBack = iFront.load(std::memory_order_relaxed) ^ 1;
+            Snapshot& snapshot = buffers[iBack];
+            iSequence[iBack].fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            snapshot.Index.Clear();
+            size_t iCount = 0;
+            Unk9f30Struct** entries = table->unk_0x00->unk_0x08;
+            for (u64 i = 0; i < table->unk_0x08 && iCount < kMaxEntities; i++) {
+                Unk9f30Struct* entry = entries[i];
+                if (!entry || !entry->Combat)
+                    continue;
+
+                CombatDetail* combat = entry->Combat;
+                if (!snapshot.Index.Insert(combat, (u32)iCount))
+                    continue;
+
+                snapshot.TableIndex[iCount] = entry->TableIndex;
+                snapshot.Combat[iCount] = combat;
+                snapshot.Health[iCount] = combat->Health;
+                snapshot.Will[iCount] = combat->Will;
+                snapshot.StaggerType[iCount] = combat->StaggerType;
+                snapshot.StaggerTimer[iCount] = combat->StaggerTimer;
+                iCount++;
+            }
+            snapshot.iCount = iCount;
+            snapshot.iFrame = iFrame.fetch_add(1, std::memory_order_relaxed) + 1;
+
+            iSequence[iBack].fetch_add(1, std::memory_order_release);
+            iFront.store(iBack, std::memory_order_release);
+        }
+
+        // Row for an entity in the latest snapshot, false if it wasn't in the table or a build got in the way.
+        bool Find(const CombatDetail* combat, Record& out) const
+        {
+            u32 iIndex = iFront.load(std::memory_order_acquire);
+            const Snapshot& snapshot = buffers[iIndex];
+
+            u32 iBefore = iSequence[iIndex].load(std::memory_order_acquire);
+            if (iBefore & 1)
+                return false;
+
+            const u32* row = snapshot.Index.Find(combat);
+            if (row)
+                out = snapshot.Row(*row);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return row && iSequence[iIndex].load(std::memory_order_relaxed) == iBefore;
+        }
+
+        // Number of snapshots built so far
+        u64 Frame() const { return iFrame.load(std::memory_order_relaxed); }
+
+        // Latest snapshot for readers that walk all of it, e.g. once per frame from the thread that builds it
+        const Snapshot& Latest() const { return buffers[iFront.load(std::memory_order_acquire)]; }
+
+    private:
+        Snapshot buffers[2];
+        std::atomic<u32> iSequence[2] = {};
+        std::atomic<u32> iFront = 0;
+        std::atomic<u64> iFrame = 0;
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Fixed capacity open-addressing hash map with linear probing.
+// No heap allocations and no erase, Clear() is O(1) because slots are tagged with a generation instead of being wiped.
+// Meant for small tables that are looked up from hooks: integer or pointer keys, trivially copyable values.
+template<typename K, typename V, size_t Capacity>
+class FlatMap
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    void Clear()
+    {
+        iCount = 0;
+        // Generation 0 marks a never used slot, skip it when wrapping around
+        if (++iGeneration == 0) {
+            for (auto& slot : slots)
+                slot.generation = 0;
+            iGeneration = 1;
+        }
+    }
+
+    // Returns false if the key is already present or the table is full (kept at most 3/4 full).
+    bool Insert(K key, const V& value)
+    {
+        if (iCount >= Capacity - Capacity / 4)
+            return false;
+
+        for (size_t i = Hash(key);; i = (i + 1) & (Capacity - 1)) {
+            Slot& slot = slots[i];
+            if (slot.generation != iGeneration) {
+                slot.generation = iGeneration;
+                slot.key = key;
+                slot.value = value;
+                iCount++;
+                return true;
+            }
+            if (slot.key == key)
+                return false;
+        }
+    }
+
+    const V* Find(K key) const
+    {
+        // Bounded so a reader racing a writer (see EntitySnapshot.hpp) can't spin forever
+        size_t i = Hash(key);
+        for (size_t n = 0; n < Capacity; n++, i = (i + 1) & (Capacity - 1)) {
+            const Slot& slot = slots[i];
+            if (slot.generation != iGeneration)
+                return nullptr;
+            if (slot.key == key)
+                return &slot.value;
+        }
+        return nullptr;
+    }
+
+    size_t Size() const { return iCount; }
+
+private:
+    struct Slot
+    {
+        K key;
+        V value;
+        uint32_t generation;
+    };
+
+    Slot slots[Capacity] = {};
+    size_t iCount = 0;
+    uint32_t iGeneration = 1;
+
+    static size_t Hash(K key)
+    {
+        // Fibonacci hashing, pointers have their low bits clear so take the high half of the product
+        uint64_t x = (uint64_t)key * 0x9E3779B97F4A7C15ull;
+        return (size_t)(x >> 32) & (Capacity - 1);
+    }
+};
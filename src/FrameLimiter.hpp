@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+// Frame limiter for when the game window is in the background.
+// Works on a clock passed in by the caller (nanoseconds) and only says how long the frame has to wait, so it can be
+// driven by a simulated clock and focus events outside of the game. The caller does the waiting.
+namespace FrameLimit
+{
+    class Limiter
+    {
+    public:
+        // 0 = no limit
+        void SetFramerate(float fFramerate) { iIntervalNs = fFramerate > 0.0f ? (int64_t)(1e9 / fFramerate) : 0; }
+
+        int64_t IntervalNs() const { return iIntervalNs; }
+
+        // Call once a frame. Returns how long to hold this frame back, always 0 while `bLimit` is false.
+        // Frames are paced against a running deadline so the cap holds on average even when waits overshoot, but a
+        // frame that comes in more than one interval late starts over instead of letting the next ones catch up.
+        int64_t OnFrame(bool bLimit, int64_t iNowNs)
+        {
+            if (!bLimit || iIntervalNs == 0) {
+                bLimiting = false;
+                return 0;
+            }
+
+            if (!bLimiting || iNowNs - iNextNs > iIntervalNs) {
+                // First limited frame goes straight away
+                bLimiting = true;
+                iNextNs = iNowNs + iIntervalNs;
+                return 0;
+            }
+
+            int64_t iWaitNs = iNextNs > iNowNs ? iNextNs - iNowNs : 0;
+            iNextNs += iIntervalNs;
+            return iWaitNs;
+        }
+
+        // Whether the last frame was limited
+        bool IsLimiting() const { return bLimiting; }
+
+    private:
+        int64_t iIntervalNs = 0;
+        int64_t iNextNs = 0;
+        bool bLimiting = false;
+    };
+}
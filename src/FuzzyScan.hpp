@@ -0,0 +1,186 @@
+#pragma once
+
+#include "Pattern.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Approximate signature search, for finding where a signature moved to after a game update.
+// Bit-parallel Shift-Or with k+1 state words (Wu-Manber, substitutions only) finds every place the first 64 bytes
+// of the signature match with at most k differing literal bytes, the whole signature is then compared at each of those.
+// Wildcards always match. Results are candidates for a human (or the sigpack tool) to look at, nothing here is
+// trusted enough to hook.
+namespace Fuzzy
+{
+    constexpr size_t kMaxWindow = 64;
+    constexpr size_t kMaxMismatchLimit = 15;
+
+    struct Candidate
+    {
+        size_t iOffset = 0;      // Start of the match in the scanned data
+        size_t iMismatches = 0;  // Differing literal bytes
+        bool bBoundary = false;  // Hook offset lands on an instruction boundary
+        double dConfidence = 0.0;
+    };
+
+    struct Options
+    {
+        size_t iMaxMismatches = 0; // 0 = about one literal byte in eight
+        size_t iMaxCandidates = 8;
+        double dBudgetMs = 2000.0; // Across every Scan() call on the same Search
+    };
+
+    inline size_t CountLiterals(const Pattern::Signature& signature)
+    {
+        size_t iLiterals = 0;
+        for (size_t i = 0; i < signature.Size(); i++)
+            iLiterals += signature.IsLiteral(i);
+        return iLiterals;
+    }
+
+    inline size_t CountMismatches(const uint8_t* address, const Pattern::Signature& signature)
+    {
+        size_t iMismatches = 0;
+        for (size_t i = 0; i < signature.Size(); i++)
+            iMismatches += signature.IsLiteral(i) && address[i] != signature.bytes[i];
+        return iMismatches;
+    }
+
+    class Search
+    {
+    public:
+        Search(const Pattern::Signature& signature, const Options& options) : signature(signature), options(options)
+        {
+            iLiterals = CountLiterals(signature);
+            iWindow = std::min(signature.Size(), kMaxWindow);
+            iMaxMismatches = options.iMaxMismatches ? options.iMaxMismatches : std::max<size_t>(1, iLiterals / 8);
+            iMaxMismatches = std::min({ iMaxMismatches, kMaxMismatchLimit, iLiterals > 0 ? iLiterals - 1 : 0 });
+
+            // Bit i of iMasks[c] is 0 if c can be at position i
+            for (auto& mask : iMasks)
+                mask = ~0ull;
+            for (size_t i = 0; i < iWindow; i++) {
+                for (unsigned c = 0; c < 256; c++) {
+                    if (!signature.IsLiteral(i) || signature.bytes[i] == c)
+                        iMasks[c] &= ~(1ull << i);
+                }
+            }
+            tStart = std::chrono::steady_clock::now();
+        }
+
+        // Adds the candidates found in data, `base` is added to their offsets. Returns false once out of time.
+        bool Scan(const uint8_t* data, size_t size, size_t base = 0)
+        {
+            size_t m = signature.Size();
+            if (m == 0 || iLiterals == 0 || size < m || bTimedOut)
+                return !bTimedOut;
+
+            const uint64_t iEnd = 1ull << (iWindow - 1);
+            uint64_t iState[kMaxMismatchLimit + 1];
+            for (auto& state : iState)
+                state = ~0ull;
+
+            // The window can't start past here and still leave room for the rest of the signature
+            size_t iLastStart = size - m;
+            for (size_t i = 0; i < size; i++) {
+                if ((i & 0xFFFF) == 0 && OutOfTime())
+                    return false;
+
+                uint64_t iMask = iMasks[data[i]];
+                uint64_t iPrevious = iState[0];
+                iState[0] = (iState[0] << 1) | iMask;
+                for (size_t j = 1; j <= iMaxMismatches; j++) {
+                    uint64_t iCurrent = iState[j];
+                    iState[j] = ((iState[j] << 1) | iMask) & (iPrevious << 1);
+                    iPrevious = iCurrent;
+                }
+
+                if ((iState[iMaxMismatches] & iEnd) || i + 1 < iWindow)
+                    continue;
+
+                size_t iStart = i + 1 - iWindow;
+                if (iStart > iLastStart)
+                    break;
+
+                size_t iMismatches = CountMismatches(data + iStart, signature);
+                if (iMismatches <= iMaxMismatches)
+                    Add({ base + iStart, iMismatches });
+            }
+            return true;
+        }
+
+        // Best first. `isBoundary(offset)` says whether the hook offset of the candidate at `offset` is on an
+        // instruction boundary, candidates where it isn't are kept but heavily penalised.
+        template<typename F>
+        std::vector<Candidate> Rank(F isBoundary) const
+        {
+            std::vector<Candidate> ranked = vCandidates;
+            for (auto& candidate : ranked) {
+                candidate.bBoundary = isBoundary(candidate.iOffset);
+                candidate.dConfidence = (double)(iLiterals - candidate.iMismatches) / iLiterals;
+                if (!candidate.bBoundary)
+                    candidate.dConfidence *= 0.25;
+                // Several equally good sites means none of them is a safe bet
+                candidate.dConfidence /= std::count_if(ranked.begin(), ranked.end(), [&](const Candidate& other) { return other.iMismatches == candidate.iMismatches; });
+            }
+            std::stable_sort(ranked.begin(), ranked.end(), [](const Candidate& a, const Candidate& b) { return a.dConfidence > b.dConfidence; });
+            return ranked;
+        }
+
+        size_t MaxMismatches() const { return iMaxMismatches; }
+        size_t Literals() const { return iLiterals; }
+        bool TimedOut() const { return bTimedOut; }
+        double ElapsedMs() const { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count(); }
+
+    private:
+        const Pattern::Signature& signature;
+        Options options;
+        size_t iLiterals = 0;
+        size_t iWindow = 0;
+        size_t iMaxMismatches = 0;
+        uint64_t iMasks[256];
+        std::vector<Candidate> vCandidates;
+        std::chrono::steady_clock::time_point tStart;
+        bool bTimedOut = false;
+
+        bool OutOfTime()
+        {
+            bTimedOut = ElapsedMs() > options.dBudgetMs;
+            return bTimedOut;
+        }
+
+        // Keeps the best iMaxCandidates, fewest mismatches first
+        void Add(const Candidate& candidate)
+        {
+            auto it = std::upper_bound(vCandidates.begin(), vCandidates.end(), candidate,
+                [](const Candidate& a, const Candidate& b) { return a.iMismatches < b.iMismatches; });
+            if (it == vCandidates.end() && vCandidates.size() >= options.iMaxCandidates)
+                return;
+            vCandidates.insert(it, candidate);
+            if (vCandidates.size() > options.iMaxCandidates)
+                vCandidates.pop_back();
+        }
+    };
+
+    // Walks instructions from the start of a candidate, `decode(address, remaining)` returns an instruction's length
+    // or 0 if it isn't one. The signature itself is expected to start on an instruction.
+    template<typename F>
+    bool LandsOnBoundary(const uint8_t* start, size_t size, size_t iHookOffset, F decode)
+    {
+        size_t iOffset = 0;
+        do {
+            if (iOffset >= size)
+                return false;
+            size_t iLength = decode(start + iOffset, size - iOffset);
+            if (iLength == 0)
+                return false;
+            if (iOffset == iHookOffset)
+                return true;
+            iOffset += iLength;
+        } while (iOffset <= iHookOffset);
+        return false;
+    }
+}
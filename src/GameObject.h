@@ -1,3 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
 typedef unsigned char u8;
 typedef unsigned short u16;
 typedef unsigned int u32;
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// What the game is doing right now (gameplay, combat, cutscene, movie or photo mode) and the settings that go with it.
+// The hooks only leave "last seen" timestamps behind, this turns them into a single state once a frame and swaps the
+// active profile when it changes. Profiles are built at startup and never modified afterwards, so switching is a
+// pointer store and a hook reading Active() always sees one whole profile.
+namespace GameState
+{
+    enum class State
+    {
+        Gameplay,
+        Combat,
+        Cutscene,
+        Movie,
+        PhotoMode,
+        Count,
+    };
+
+    constexpr size_t kStateCount = (size_t)State::Count;
+
+    inline const char* Name(State eState)
+    {
+        switch (eState) {
+        case State::Gameplay: return "Gameplay";
+        case State::Combat: return "Combat";
+        case State::Cutscene: return "Cutscene";
+        case State::Movie: return "Movie";
+        case State::PhotoMode: return "Photo Mode";
+        default: return "Unknown";
+        }
+    }
+
+    // Timestamps are milliseconds (GetTickCount64), 0 = never seen
+    struct Signals
+    {
+        bool bMovie = false;
+        uint64_t iPhotoModeLastSeen = 0;
+        uint64_t iCutsceneLastSeen = 0;
+        uint64_t iCombatLastSeen = 0;
+    };
+
+    // How long a signal counts after it was last seen. Combat is much longer since damage only happens now and then.
+    struct Timeouts
+    {
+        uint64_t iPhotoModeMs = 2000;
+        uint64_t iCutsceneMs = 500;
+        uint64_t iCombatMs = 8000;
+    };
+
+    inline bool Seen(uint64_t iLastSeen, uint64_t iNow, uint64_t iTimeoutMs)
+    {
+        return iLastSeen != 0 && iNow - iLastSeen <= iTimeoutMs;
+    }
+
+    // Photo mode can be opened during a cutscene and movies play over everything else, so the order matters
+    inline State Classify(const Signals& signals, uint64_t iNow, const Timeouts& timeouts = {})
+    {
+        if (Seen(signals.iPhotoModeLastSeen, iNow, timeouts.iPhotoModeMs))
+            return State::PhotoMode;
+        if (signals.bMovie)
+            return State::Movie;
+        if (Seen(signals.iCutsceneLastSeen, iNow, timeouts.iCutsceneMs))
+            return State::Cutscene;
+        if (Seen(signals.iCombatLastSeen, iNow, timeouts.iCombatMs))
+            return State::Combat;
+        return State::Gameplay;
+    }
+
+    struct Profile
+    {
+        int iMinDynRes = 50;
+        int iMaxDynRes = 95;
+        float fLODMulti = 1.00f;
+    };
+
+    struct Transition
+    {
+        State eFrom;
+        State eTo;
+        uint64_t iDurationMs; // Time spent in eFrom
+    };
+
+    class Tracker
+    {
+    public:
+        Tracker() { pActive.store(&profiles[0], std::memory_order_relaxed); }
+
+        // Before the hooks are installed only
+        void SetProfile(State eState, const Profile& profile) { profiles[(size_t)eState] = profile; }
+        const Profile& GetProfile(State eState) const { return profiles[(size_t)eState]; }
+
+        template<typename F>
+        bool AnyProfile(F predicate) const
+        {
+            for (const auto& profile : profiles) {
+                if (predicate(profile))
+                    return true;
+            }
+            return false;
+        }
+
+        // Only one thread may call this. Returns true with `transition` filled in if the state changed.
+        bool Update(const Signals& signals, uint64_t iNow, Transition& transition)
+        {
+            State eNew = Classify(signals, iNow, timeouts);
+            State eOld = eState.load(std::memory_order_relaxed);
+            if (iEnteredAt == 0)
+                iEnteredAt = iNow;
+            if (eNew == eOld)
+                return false;
+
+            pActive.store(&profiles[(size_t)eNew], std::memory_order_release);
+            eState.store(eNew, std::memory_order_relaxed);
+            transition = { eOld, eNew, iNow - iEnteredAt };
+            iEnteredAt = iNow;
+            return true;
+        }
+
+        const Profile& Active() const { return *pActive.load(std::memory_order_acquire); }
+        State Current() const { return eState.load(std::memory_order_relaxed); }
+
+    private:
+        std::array<Profile, kStateCount> profiles{};
+        std::atomic<const Profile*> pActive;
+        std::atomic<State> eState = State::Gameplay;
+        Timeouts timeouts;
+        uint64_t iEnteredAt = 0;
+    };
+}
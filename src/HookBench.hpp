@@ -0,0 +1,98 @@
+#pragma once
+
+#include <safetyhook.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+// Hook overhead benchmark.
+// Hooks a small generated function shaped like the hook sites in the game (an AVX instruction with a RIP-relative load
+// in the stolen bytes) and measures the cost of a call through each kind of hook in TSC cycles. Doesn't allocate the
+// code or pin the thread itself, the fix (HookBenchmark() in dllmain.cpp) and bench/bench_hooks.cpp do that for their
+// platform.
+namespace HookBench
+{
+    // vmovss xmm0, [rip+0x38] ; vaddss xmm0, xmm0, xmm0 ; ret ... 1.0f at +0x40
+    constexpr std::uint8_t kSyntheticCode[] = {
+        0xC5, 0xFA, 0x10, 0x05, 0x38, 0x00, 0x00, 0x00,
+        0xC5, 0xFA, 0x58, 0xC0,
+        0xC3,
+    };
+    constexpr size_t kConstantOffset = 0x40;
+    constexpr size_t kCodeSize = 0x1000;
+
+    using SyntheticFn = float (*)();
+    using Results = std::vector<std::pair<const char*, double>>;
+
+    inline SafetyHookInline InlineHook{};
+
+    inline float InlineCall() { return InlineHook.call<float>(); }
+    inline float InlineFastcall() { return InlineHook.fastcall<float>(); }
+    inline float InlineUnsafeCall() { return InlineHook.unsafe_call<float>(); }
+
+    // Best of several runs, in cycles per call
+    inline double Measure(SyntheticFn fn, int iIterations)
+    {
+        double dBest = 0.0;
+        for (int run = 0; run < 5; run++) {
+            volatile float fResult = 0.0f;
+            std::uint64_t iStart = __rdtsc();
+            for (int i = 0; i < iIterations; i++)
+                fResult = fn();
+            std::uint64_t iEnd = __rdtsc();
+            (void)fResult;
+
+            double dCycles = (double)(iEnd - iStart) / iIterations;
+            if (run == 0 || dCycles < dBest)
+                dBest = dCycles;
+        }
+        return dBest;
+    }
+
+    // Writes the synthetic function to `code` (kCodeSize bytes, writable and executable) and times a plain call and a
+    // call through each kind of hook, baseline first. Hooks that can't be created are passed to fnError and left out.
+    inline Results RunVariants(std::uint8_t* code, int iIterations, void (*fnError)(const char* sName))
+    {
+        memcpy(code, kSyntheticCode, sizeof(kSyntheticCode));
+        float fConstant = 1.0f;
+        memcpy(code + kConstantOffset, &fConstant, sizeof(fConstant));
+        auto fn = reinterpret_cast<SyntheticFn>(code);
+
+        Results results;
+        results.emplace_back("baseline", Measure(fn, iIterations));
+
+        auto MeasureMid = [&](const char* sName, safetyhook::MidHookFn destination) {
+            auto hook = safetyhook::create_mid(code, destination);
+            if (!hook) {
+                fnError(sName);
+                return;
+            }
+            results.emplace_back(sName, Measure(fn, iIterations));
+        };
+        MeasureMid("mid empty", [](SafetyHookContext&) {});
+        MeasureMid("mid gpr", [](SafetyHookContext& ctx) { ctx.rcx = ctx.rax + 1; });
+        MeasureMid("mid xmm", [](SafetyHookContext& ctx) { ctx.xmm1.f32[0] = ctx.xmm0.f32[0] * 2.0f; });
+
+        auto MeasureInline = [&](const char* sName, SyntheticFn destination) {
+            InlineHook = safetyhook::create_inline(code, reinterpret_cast<void*>(destination));
+            if (!InlineHook) {
+                fnError(sName);
+                return;
+            }
+            results.emplace_back(sName, Measure(fn, iIterations));
+            InlineHook = {};
+        };
+        MeasureInline("inline call", InlineCall);
+        MeasureInline("inline fastcall", InlineFastcall);
+        MeasureInline("inline unsafe_call", InlineUnsafeCall);
+        return results;
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "AspectMath.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <safetyhook.hpp>
+
+// Mid hook callbacks that only depend on the registers, the memory around one register and the aspect ratio.
+// They live here instead of in dllmain.cpp so the hook replay tool (tools/hookreplay) can run the exact same code
+// against contexts recorded in game (see HookTrace.hpp).
+namespace HookLogic
+{
+    struct Params
+    {
+        Aspect::Layout layout;
+        float fNativeAspect;
+    };
+
+    inline void VignetteStrength(SafetyHookContext& ctx, const Params& params)
+    {
+        if (params.layout.fAspectRatio > params.fNativeAspect) {
+            if (ctx.r15 + 0x6C) {
+                *reinterpret_cast<float*>(ctx.r15 + 0x6C) = 1.00f / params.layout.fAspectMultiplier;
+            }
+        }
+    }
+
+    inline void HUDSize(SafetyHookContext& ctx, const Params&)
+    {
+        // Make the hud size the same as the current resolution
+        ctx.r12 = ctx.rdi;
+        ctx.r15 = ctx.rbp;
+
+        // Pillarboxing/letterboxing
+        ctx.r13 = 0;
+        ctx.rax = 0; // -> [rsp+40]
+
+        if (ctx.rsp + 0x40) {
+            *reinterpret_cast<int*>(ctx.rsp + 0x40) = 0;
+        }
+    }
+
+    inline void PhotoModeBlur(SafetyHookContext& ctx, const Params&)
+    {
+        if (ctx.rcx + 0x40) {
+            // Check size, should be 660x1080
+            if ((*reinterpret_cast<int*>(ctx.rcx + 0x40) >= 655 && *reinterpret_cast<int*>(ctx.rcx + 0x40) <= 665) && (*reinterpret_cast<int*>(ctx.rcx + 0x44) >= 1075 && *reinterpret_cast<int*>(ctx.rcx + 0x44) <= 1085)) {
+                // Check horizontal position
+                if ((*reinterpret_cast<float*>(ctx.rcx + 0xB0) >= -675.00f && *reinterpret_cast<float*>(ctx.rcx + 0xB0) <= -665.00f) || (*reinterpret_cast<float*>(ctx.rcx + 0xB0) >= 1925.00f && *reinterpret_cast<float*>(ctx.rcx + 0xB0) <= 1935.00f)) {
+                    // Write 0 to width
+                    *reinterpret_cast<int*>(ctx.rcx + 0x40) = 0;
+                }
+            }
+        }
+    }
+
+    inline void Fades(SafetyHookContext& ctx, const Params& params)
+    {
+        float fAspectRatio = params.layout.fAspectRatio;
+
+        // Fade to black is 1940x1100. TODO: Add another check here?
+        if (ctx.rdx == (int)1940 && ctx.r8 == (int)1100) {
+            if (ctx.rcx + 0x38 && ctx.rcx + 0x3C) {
+                if (fAspectRatio > params.fNativeAspect) {
+                    float fWidth = ceilf(1080.00f * fAspectRatio);
+                    float fWidthOffset = ceilf((fWidth - 1920.00f) / 2);
+
+                    ctx.rdx = (int)fWidth;
+                    *reinterpret_cast<int*>(ctx.rcx + 0x38) = (int)-fWidthOffset;
+                }
+                else if (fAspectRatio < params.fNativeAspect) {
+                    float fHeight = ceilf(1920.00f / fAspectRatio);
+                    float fHeightOffset = ceilf((fHeight - 1080.00f) / 2);
+
+                    ctx.r8 = (int)fHeight;
+                    *reinterpret_cast<int*>(ctx.rcx + 0x3C) = (int)-fHeightOffset;
+                }
+            }
+        }
+    }
+
+    enum class Hook : uint16_t
+    {
+        VignetteStrength,
+        HUDSize,
+        PhotoModeBlur,
+        Fades,
+        Count,
+    };
+
+    constexpr size_t kHookCount = (size_t)Hook::Count;
+
+    // Memory a callback reads or writes, [register + iOffset, register + iOffset + iSize) when it's called
+    struct Window
+    {
+        size_t iRegister; // offsetof(SafetyHookContext, <register>)
+        uint32_t iOffset;
+        uint32_t iSize;
+    };
+
+    struct Site
+    {
+        const char* sName;
+        void (*fn)(SafetyHookContext&, const Params&);
+        Window window;
+    };
+
+    // Same order as Hook
+    inline const Site kSites[kHookCount] = {
+        { "Vignette Strength", VignetteStrength, { offsetof(SafetyHookContext, r15), 0x6C, 0x4 } },
+        { "HUD Size", HUDSize, { offsetof(SafetyHookContext, rsp), 0x40, 0x4 } },
+        { "Photo Mode Blur", PhotoModeBlur, { offsetof(SafetyHookContext, rcx), 0x40, 0xB4 - 0x40 } },
+        { "Fades", Fades, { offsetof(SafetyHookContext, rcx), 0x38, 0x8 } },
+    };
+
+    inline uintptr_t& Register(SafetyHookContext& ctx, size_t iRegister)
+    {
+        return *reinterpret_cast<uintptr_t*>(reinterpret_cast<uint8_t*>(&ctx) + iRegister);
+    }
+
+    inline uintptr_t Register(const SafetyHookContext& ctx, size_t iRegister)
+    {
+        return *reinterpret_cast<const uintptr_t*>(reinterpret_cast<const uint8_t*>(&ctx) + iRegister);
+    }
+}
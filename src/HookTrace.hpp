@@ -0,0 +1,249 @@
+#pragma once
+
+#include "HookLogic.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// Hook trace, the inputs and outputs of HookLogic callbacks recorded in game for replaying outside of it.
+// A call record holds the context before and after the callback and the callback's memory window before and after,
+// so the replay tool can run the callback again and check it comes out the same. Aspect ratio changes are recorded as
+// they happen since every callback after them depends on them.
+//
+// File: FileHeader, then records, each a RecordKind byte followed by
+//   Params: HookLogic::Params
+//   Call:   u16 hook, u8 captured (window was readable), context before, context after,
+//           u32 window size, window before, window after (only if captured)
+// Everything little endian and copied as is, the tool is expected to be built for x64 like the fix.
+namespace HookTrace
+{
+    constexpr uint32_t kMagic = 0x54485846; // "FXHT"
+    constexpr uint32_t kVersion = 1;
+
+    struct FileHeader
+    {
+        uint32_t iMagic;
+        uint32_t iVersion;
+        uint32_t iContextSize;
+        uint32_t iParamsSize;
+    };
+
+    enum class RecordKind : uint8_t
+    {
+        Params = 1,
+        Call = 2,
+    };
+
+    struct Call
+    {
+        HookLogic::Hook eHook;
+        bool bCaptured = false;
+        SafetyHookContext before;
+        SafetyHookContext after;
+        std::vector<uint8_t> vMemoryBefore;
+        std::vector<uint8_t> vMemoryAfter;
+    };
+
+    namespace Detail
+    {
+        template<typename T>
+        void Append(std::vector<uint8_t>& out, const T& value)
+        {
+            auto bytes = reinterpret_cast<const uint8_t*>(&value);
+            out.insert(out.end(), bytes, bytes + sizeof(T));
+        }
+
+        inline void AppendBytes(std::vector<uint8_t>& out, const std::vector<uint8_t>& bytes)
+        {
+            out.insert(out.end(), bytes.begin(), bytes.end());
+        }
+    }
+
+    inline void EncodeHeader(std::vector<uint8_t>& out)
+    {
+        Detail::Append(out, FileHeader{ kMagic, kVersion, (uint32_t)sizeof(SafetyHookContext), (uint32_t)sizeof(HookLogic::Params) });
+    }
+
+    inline void EncodeParams(std::vector<uint8_t>& out, const HookLogic::Params& params)
+    {
+        Detail::Append(out, RecordKind::Params);
+        Detail::Append(out, params);
+    }
+
+    inline void EncodeCall(std::vector<uint8_t>& out, const Call& call)
+    {
+        Detail::Append(out, RecordKind::Call);
+        Detail::Append(out, (uint16_t)call.eHook);
+        Detail::Append(out, (uint8_t)call.bCaptured);
+        Detail::Append(out, call.before);
+        Detail::Append(out, call.after);
+        if (call.bCaptured) {
+            Detail::Append(out, (uint32_t)call.vMemoryBefore.size());
+            Detail::AppendBytes(out, call.vMemoryBefore);
+            Detail::AppendBytes(out, call.vMemoryAfter);
+        }
+    }
+
+    class Reader
+    {
+    public:
+        bool Open(const uint8_t* data, size_t size)
+        {
+            FileHeader header;
+            begin = data;
+            end = data + size;
+            if (!Read(header))
+                return false;
+            return header.iMagic == kMagic && header.iVersion == kVersion && header.iContextSize == sizeof(SafetyHookContext) &&
+                header.iParamsSize == sizeof(HookLogic::Params);
+        }
+
+        // False at the end of the trace or on a damaged record, fills in params or call depending on kind
+        bool Next(RecordKind& kind, HookLogic::Params& params, Call& call)
+        {
+            if (!Read(kind))
+                return false;
+            if (kind == RecordKind::Params)
+                return Read(params);
+            if (kind != RecordKind::Call)
+                return false;
+
+            uint16_t iHook;
+            uint8_t iCaptured;
+            if (!Read(iHook) || !Read(iCaptured) || iHook >= HookLogic::kHookCount || !Read(call.before) || !Read(call.after))
+                return false;
+            call.eHook = (HookLogic::Hook)iHook;
+            call.bCaptured = iCaptured != 0;
+            call.vMemoryBefore.clear();
+            call.vMemoryAfter.clear();
+            if (!call.bCaptured)
+                return true;
+
+            uint32_t iSize;
+            if (!Read(iSize) || iSize != HookLogic::kSites[iHook].window.iSize || (size_t)(end - begin) < 2ull * iSize)
+                return false;
+            call.vMemoryBefore.assign(begin, begin + iSize);
+            call.vMemoryAfter.assign(begin + iSize, begin + 2 * iSize);
+            begin += 2 * iSize;
+            return true;
+        }
+
+    private:
+        const uint8_t* begin = nullptr;
+        const uint8_t* end = nullptr;
+
+        template<typename T>
+        bool Read(T& value)
+        {
+            if ((size_t)(end - begin) < sizeof(T))
+                return false;
+            memcpy(&value, begin, sizeof(T));
+            begin += sizeof(T);
+            return true;
+        }
+    };
+
+    // Records up to iMaxCalls calls of each hook, then just runs them
+    class Recorder
+    {
+    public:
+        void Start(size_t iMaxCallsPerHook, const HookLogic::Params& params)
+        {
+            std::scoped_lock lock(mutex);
+            iMaxCalls = iMaxCallsPerHook;
+            EncodeHeader(buffer);
+            EncodeParams(buffer, params);
+            bActive.store(true, std::memory_order_release);
+        }
+
+        bool IsActive() const { return bActive.load(std::memory_order_acquire); }
+
+        void SetParams(const HookLogic::Params& params)
+        {
+            if (!IsActive())
+                return;
+            std::scoped_lock lock(mutex);
+            EncodeParams(buffer, params);
+        }
+
+        // `copy(destination, source, size)` returns false if source isn't readable, the window is left out then
+        template<typename F>
+        void Run(HookLogic::Hook eHook, SafetyHookContext& ctx, const HookLogic::Params& params, F copy)
+        {
+            const HookLogic::Site& site = HookLogic::kSites[(size_t)eHook];
+            if (!IsActive() || iRecorded[(size_t)eHook].fetch_add(1, std::memory_order_relaxed) >= iMaxCalls) {
+                site.fn(ctx, params);
+                return;
+            }
+
+            Call call;
+            call.eHook = eHook;
+            call.before = ctx;
+            uintptr_t window = HookLogic::Register(ctx, site.window.iRegister) + site.window.iOffset;
+            call.vMemoryBefore.resize(site.window.iSize);
+            call.bCaptured = copy(call.vMemoryBefore.data(), reinterpret_cast<const void*>(window), call.vMemoryBefore.size());
+
+            site.fn(ctx, params);
+
+            call.after = ctx;
+            if (call.bCaptured) {
+                call.vMemoryAfter.resize(site.window.iSize);
+                call.bCaptured = copy(call.vMemoryAfter.data(), reinterpret_cast<const void*>(window), call.vMemoryAfter.size());
+            }
+
+            std::scoped_lock lock(mutex);
+            EncodeCall(buffer, call);
+        }
+
+        // Hands what was recorded since the last call to `write(data, size)`
+        template<typename F>
+        void Drain(F write)
+        {
+            std::vector<uint8_t> pending;
+            {
+                std::scoped_lock lock(mutex);
+                pending.swap(buffer);
+            }
+            if (!pending.empty())
+                write(pending.data(), pending.size());
+        }
+
+    private:
+        std::atomic<bool> bActive = false;
+        size_t iMaxCalls = 0;
+        std::atomic<size_t> iRecorded[HookLogic::kHookCount] = {};
+        std::mutex mutex;
+        std::vector<uint8_t> buffer;
+    };
+
+    // Runs a recorded call again. The window register is pointed at `memory` (holding the recorded window) while the
+    // callback runs. True if the registers and the window came out the same as in game.
+    inline bool Replay(const Call& call, const HookLogic::Params& params, SafetyHookContext& ctx, std::vector<uint8_t>& memory)
+    {
+        const HookLogic::Site& site = HookLogic::kSites[(size_t)call.eHook];
+        ctx = call.before;
+
+        // Unreadable in game means the callback didn't touch it there either (or it would have crashed), zeroes will do
+        if (call.bCaptured)
+            memory.assign(call.vMemoryBefore.begin(), call.vMemoryBefore.end());
+        else
+            memory.assign(site.window.iSize, 0);
+
+        uintptr_t& reg = HookLogic::Register(ctx, site.window.iRegister);
+        uintptr_t original = reg;
+        uintptr_t rebased = reinterpret_cast<uintptr_t>(memory.data()) - site.window.iOffset;
+        reg = rebased;
+
+        site.fn(ctx, params);
+
+        if (reg == rebased)
+            reg = original;
+        bool bSame = memcmp(&ctx, &call.after, sizeof(SafetyHookContext)) == 0;
+        if (call.bCaptured)
+            bSame = bSame && memory == call.vMemoryAfter;
+        return bSame;
+    }
+}
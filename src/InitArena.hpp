@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+// Startup allocations.
+// Scratch memory that only lives during startup (parsed signatures and the like) comes from one block handed out by a
+// bump pointer and is given back in one go once startup is done, instead of being mixed in with the game's own boot
+// allocations on the heap. The block itself comes from the caller (dllmain.cpp), nothing in here touches the OS.
+namespace InitArena
+{
+    // Safe to allocate from several threads. Deallocating is a no-op, Reset() frees everything at once.
+    // Requests that don't fit in the block go to the upstream resource.
+    class Arena : public std::pmr::memory_resource
+    {
+    public:
+        Arena(void* buffer, size_t size, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+            : base(static_cast<uint8_t*>(buffer)), iCapacity(size), upstream(upstream)
+        {
+        }
+
+        size_t Used() const { return iUsed.load(std::memory_order_relaxed); }
+        size_t Capacity() const { return iCapacity; }
+        size_t Overflows() const { return iOverflows.load(std::memory_order_relaxed); }
+
+        bool Owns(const void* p) const
+        {
+            auto address = static_cast<const uint8_t*>(p);
+            return address >= base && address < base + iCapacity;
+        }
+
+        // Only once nothing allocated from the arena is alive any more
+        void Reset() { iUsed.store(0, std::memory_order_relaxed); }
+
+    private:
+        uint8_t* base;
+        size_t iCapacity;
+        std::pmr::memory_resource* upstream;
+        std::atomic<size_t> iUsed = 0;
+        std::atomic<size_t> iOverflows = 0;
+
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            size_t iCurrent = iUsed.load(std::memory_order_relaxed);
+            while (true) {
+                uintptr_t start = ((uintptr_t)base + iCurrent + alignment - 1) & ~(uintptr_t)(alignment - 1);
+                size_t iEnd = (size_t)(start - (uintptr_t)base) + bytes;
+                if (iEnd > iCapacity) {
+                    iOverflows.fetch_add(1, std::memory_order_relaxed);
+                    return upstream->allocate(bytes, alignment);
+                }
+                if (iUsed.compare_exchange_weak(iCurrent, iEnd, std::memory_order_relaxed))
+                    return reinterpret_cast<void*>(start);
+            }
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override
+        {
+            if (!Owns(p))
+                upstream->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    // What startup code should allocate scratch memory from, the default resource when there's no arena (any more)
+    inline std::atomic<std::pmr::memory_resource*> pResource = nullptr;
+
+    inline std::pmr::memory_resource* Resource()
+    {
+        std::pmr::memory_resource* resource = pResource.load(std::memory_order_acquire);
+        return resource ? resource : std::pmr::get_default_resource();
+    }
+
+    // Heap allocations made by the fix while counting is on, fed by its operator new
+    struct AllocationCounter
+    {
+        std::atomic<bool> bCounting = false;
+        std::atomic<uint64_t> iCount = 0;
+        std::atomic<uint64_t> iBytes = 0;
+
+        void Add(size_t size)
+        {
+            if (!bCounting.load(std::memory_order_relaxed))
+                return;
+            iCount.fetch_add(1, std::memory_order_relaxed);
+            iBytes.fetch_add(size, std::memory_order_relaxed);
+        }
+    };
+}
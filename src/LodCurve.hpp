@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// LOD distance curve.
+// The ini gives points "distance:multiplier", the multiplier for the distances in between is interpolated linearly and
+// held flat past either end. At config load the curve is sampled into a fixed size table so the hook only does a
+// clamp, one lookup and one lerp, with no branches or searching through the points.
+namespace LodCurve
+{
+    constexpr size_t kMaxPoints = 16;
+    constexpr size_t kTableSize = 64; // Intervals, the table has one more entry
+
+    struct Point
+    {
+        float fDistance;
+        float fMultiplier;
+    };
+
+    namespace Detail
+    {
+        inline bool ParseFloat(std::string_view text, float& value)
+        {
+            try {
+                size_t iUsed = 0;
+                std::string sText(text);
+                value = std::stof(sText, &iUsed);
+                return sText.find_first_not_of(" \t", iUsed) == std::string::npos;
+            }
+            catch (const std::exception&) {
+                return false;
+            }
+        }
+    }
+
+    // "0:1, 100:1, 400:2", distances strictly increasing and not negative. Empty text is an empty curve.
+    inline bool Parse(std::string_view text, std::vector<Point>& points)
+    {
+        points.clear();
+        while (!text.empty()) {
+            size_t iComma = text.find(',');
+            std::string_view item = text.substr(0, iComma);
+            text = iComma == std::string_view::npos ? std::string_view() : text.substr(iComma + 1);
+            if (item.find_first_not_of(" \t") == std::string_view::npos)
+                continue;
+
+            size_t iColon = item.find(':');
+            Point point;
+            if (iColon == std::string_view::npos || !Detail::ParseFloat(item.substr(0, iColon), point.fDistance) ||
+                !Detail::ParseFloat(item.substr(iColon + 1), point.fMultiplier))
+                return false;
+            if (point.fDistance < 0.0f || (!points.empty() && point.fDistance <= points.back().fDistance) || points.size() == kMaxPoints)
+                return false;
+            points.push_back(point);
+        }
+        return true;
+    }
+
+    // Exact value of the curve, used to fill the table
+    inline float Interpolate(const std::vector<Point>& points, float fDistance)
+    {
+        if (points.empty())
+            return 1.0f;
+        if (fDistance <= points.front().fDistance)
+            return points.front().fMultiplier;
+        for (size_t i = 1; i < points.size(); i++) {
+            if (fDistance <= points[i].fDistance) {
+                const Point& a = points[i - 1];
+                const Point& b = points[i];
+                float t = (fDistance - a.fDistance) / (b.fDistance - a.fDistance);
+                return a.fMultiplier + (b.fMultiplier - a.fMultiplier) * t;
+            }
+        }
+        return points.back().fMultiplier;
+    }
+
+    struct Table
+    {
+        float fInvStep = 0.0f; // Table entries per unit of distance
+        std::array<float, kTableSize + 1> fValues{};
+
+        // Multiplier for a distance. NaN and negative distances get the first entry.
+        float Evaluate(float fDistance) const
+        {
+            float x = std::min(std::max(0.0f, fDistance * fInvStep), (float)kTableSize);
+            size_t i = std::min((size_t)x, kTableSize - 1);
+            float t = x - (float)i;
+            return fValues[i] + (fValues[i + 1] - fValues[i]) * t;
+        }
+    };
+
+    // Samples the curve from 0 to its last point. Points that fall between two entries are rounded off by the lerp,
+    // the error is at most the slope change times half an entry (last distance / 128).
+    inline Table Compile(const std::vector<Point>& points)
+    {
+        Table table;
+        float fEnd = points.empty() ? 0.0f : points.back().fDistance;
+        table.fInvStep = fEnd > 0.0f ? kTableSize / fEnd : 0.0f;
+        for (size_t i = 0; i <= kTableSize; i++)
+            table.fValues[i] = Interpolate(points, fEnd * i / kTableSize);
+        return table;
+    }
+}
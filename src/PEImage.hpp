@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// PE header parsing over a byte buffer, either a mapped module or a file read from disk.
+// Only PE32+ is handled, that's all the game ships.
+namespace PE
+{
+    constexpr uint32_t kSectionExecute = 0x20000000; // IMAGE_SCN_MEM_EXECUTE
+    constexpr uint32_t kSectionCode = 0x00000020;    // IMAGE_SCN_CNT_CODE
+
+    struct Section
+    {
+        std::string sName;
+        uint32_t iVirtualAddress;
+        uint32_t iVirtualSize;
+        uint32_t iRawOffset;
+        uint32_t iRawSize;
+        uint32_t iCharacteristics;
+
+        bool IsCode() const { return (iCharacteristics & (kSectionExecute | kSectionCode)) != 0; }
+    };
+
+    struct Image
+    {
+        uint32_t iTimestamp = 0;
+        uint32_t iSizeOfImage = 0;
+        uint32_t iSizeOfHeaders = 0;
+        std::vector<Section> vSections;
+    };
+
+    namespace Detail
+    {
+        template<typename T>
+        bool Read(const uint8_t* data, size_t size, size_t offset, T& out)
+        {
+            if (offset > size || sizeof(T) > size - offset)
+                return false;
+            memcpy(&out, data + offset, sizeof(T));
+            return true;
+        }
+    }
+
+    // `size` is how much of `data` is readable, the headers have to fit inside it.
+    inline bool Parse(const uint8_t* data, size_t size, Image& image)
+    {
+        using Detail::Read;
+
+        uint16_t iDosMagic = 0;
+        uint32_t iNtOffset = 0;
+        if (!Read(data, size, 0x00, iDosMagic) || iDosMagic != 0x5A4D || !Read(data, size, 0x3C, iNtOffset))
+            return false;
+
+        uint32_t iNtMagic = 0;
+        uint16_t iSectionCount = 0, iOptionalSize = 0, iOptionalMagic = 0;
+        if (!Read(data, size, iNtOffset, iNtMagic) || iNtMagic != 0x00004550)
+            return false;
+
+        // IMAGE_FILE_HEADER follows the signature, IMAGE_OPTIONAL_HEADER64 follows that
+        size_t iFileHeader = (size_t)iNtOffset + 4;
+        size_t iOptional = iFileHeader + 20;
+        if (!Read(data, size, iFileHeader + 2, iSectionCount) || !Read(data, size, iFileHeader + 4, image.iTimestamp) ||
+            !Read(data, size, iFileHeader + 16, iOptionalSize) || !Read(data, size, iOptional, iOptionalMagic) || iOptionalMagic != 0x20B)
+            return false;
+
+        if (!Read(data, size, iOptional + 56, image.iSizeOfImage) || !Read(data, size, iOptional + 60, image.iSizeOfHeaders))
+            return false;
+
+        image.vSections.clear();
+        size_t iSectionTable = iOptional + iOptionalSize;
+        for (uint16_t i = 0; i < iSectionCount; i++) {
+            size_t iEntry = iSectionTable + (size_t)i * 40;
+            char name[9] = {};
+            Section section{};
+            if (iEntry > size || 40 > size - iEntry)
+                return false;
+            memcpy(name, data + iEntry, 8);
+            Read(data, size, iEntry + 8, section.iVirtualSize);
+            Read(data, size, iEntry + 12, section.iVirtualAddress);
+            Read(data, size, iEntry + 16, section.iRawSize);
+            Read(data, size, iEntry + 20, section.iRawOffset);
+            Read(data, size, iEntry + 36, section.iCharacteristics);
+            section.sName = name;
+            image.vSections.push_back(std::move(section));
+        }
+        return true;
+    }
+}
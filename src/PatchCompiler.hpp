@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Code for constant patches.
+// A mid hook that only sets or scales the low float of an xmm register costs a full context save per call, even though
+// the value only changes with the resolution or config. These build the same thing out of a RIP-relative access to a
+// fix-owned slot instead, so updating the value is a 4 byte store and the game's code never leaves its own path (Load)
+// or only takes a jump out and back (Set/Multiply). Instruction decoding and writing the code is left to helper.hpp.
+namespace Patch
+{
+    enum class Op
+    {
+        Load,     // The instruction is "vmovss xmmN, [mem]", load from the slot instead. Rewritten in place.
+        Set,      // Low float of xmmN = slot before the instruction runs, the rest of the register is kept
+        Multiply, // Low float of xmmN *= slot before the instruction runs
+    };
+
+    // What the caller's decoder found out about an instruction being moved
+    struct Instruction
+    {
+        size_t iLength = 0;
+        bool bRipRelative = false;    // Has a [rip+disp32] operand
+        size_t iDispOffset = 0;       // Offset of that disp32
+        bool bRelativeBranch = false; // jmp/jcc/call rel, these aren't moved
+    };
+
+    constexpr size_t kJmpSize = 5;
+    constexpr size_t kLoadSize = 8;
+
+    namespace Detail
+    {
+        inline bool FitsRel32(int64_t value) { return value >= INT32_MIN && value <= INT32_MAX; }
+
+        inline void Append32(std::vector<uint8_t>& code, int32_t value)
+        {
+            uint8_t bytes[4];
+            memcpy(bytes, &value, sizeof(bytes));
+            code.insert(code.end(), bytes, bytes + sizeof(bytes));
+        }
+    }
+
+    // Appends the slot access for `op` to code, which starts at `base` once it's written.
+    //   Load:     vmovss xmmN, [rip+slot]
+    //   Set:      vinsertps xmmN, xmmN, [rip+slot], 0
+    //   Multiply: vmulss xmmN, xmmN, [rip+slot]
+    inline bool EmitSlotOp(std::vector<uint8_t>& code, uint64_t base, Op op, int iXmm, uint64_t slot)
+    {
+        const uint8_t vexR = iXmm < 8 ? 0x80 : 0x00;              // Inverted REX.R
+        const uint8_t vvvv = (uint8_t)((~iXmm & 0xF) << 3);       // Inverted first source
+        const uint8_t modrm = (uint8_t)(((iXmm & 7) << 3) | 0x05); // reg = xmmN, rm = [rip+disp32]
+
+        size_t iStart = code.size();
+        switch (op) {
+        case Op::Load: code.insert(code.end(), { 0xC5, (uint8_t)(vexR | 0x78 | 0x02), 0x10, modrm }); break;
+        case Op::Set: code.insert(code.end(), { 0xC4, (uint8_t)(vexR | 0x60 | 0x03), (uint8_t)(vvvv | 0x01), 0x21, modrm }); break;
+        case Op::Multiply: code.insert(code.end(), { 0xC5, (uint8_t)(vexR | vvvv | 0x02), 0x59, modrm }); break;
+        }
+
+        size_t iTrailing = op == Op::Set ? 1 : 0; // imm8
+        uint64_t next = base + code.size() + 4 + iTrailing;
+        int64_t disp = (int64_t)(slot - next);
+        if (!Detail::FitsRel32(disp)) {
+            code.resize(iStart);
+            return false;
+        }
+        Detail::Append32(code, (int32_t)disp);
+        if (op == Op::Set)
+            code.push_back(0x00);
+        return true;
+    }
+
+    inline bool EmitJmp(std::vector<uint8_t>& code, uint64_t base, uint64_t target)
+    {
+        int64_t rel = (int64_t)(target - (base + code.size() + kJmpSize));
+        if (!Detail::FitsRel32(rel))
+            return false;
+        code.push_back(0xE9);
+        Detail::Append32(code, (int32_t)rel);
+        return true;
+    }
+
+    // Copies an instruction from `address` to the end of code, fixing up its RIP-relative operand
+    inline bool EmitRelocated(std::vector<uint8_t>& code, uint64_t base, const uint8_t* original, uint64_t address, const Instruction& instruction)
+    {
+        if (instruction.bRelativeBranch)
+            return false;
+
+        size_t iStart = code.size();
+        uint64_t at = base + iStart;
+        code.insert(code.end(), original, original + instruction.iLength);
+        if (instruction.bRipRelative) {
+            int32_t disp;
+            memcpy(&disp, original + instruction.iDispOffset, sizeof(disp));
+            uint64_t target = address + instruction.iLength + disp;
+            int64_t newDisp = (int64_t)(target - (at + instruction.iLength));
+            if (!Detail::FitsRel32(newDisp)) {
+                code.resize(iStart);
+                return false;
+            }
+            int32_t disp32 = (int32_t)newDisp;
+            memcpy(code.data() + iStart + instruction.iDispOffset, &disp32, sizeof(disp32));
+        }
+        return true;
+    }
+
+    // Load: `patch` replaces the instruction at `address` (at least kLoadSize bytes, NOP padded).
+    inline bool CompileLoad(uint64_t address, const Instruction& instruction, int iXmm, uint64_t slot, std::vector<uint8_t>& patch)
+    {
+        patch.clear();
+        if (instruction.iLength < kLoadSize || !EmitSlotOp(patch, address, Op::Load, iXmm, slot))
+            return false;
+        patch.resize(instruction.iLength, 0x90);
+        return true;
+    }
+
+    // Set/Multiply: `detour` is placed at `detourAddress` and runs the slot op, the stolen instructions and jumps back.
+    // `patch` replaces the stolen instructions with a jump to the detour (NOP padded).
+    inline bool CompileDetour(Op op, int iXmm, uint64_t slot, const uint8_t* original, uint64_t address, const std::vector<Instruction>& stolen,
+        uint64_t detourAddress, std::vector<uint8_t>& detour, std::vector<uint8_t>& patch)
+    {
+        detour.clear();
+        patch.clear();
+        if (op == Op::Load || !EmitSlotOp(detour, detourAddress, op, iXmm, slot))
+            return false;
+
+        size_t iStolen = 0;
+        for (const auto& instruction : stolen) {
+            if (!EmitRelocated(detour, detourAddress, original + iStolen, address + iStolen, instruction))
+                return false;
+            iStolen += instruction.iLength;
+        }
+        if (iStolen < kJmpSize || !EmitJmp(detour, detourAddress, address + iStolen))
+            return false;
+
+        if (!EmitJmp(patch, address, detourAddress))
+            return false;
+        patch.resize(iStolen, 0x90);
+        return true;
+    }
+}
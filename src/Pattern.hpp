@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+// Signature parsing and matching over plain byte buffers. The OS side (which module, which memory) lives in helper.hpp.
+namespace Pattern
+{
+    struct Signature
+    {
+        std::pmr::vector<uint8_t> bytes; // 0 where the mask is 0
+        std::pmr::vector<uint8_t> mask;  // 0xFF = literal, 0x00 = wildcard
+
+        Signature() = default;
+        explicit Signature(std::pmr::memory_resource* resource) : bytes(resource), mask(resource) {}
+
+        size_t Size() const { return bytes.size(); }
+        bool IsLiteral(size_t i) const { return mask[i] != 0; }
+    };
+
+    // "48 8B ?? ?? 05", "?" and "??" are wildcards
+    inline Signature Parse(std::string_view text, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    {
+        Signature signature(resource);
+        signature.bytes.reserve(text.size() / 3 + 1);
+        signature.mask.reserve(text.size() / 3 + 1);
+        size_t i = 0;
+        while (i < text.size()) {
+            if (text[i] == '?') {
+                i += (i + 1 < text.size() && text[i + 1] == '?') ? 2 : 1;
+                signature.bytes.push_back(0);
+                signature.mask.push_back(0);
+                continue;
+            }
+
+            if (!isxdigit((unsigned char)text[i])) {
+                i++;
+                continue;
+            }
+
+            unsigned int value = 0;
+            for (; i < text.size() && isxdigit((unsigned char)text[i]); i++) {
+                char c = (char)tolower((unsigned char)text[i]);
+                value = value * 16 + (c <= '9' ? c - '0' : c - 'a' + 10);
+            }
+            signature.bytes.push_back((uint8_t)value);
+            signature.mask.push_back(0xFF);
+        }
+        return signature;
+    }
+
+    inline bool Matches(const uint8_t* address, const uint8_t* bytes, const uint8_t* mask, size_t length)
+    {
+        for (size_t j = 0; j < length; ++j) {
+            if ((address[j] & mask[j]) != bytes[j])
+                return false;
+        }
+        return true;
+    }
+
+    // First match in data, nullptr if there is none
+    inline const uint8_t* Find(const uint8_t* data, size_t size, const uint8_t* bytes, const uint8_t* mask, size_t length)
+    {
+        if (length == 0 || length > size)
+            return nullptr;
+
+        for (size_t i = 0; i + length <= size; ++i) {
+            if (Matches(data + i, bytes, mask, length))
+                return data + i;
+        }
+        return nullptr;
+    }
+
+    inline const uint8_t* Find(const uint8_t* data, size_t size, const Signature& signature)
+    {
+        return Find(data, size, signature.bytes.data(), signature.mask.data(), signature.Size());
+    }
+
+    // Byte and adjacent byte pair counts of a code section, used to pick which byte of a signature to search for.
+    struct ByteHistogram
+    {
+        uint64_t iSingles[256] = {};
+        std::pmr::vector<uint32_t> vPairs;
+
+        explicit ByteHistogram(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : vPairs(65536, resource) {}
+
+        void Add(const uint8_t* data, size_t size)
+        {
+            if (size == 0)
+                return;
+            for (size_t i = 0; i + 1 < size; i++) {
+                iSingles[data[i]]++;
+                vPairs[(data[i] << 8) | data[i + 1]]++;
+            }
+            iSingles[data[size - 1]]++;
+        }
+
+        uint64_t Single(uint8_t a) const { return iSingles[a]; }
+        uint64_t Pair(uint8_t a, uint8_t b) const { return vPairs[(a << 8) | b]; }
+    };
+
+    // Rarest literal byte or adjacent pair in a signature. The scan memchr()s for iByte and only compares the rest of
+    // the signature where it's found.
+    struct Anchor
+    {
+        bool bValid = false;
+        size_t iOffset = 0;            // Offset of iByte in the signature
+        uint8_t iByte = 0;
+        size_t iPairOffset = SIZE_MAX; // Other byte of the pair, checked before the full compare
+        uint64_t iCandidates = 0;      // Expected number of places the full compare runs
+    };
+
+    inline Anchor ChooseAnchor(const Signature& signature, const ByteHistogram& histogram)
+    {
+        Anchor anchor;
+        for (size_t i = 0; i < signature.Size(); i++) {
+            if (!signature.IsLiteral(i))
+                continue;
+
+            uint64_t iCount = histogram.Single(signature.bytes[i]);
+            if (!anchor.bValid || iCount < anchor.iCandidates) {
+                anchor = { true, i, signature.bytes[i], SIZE_MAX, iCount };
+            }
+        }
+
+        for (size_t i = 0; i + 1 < signature.Size(); i++) {
+            if (!signature.IsLiteral(i) || !signature.IsLiteral(i + 1))
+                continue;
+
+            uint8_t a = signature.bytes[i], b = signature.bytes[i + 1];
+            uint64_t iCount = histogram.Pair(a, b);
+            if (iCount < anchor.iCandidates) {
+                // Search for the rarer half, check the other
+                bool bFirst = histogram.Single(a) <= histogram.Single(b);
+                anchor = { true, bFirst ? i : i + 1, bFirst ? a : b, bFirst ? i + 1 : i, iCount };
+            }
+        }
+        return anchor;
+    }
+
+    inline const uint8_t* Find(const uint8_t* data, size_t size, const uint8_t* bytes, const uint8_t* mask, size_t length, const Anchor& anchor)
+    {
+        if (!anchor.bValid)
+            return Find(data, size, bytes, mask, length);
+        if (length == 0 || length > size)
+            return nullptr;
+
+        const uint8_t* p = data + anchor.iOffset;
+        const uint8_t* end = data + (size - length) + anchor.iOffset + 1; // Last place the anchor can be, plus one
+        while (p < end) {
+            p = static_cast<const uint8_t*>(memchr(p, anchor.iByte, end - p));
+            if (!p)
+                break;
+
+            const uint8_t* start = p - anchor.iOffset;
+            if ((anchor.iPairOffset == SIZE_MAX || start[anchor.iPairOffset] == bytes[anchor.iPairOffset]) && Matches(start, bytes, mask, length))
+                return start;
+            p++;
+        }
+        return nullptr;
+    }
+
+    inline const uint8_t* Find(const uint8_t* data, size_t size, const Signature& signature, const Anchor& anchor)
+    {
+        return Find(data, size, signature.bytes.data(), signature.mask.data(), signature.Size(), anchor);
+    }
+
+    // Horspool search for the longest run of literal bytes in the signature, the rest of the signature is compared
+    // wherever the run is found. Wildcards never end up in the skip table, so skips are up to the run length.
+    struct Horspool
+    {
+        size_t iRunOffset = 0;
+        size_t iRunLength = 0;
+        size_t iShift[256] = {};
+    };
+
+    inline Horspool BuildHorspool(const Signature& signature)
+    {
+        Horspool horspool;
+        for (size_t i = 0; i < signature.Size();) {
+            size_t j = i;
+            while (j < signature.Size() && signature.IsLiteral(j))
+                j++;
+            if (j - i > horspool.iRunLength) {
+                horspool.iRunOffset = i;
+                horspool.iRunLength = j - i;
+            }
+            i = j + 1;
+        }
+
+        size_t m = horspool.iRunLength;
+        for (auto& shift : horspool.iShift)
+            shift = m;
+        for (size_t i = 0; i + 1 < m; i++)
+            horspool.iShift[signature.bytes[horspool.iRunOffset + i]] = m - 1 - i;
+        return horspool;
+    }
+
+    inline const uint8_t* Find(const uint8_t* data, size_t size, const Signature& signature, const Horspool& horspool)
+    {
+        size_t length = signature.Size();
+        size_t m = horspool.iRunLength;
+        if (m == 0)
+            return Find(data, size, signature);
+        if (length == 0 || length > size)
+            return nullptr;
+
+        const uint8_t* run = signature.bytes.data() + horspool.iRunOffset;
+        const uint8_t* p = data + horspool.iRunOffset;
+        const uint8_t* last = data + (size - length) + horspool.iRunOffset; // Last place the run can start
+        while (p <= last) {
+            uint8_t c = p[m - 1];
+            if (c == run[m - 1] && memcmp(p, run, m - 1) == 0) {
+                const uint8_t* start = p - horspool.iRunOffset;
+                if (Matches(start, signature.bytes.data(), signature.mask.data(), length))
+                    return start;
+            }
+            p += horspool.iShift[c];
+        }
+        return nullptr;
+    }
+
+    enum class Strategy
+    {
+        Auto,     // Pick one of the below from the signature
+        Anchor,   // memchr() for the rarest byte, needs a ByteHistogram
+        Horspool, // Skip table over the longest literal run
+        Naive,    // Compare at every address
+    };
+
+    // Long literal runs skip far enough that Horspool wins, short runs (or mostly wildcards) are better off anchored
+    inline Strategy ChooseStrategy(const Signature& signature, const Horspool& horspool)
+    {
+        size_t iWildcards = 0;
+        for (size_t i = 0; i < signature.Size(); i++)
+            iWildcards += !signature.IsLiteral(i);
+
+        if (horspool.iRunLength >= 8)
+            return Strategy::Horspool;
+        if (horspool.iRunLength >= 5 && signature.Size() >= 16 && iWildcards * 4 < signature.Size())
+            return Strategy::Horspool;
+        return Strategy::Anchor;
+    }
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "TraceZones.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Startup task graph.
+// Features are added as tasks with dependencies and each task gets its own thread, so independent pattern scans overlap.
+// Hooks and patches are not applied from the task threads directly, they are submitted to the Installer which queues
+// them until every scan has finished and then applies them one at a time. Scans never see a half-written patch and
+// safetyhook never has two threads freezing each other.
+namespace Pipeline
+{
+    enum class Phase : size_t
+    {
+        Scan,
+        Install,
+        Wait,
+        Count
+    };
+
+    struct TaskTimes
+    {
+        double dPhaseMs[(size_t)Phase::Count] = {};
+        double dStartMs = 0.0; // Relative to the start of the graph
+        double dEndMs = 0.0;
+    };
+
+    // Times of the task running on this thread, nullptr outside of a task
+    inline thread_local TaskTimes* pThreadTimes = nullptr;
+    inline thread_local bool bThreadInPhase = false;
+
+    // Adds the time spent in this scope to the current task. Nested phases are counted once, by the outermost one.
+    class ScopedPhase
+    {
+    public:
+        explicit ScopedPhase(Phase phase) : ePhase(phase), bOuter(!bThreadInPhase), tStart(std::chrono::steady_clock::now())
+        {
+            bThreadInPhase = true;
+        }
+
+        ~ScopedPhase()
+        {
+            if (!bOuter)
+                return;
+
+            bThreadInPhase = false;
+            if (pThreadTimes)
+                pThreadTimes->dPhaseMs[(size_t)ePhase] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+        }
+
+        ScopedPhase(const ScopedPhase&) = delete;
+        ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+    private:
+        Phase ePhase;
+        bool bOuter;
+        std::chrono::steady_clock::time_point tStart;
+    };
+
+    class Installer
+    {
+    public:
+        static Installer& Get()
+        {
+            static Installer installer;
+            return installer;
+        }
+
+        // Applies the change now, or queues it if scans are still running
+        void Submit(std::function<void()> fn)
+        {
+            std::scoped_lock lock(mutex);
+            if (bDeferring) {
+                vQueue.push_back(std::move(fn));
+                return;
+            }
+
+            ScopedPhase phase(Phase::Install);
+            fn();
+        }
+
+        // Applies everything queued so far in submission order. Anything submitted afterwards is applied immediately.
+        size_t Commit()
+        {
+            std::scoped_lock lock(mutex);
+            ScopedPhase phase(Phase::Install);
+
+            std::vector<std::function<void()>> vCommit;
+            vCommit.swap(vQueue);
+            bDeferring = false;
+
+            for (auto& fn : vCommit)
+                fn();
+
+            return vCommit.size();
+        }
+
+    private:
+        std::recursive_mutex mutex;
+        std::vector<std::function<void()>> vQueue;
+        bool bDeferring = true;
+    };
+
+    class Graph
+    {
+    public:
+        enum class Kind
+        {
+            Scan,  // Pattern scans, worth a higher priority
+            Other, // Installing, or setting up something that waits on the game
+        };
+
+        struct Task
+        {
+            Task(const std::string& sName, std::function<void()> fn, Kind kind) : sName(sName), fn(std::move(fn)), eKind(kind) {}
+
+            std::string sName;
+            std::function<void()> fn;
+            Kind eKind;
+            std::vector<size_t> vDeps;
+            TaskTimes times;
+            bool bDone = false;
+        };
+
+        // Dependencies must have been added before. An unknown one is a mistake in the graph, Run() refuses to start then.
+        void Add(const std::string& sName, std::function<void()> fn, std::initializer_list<const char*> deps = {}, Kind kind = Kind::Scan)
+        {
+            Task task(sName, std::move(fn), kind);
+            for (const char* dep : deps) {
+                size_t iCount = task.vDeps.size();
+                for (size_t i = 0; i < vTasks.size(); i++) {
+                    if (vTasks[i].sName == dep)
+                        task.vDeps.push_back(i);
+                }
+                if (task.vDeps.size() == iCount && sError.empty())
+                    sError = "Task \"" + sName + "\" depends on unknown task \"" + dep + "\"";
+            }
+            vTasks.push_back(std::move(task));
+        }
+
+        // Called on every task thread before the task runs
+        void SetThreadInit(std::function<void(const Task&)> fn) { fnThreadInit = std::move(fn); }
+
+        // Runs every task as soon as its dependencies are done and returns once all of them are.
+        // Returns false without running anything if the graph is broken, see Error().
+        bool Run()
+        {
+            if (!sError.empty())
+                return false;
+
+            tStart = std::chrono::steady_clock::now();
+
+            std::vector<std::thread> vThreads;
+            vThreads.reserve(vTasks.size());
+            for (size_t i = 0; i < vTasks.size(); i++)
+                vThreads.emplace_back([this, i] { RunTask(i); });
+
+            for (auto& thread : vThreads)
+                thread.join();
+
+            dWallMs = ElapsedMs();
+            return true;
+        }
+
+        const std::vector<Task>& Tasks() const { return vTasks; }
+        const std::string& Error() const { return sError; }
+        double WallMs() const { return dWallMs; }
+
+    private:
+        std::vector<Task> vTasks;
+        std::function<void(const Task&)> fnThreadInit;
+        std::string sError;
+        std::mutex mutex;
+        std::condition_variable cvDone;
+        std::chrono::steady_clock::time_point tStart{};
+        double dWallMs = 0.0;
+
+        double ElapsedMs() const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+        }
+
+        void RunTask(size_t index)
+        {
+            Task& task = vTasks[index];
+
+            {
+                std::unique_lock lock(mutex);
+                cvDone.wait(lock, [&] {
+                    for (size_t dep : task.vDeps) {
+                        if (!vTasks[dep].bDone)
+                            return false;
+                    }
+                    return true;
+                });
+            }
+
+            if (fnThreadInit)
+                fnThreadInit(task);
+
+            pThreadTimes = &task.times;
+            task.times.dStartMs = ElapsedMs();
+            {
+                Trace::Zone zone(Trace::Startup, Trace::IsEnabled(Trace::Startup) ? Trace::Intern(task.sName) : "");
+                task.fn();
+            }
+            task.times.dEndMs = ElapsedMs();
+            pThreadTimes = nullptr;
+
+            {
+                std::scoped_lock lock(mutex);
+                task.bDone = true;
+            }
+            cvDone.notify_all();
+        }
+    };
+}
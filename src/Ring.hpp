@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Single producer, single consumer ring buffer. Push and Pop never block or allocate, a full ring drops the item.
+template<typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool Push(const T& item)
+    {
+        size_t iHead = head.load(std::memory_order_relaxed);
+        if (iHead - tail.load(std::memory_order_acquire) == Capacity) {
+            iDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        items[iHead & (Capacity - 1)] = item;
+        head.store(iHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T& item)
+    {
+        size_t iTail = tail.load(std::memory_order_relaxed);
+        if (iTail == head.load(std::memory_order_acquire))
+            return false;
+
+        item = items[iTail & (Capacity - 1)];
+        tail.store(iTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Items lost to a full ring so far
+    uint64_t Dropped() const { return iDropped.load(std::memory_order_relaxed); }
+
+private:
+    // Producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<size_t> head = 0;
+    alignas(64) std::atomic<size_t> tail = 0;
+    alignas(64) std::atomic<uint64_t> iDropped = 0;
+    T items[Capacity];
+};
+
+// Multiple producer, single consumer ring buffer, for producers that can't claim a ring of their own (e.g. DllMain
+// thread notifications, where every thread is a new producer). Push takes a slot with one compare-exchange and never
+// blocks or allocates, so it's safe under the loader lock. A full ring drops the item.
+template<typename T, size_t Capacity>
+class MpscRing
+{
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    MpscRing()
+    {
+        for (size_t i = 0; i < Capacity; i++)
+            slots[i].iSequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool Push(const T& item)
+    {
+        size_t iHead = head.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[iHead & (Capacity - 1)];
+            size_t iSequence = slot->iSequence.load(std::memory_order_acquire);
+            if (iSequence == iHead) {
+                if (head.compare_exchange_weak(iHead, iHead + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (iSequence < iHead) {
+                // Slot still holds an item from the previous lap
+                iDropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else {
+                iHead = head.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->item = item;
+        slot->iSequence.store(iHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side only
+    bool Pop(T& item)
+    {
+        size_t iTail = tail.load(std::memory_order_relaxed);
+        Slot& slot = slots[iTail & (Capacity - 1)];
+        if (slot.iSequence.load(std::memory_order_acquire) != iTail + 1)
+            return false;
+
+        item = slot.item;
+        slot.iSequence.store(iTail + Capacity, std::memory_order_release);
+        tail.store(iTail + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    uint64_t Dropped() const { return iDropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> iSequence; // == position: free for that push, == position + 1: holds its item
+        T item;
+    };
+
+    alignas(64) std::atomic<size_t> head = 0;
+    alignas(64) std::atomic<size_t> tail = 0;
+    alignas(64) std::atomic<uint64_t> iDropped = 0;
+    Slot slots[Capacity];
+};
+
+// A fixed set of rings handed out to producer threads on first use, with one consumer draining all of them.
+// Threads that arrive after every ring has been claimed don't get one and their pushes are dropped, as are pushes from
+// a thread into more than kPoolsPerThread pools of the same type.
+template<typename T, size_t Capacity, size_t MaxThreads>
+class SpscRingPool
+{
+public:
+    using Ring = SpscRing<T, Capacity>;
+    static constexpr size_t kPoolsPerThread = 8;
+
+    SpscRingPool() : iInstance(NextInstance()) {}
+
+    bool Push(const T& item)
+    {
+        Ring* ring = ThreadRing();
+        if (!ring) {
+            iUnclaimed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return ring->Push(item);
+    }
+
+    // Pops everything currently queued, in per-ring order. Consumer side only.
+    template<typename Fn>
+    size_t Drain(Fn&& fn)
+    {
+        size_t iCount = 0;
+        size_t iRings = std::min(iClaimed.load(std::memory_order_acquire), MaxThreads);
+        T item;
+        for (size_t i = 0; i < iRings; i++) {
+            while (rings[i].Pop(item)) {
+                fn(item);
+                iCount++;
+            }
+        }
+        return iCount;
+    }
+
+    uint64_t Dropped() const
+    {
+        uint64_t iTotal = iUnclaimed.load(std::memory_order_relaxed);
+        size_t iRings = std::min(iClaimed.load(std::memory_order_acquire), MaxThreads);
+        for (size_t i = 0; i < iRings; i++)
+            iTotal += rings[i].Dropped();
+        return iTotal;
+    }
+
+private:
+    Ring rings[MaxThreads];
+    std::atomic<size_t> iClaimed = 0;
+    std::atomic<uint64_t> iUnclaimed = 0;
+    const uint64_t iInstance; // Never reused, unlike the address of a pool that has been destroyed
+
+    static uint64_t NextInstance()
+    {
+        static std::atomic<uint64_t> iNext = 1;
+        return iNext.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Ring* ThreadRing()
+    {
+        // The thread_locals are shared by every pool of this type, so the thread's claims are keyed by instance
+        struct Claim
+        {
+            uint64_t iInstance;
+            Ring* pRing;
+        };
+        thread_local Claim claims[kPoolsPerThread] = {};
+        thread_local size_t iClaims = 0;
+        for (size_t i = 0; i < iClaims; i++) {
+            if (claims[i].iInstance == iInstance)
+                return claims[i].pRing;
+        }
+        if (iClaims == kPoolsPerThread)
+            return nullptr;
+
+        size_t iIndex = iClaimed.fetch_add(1, std::memory_order_acq_rel);
+        Ring* pRing = iIndex < MaxThreads ? &rings[iIndex] : nullptr;
+        claims[iClaims++] = { iInstance, pRing };
+        return pRing;
+    }
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Display and combat state published in shared memory for overlays and other external tools.
+// The region has a fixed layout (checked below) so readers don't need any of the fix's headers, only this description:
+//
+//   Header        magic "FXSS", version, sizes, then the display block under its own sequence count
+//   Frame[8]      ring of per-frame entity tables, Header::latestFrame is the newest frame number, frame n is in
+//                 slot n % kFrameCount
+//
+// Every block is a seqlock: the writer makes its sequence odd, writes, then makes it even again. A reader copies the
+// block out and keeps the copy only if the sequence was the same even number before and after. Nothing in here makes
+// a syscall, the fix maps the region once and readers map it read-only once.
+namespace SharedState
+{
+    constexpr uint32_t kMagic = 0x53535846; // "FXSS"
+    constexpr uint32_t kVersion = 1;
+    constexpr uint32_t kFrameCount = 8;
+    constexpr uint32_t kMaxEntities = 256;
+
+    enum DisplayFlags : uint32_t
+    {
+        UncapFPS = 1 << 0,  // [Remove 30FPS Cap] is on, fFPSCap is the cutscene cap
+        CustomFPS = 1 << 1, // [Custom Framerate] is on, fCustomFPS replaces the 30 FPS option
+    };
+
+    struct Display
+    {
+        int32_t iResX;
+        int32_t iResY;
+        float fAspectRatio;
+        float fAspectMultiplier;
+        float fHUDWidth;
+        float fHUDHeight;
+        float fHUDWidthOffset;
+        float fHUDHeightOffset;
+        float fFPSCap;
+        float fCustomFPS;
+        uint32_t iFlags; // DisplayFlags
+        uint32_t iReserved;
+    };
+
+    struct Entity
+    {
+        uint64_t iTableIndex;
+        uint64_t iId; // Address of the entity's CombatDetail, stable while it's alive
+        uint32_t iHealth;
+        uint32_t iWill;
+        uint32_t iStaggerType;
+        float fStaggerTimer;
+        uint8_t iProne;
+        uint8_t iWillBarHalf;
+        uint8_t iReserved[6];
+    };
+
+    struct Frame
+    {
+        uint32_t iSequence;
+        uint32_t iCount;
+        uint64_t iFrame;
+        int64_t iTimestamp; // QueryPerformanceCounter
+        Entity entities[kMaxEntities];
+    };
+
+    struct Header
+    {
+        uint32_t iMagic;
+        uint32_t iVersion;
+        uint32_t iSize;        // Of the whole region
+        uint32_t iFrameCount;
+        uint32_t iMaxEntities;
+        uint32_t iEntitySize;
+        int64_t iTicksPerSecond;
+        uint64_t iLatestFrame; // 0 until the first frame is published
+        uint32_t iDisplaySequence;
+        uint32_t iReserved;
+        Display display;
+    };
+
+    struct Region
+    {
+        Header header;
+        Frame frames[kFrameCount];
+    };
+
+    static_assert(sizeof(Display) == 48);
+    static_assert(sizeof(Entity) == 40);
+    static_assert(offsetof(Frame, entities) == 24 && sizeof(Frame) == 24 + 40 * kMaxEntities);
+    static_assert(offsetof(Header, iLatestFrame) == 32 && offsetof(Header, display) == 48 && sizeof(Header) == 96);
+    static_assert(offsetof(Region, frames) == sizeof(Header));
+
+    namespace Detail
+    {
+        inline std::atomic_ref<uint32_t> Sequence(uint32_t& iSequence) { return std::atomic_ref<uint32_t>(iSequence); }
+
+        template<typename T, typename F>
+        void WriteLocked(uint32_t& iSequence, T& block, F fill)
+        {
+            auto sequence = Sequence(iSequence);
+            uint32_t iStart = sequence.load(std::memory_order_relaxed);
+            sequence.store(iStart + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            fill(block);
+            sequence.store(iStart + 2, std::memory_order_release);
+        }
+
+        // Copies block into out, false if the writer was in the middle of it every time
+        template<typename T>
+        bool ReadLocked(const uint32_t& iSequence, const T& block, T& out, int iAttempts)
+        {
+            auto sequence = Sequence(const_cast<uint32_t&>(iSequence));
+            for (int i = 0; i < iAttempts; i++) {
+                uint32_t iBefore = sequence.load(std::memory_order_acquire);
+                if (iBefore & 1)
+                    continue;
+                memcpy(&out, &block, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == iBefore)
+                    return true;
+            }
+            return false;
+        }
+    }
+
+    // Any thread may publish. Frames and the display block each take one writer at a time, a publish that finds another
+    // one in progress is dropped and returns false, a seqlock with two writers would hand readers torn blocks.
+    class Writer
+    {
+    public:
+        // `memory` is zeroed and at least sizeof(Region) bytes
+        void Open(void* memory, int64_t iTicksPerSecond)
+        {
+            region = static_cast<Region*>(memory);
+            Header& header = region->header;
+            header.iVersion = kVersion;
+            header.iSize = sizeof(Region);
+            header.iFrameCount = kFrameCount;
+            header.iMaxEntities = kMaxEntities;
+            header.iEntitySize = sizeof(Entity);
+            header.iTicksPerSecond = iTicksPerSecond;
+            // Magic last, readers that see it can trust the rest of the header
+            std::atomic_ref<uint32_t>(header.iMagic).store(kMagic, std::memory_order_release);
+        }
+
+        bool IsOpen() const { return region != nullptr; }
+
+        bool PublishDisplay(const Display& display)
+        {
+            if (!region || bPublishingDisplay.test_and_set(std::memory_order_acquire))
+                return false;
+            Detail::WriteLocked(region->header.iDisplaySequence, region->header.display, [&](Display& block) { block = display; });
+            bPublishingDisplay.clear(std::memory_order_release);
+            return true;
+        }
+
+        // `fill(Entity* entities, uint32_t iMax)` writes the frame's entities and returns how many it wrote
+        template<typename F>
+        bool PublishFrame(int64_t iTimestamp, F fill)
+        {
+            if (!region || bPublishingFrame.test_and_set(std::memory_order_acquire))
+                return false;
+            uint64_t iFrame = iNextFrame++;
+            Frame& frame = region->frames[iFrame % kFrameCount];
+            Detail::WriteLocked(frame.iSequence, frame, [&](Frame& block) {
+                block.iFrame = iFrame;
+                block.iTimestamp = iTimestamp;
+                uint32_t iCount = fill(block.entities, kMaxEntities);
+                block.iCount = iCount < kMaxEntities ? iCount : kMaxEntities;
+            });
+            std::atomic_ref<uint64_t>(region->header.iLatestFrame).store(iFrame, std::memory_order_release);
+            bPublishingFrame.clear(std::memory_order_release);
+            return true;
+        }
+
+    private:
+        Region* region = nullptr;
+        uint64_t iNextFrame = 1; // Only touched while holding bPublishingFrame
+        std::atomic_flag bPublishingFrame;
+        std::atomic_flag bPublishingDisplay;
+    };
+
+    class Reader
+    {
+    public:
+        static constexpr int kAttempts = 16;
+
+        // False if the region isn't one this reader understands (yet)
+        bool Open(const void* memory, size_t size)
+        {
+            region = nullptr;
+            auto candidate = static_cast<const Region*>(memory);
+            if (size < sizeof(Header))
+                return false;
+            if (std::atomic_ref<uint32_t>(const_cast<uint32_t&>(candidate->header.iMagic)).load(std::memory_order_acquire) != kMagic)
+                return false;
+            const Header& header = candidate->header;
+            if (header.iVersion != kVersion || header.iSize != sizeof(Region) || size < sizeof(Region) ||
+                header.iFrameCount != kFrameCount || header.iMaxEntities != kMaxEntities || header.iEntitySize != sizeof(Entity))
+                return false;
+            region = candidate;
+            return true;
+        }
+
+        bool ReadDisplay(Display& out) const
+        {
+            return region && Detail::ReadLocked(region->header.iDisplaySequence, region->header.display, out, kAttempts);
+        }
+
+        uint64_t LatestFrame() const
+        {
+            return region ? std::atomic_ref<uint64_t>(const_cast<uint64_t&>(region->header.iLatestFrame)).load(std::memory_order_acquire) : 0;
+        }
+
+        // Copies frame iFrame, false if it was torn every attempt or has already been overwritten by a newer frame
+        bool ReadFrame(uint64_t iFrame, Frame& out) const
+        {
+            if (!region || iFrame == 0)
+                return false;
+            const Frame& frame = region->frames[iFrame % kFrameCount];
+            return Detail::ReadLocked(frame.iSequence, frame, out, kAttempts) && out.iFrame == iFrame && out.iCount <= kMaxEntities;
+        }
+
+        bool ReadLatestFrame(Frame& out) const { return ReadFrame(LatestFrame(), out); }
+
+    private:
+        const Region* region = nullptr;
+    };
+}
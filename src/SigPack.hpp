@@ -0,0 +1,223 @@
+#pragma once
+
+#include "Pattern.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Compiled signature pack.
+// A pack is generated offline (tools/sigpack) and memory-mapped by the fix as-is, nothing in it needs parsing at runtime.
+// Entries are keyed by a hash of the signature text used in dllmain.cpp, so call sites don't change. For builds the pack
+// knows about (by ModuleTimestamp) a scan turns into a hint lookup and a single compare, alternates are only scanned for
+// when the primary signature has no hint and doesn't match.
+//
+// Layout (little endian):
+//   Header
+//   Entry[entryCount]    sorted by key, primary entry first for each key
+//   Hint[hintCount]      sorted by timestamp then key, at most one per timestamp and key
+//   u8[byteCount]        per entry: `length` pattern bytes followed by `length` mask bytes (0xFF = literal, 0x00 = wildcard)
+namespace SigPack
+{
+    constexpr uint32_t kMagic = 0x50535846; // "FXSP"
+    constexpr uint32_t kVersion = 1;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t hintCount;
+        uint32_t byteCount;
+        uint32_t entriesOffset;
+        uint32_t hintsOffset;
+        uint32_t bytesOffset;
+    };
+
+    enum EntryFlags : uint8_t
+    {
+        Primary = 1 << 0, // The signature as written in dllmain.cpp, alternates don't have this set
+    };
+
+    struct Entry
+    {
+        uint64_t key;             // Hash of the primary signature text
+        uint32_t bytesOffset;     // Relative to Header::bytesOffset
+        uint16_t length;
+        uint16_t reserved;
+        uint16_t anchorOffset;    // Least common literal byte in the pattern, alternates are scanned for it
+        uint8_t anchorByte;
+        uint8_t flags;
+        int32_t adjust;           // Added to the match address so call site offsets line up with the primary signature
+        uint32_t hookOffset;      // Offset the call site hooks/patches at, where signature recovery checks candidates
+    };
+
+    struct Hint
+    {
+        uint64_t key;
+        uint32_t timestamp;       // ModuleTimestamp of the build
+        uint32_t rva;             // Address the scan returns for this build, relative to the module base
+        uint32_t entryIndex;      // Entry whose bytes are found at rva - adjust
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 32 && sizeof(Entry) == 32 && sizeof(Hint) == 24, "Pack layout changed, bump kVersion");
+
+    // Signature text normalised to upper case hex with "??" wildcards and single spaces, so formatting differences
+    // between the pack source and dllmain.cpp don't change the key.
+    inline std::string Normalise(std::string_view signature)
+    {
+        std::string sOut;
+        sOut.reserve(signature.size());
+
+        size_t i = 0;
+        while (i < signature.size()) {
+            char c = signature[i];
+            if (c == ' ') {
+                i++;
+                continue;
+            }
+
+            if (!sOut.empty())
+                sOut += ' ';
+
+            if (c == '?') {
+                sOut += "??";
+                i += (i + 1 < signature.size() && signature[i + 1] == '?') ? 2 : 1;
+                continue;
+            }
+
+            while (i < signature.size() && signature[i] != ' ')
+                sOut += (char)toupper((unsigned char)signature[i++]);
+        }
+        return sOut;
+    }
+
+    // FNV-1a
+    inline uint64_t Key(std::string_view signature)
+    {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (char c : Normalise(signature)) {
+            hash ^= (uint8_t)c;
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    // Read-only view over a mapped pack
+    class View
+    {
+    public:
+        View() = default;
+
+        // Validates the header, that every table lies inside the mapping and is in the order lookups binary search it in,
+        // and that each anchor is a literal byte of its pattern.
+        bool Open(const uint8_t* data, size_t size)
+        {
+            pData = nullptr;
+            if (!data || size < sizeof(Header))
+                return false;
+
+            const Header* header = reinterpret_cast<const Header*>(data);
+            if (header->magic != kMagic || header->version != kVersion)
+                return false;
+
+            if (header->entriesOffset % alignof(Entry) != 0 || header->hintsOffset % alignof(Hint) != 0)
+                return false;
+
+            if (!InBounds(header->entriesOffset, (uint64_t)header->entryCount * sizeof(Entry), size) ||
+                !InBounds(header->hintsOffset, (uint64_t)header->hintCount * sizeof(Hint), size) ||
+                !InBounds(header->bytesOffset, header->byteCount, size))
+                return false;
+
+            const Entry* entries = reinterpret_cast<const Entry*>(data + header->entriesOffset);
+            const uint8_t* bytes = data + header->bytesOffset;
+            for (uint32_t i = 0; i < header->entryCount; i++) {
+                const Entry& entry = entries[i];
+                if ((uint64_t)entry.bytesOffset + entry.length * 2ull > header->byteCount || entry.length == 0)
+                    return false;
+                if (entry.anchorOffset >= entry.length || bytes[entry.bytesOffset + entry.length + entry.anchorOffset] != 0xFF ||
+                    bytes[entry.bytesOffset + entry.anchorOffset] != entry.anchorByte)
+                    return false;
+                if (i > 0 && (entry.key < entries[i - 1].key || (entry.key == entries[i - 1].key && (entry.flags & Primary))))
+                    return false;
+            }
+
+            const Hint* hints = reinterpret_cast<const Hint*>(data + header->hintsOffset);
+            for (uint32_t i = 0; i < header->hintCount; i++) {
+                if (hints[i].entryIndex >= header->entryCount || hints[i].key != entries[hints[i].entryIndex].key)
+                    return false;
+                if (i > 0 && (hints[i].timestamp != hints[i - 1].timestamp ? hints[i].timestamp < hints[i - 1].timestamp : hints[i].key <= hints[i - 1].key))
+                    return false;
+            }
+
+            pData = data;
+            return true;
+        }
+
+        bool IsOpen() const { return pData != nullptr; }
+        const Header& GetHeader() const { return *reinterpret_cast<const Header*>(pData); }
+
+        const Entry* Entries() const { return reinterpret_cast<const Entry*>(pData + GetHeader().entriesOffset); }
+        const Hint* Hints() const { return reinterpret_cast<const Hint*>(pData + GetHeader().hintsOffset); }
+        const uint8_t* Bytes(const Entry& entry) const { return pData + GetHeader().bytesOffset + entry.bytesOffset; }
+        const uint8_t* Mask(const Entry& entry) const { return Bytes(entry) + entry.length; }
+
+        // All entries for a key, primary first
+        std::pair<const Entry*, const Entry*> Find(uint64_t key) const
+        {
+            const Entry* begin = Entries();
+            const Entry* end = begin + GetHeader().entryCount;
+            return std::equal_range(begin, end, key, KeyLess{});
+        }
+
+        const Hint* FindHint(uint32_t timestamp, uint64_t key) const
+        {
+            const Hint* begin = Hints();
+            const Hint* end = begin + GetHeader().hintCount;
+            const Hint* it = std::lower_bound(begin, end, std::pair{ timestamp, key }, [](const Hint& hint, const std::pair<uint32_t, uint64_t>& value) {
+                return hint.timestamp != value.first ? hint.timestamp < value.first : hint.key < value.second;
+                });
+            return (it != end && it->timestamp == timestamp && it->key == key) ? it : nullptr;
+        }
+
+        // First match of an entry in data, searching for its anchor byte
+        const uint8_t* Scan(const Entry& entry, const uint8_t* data, size_t size) const
+        {
+            Pattern::Anchor anchor;
+            anchor.bValid = true;
+            anchor.iOffset = entry.anchorOffset;
+            anchor.iByte = entry.anchorByte;
+            return Pattern::Find(data, size, Bytes(entry), Mask(entry), entry.length, anchor);
+        }
+
+        // Compares an entry against memory that is known to be readable for entry.length bytes.
+        bool Matches(const Entry& entry, const uint8_t* address) const
+        {
+            const uint8_t* bytes = Bytes(entry);
+            const uint8_t* mask = Mask(entry);
+            for (uint16_t i = 0; i < entry.length; i++) {
+                if ((address[i] & mask[i]) != bytes[i])
+                    return false;
+            }
+            return true;
+        }
+
+    private:
+        const uint8_t* pData = nullptr;
+
+        struct KeyLess
+        {
+            bool operator()(const Entry& entry, uint64_t key) const { return entry.key < key; }
+            bool operator()(uint64_t key, const Entry& entry) const { return key < entry.key; }
+        };
+
+        static bool InBounds(uint64_t offset, uint64_t length, uint64_t size)
+        {
+            return offset <= size && length <= size - offset;
+        }
+    };
+}
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Thread affinity/priority policy.
+// Rules from the ini say which cores and priority a thread should get, this decides which rule applies to a thread and
+// what that means on a given CPU topology. Querying the topology and threads and applying the result is done by the
+// caller (helper.hpp / dllmain.cpp), nothing in here touches the OS.
+namespace ThreadPolicy
+{
+    struct LogicalProcessor
+    {
+        uint16_t iGroup;
+        uint8_t iNumber;          // Within the group
+        uint32_t iCore;           // Physical core, SMT siblings share it
+        uint8_t iEfficiencyClass; // Higher is faster (P-cores on hybrid CPUs)
+        uint32_t iL3;             // L3 cache domain
+        bool bFirstOnCore;        // First SMT sibling of its core
+    };
+
+    struct Topology
+    {
+        std::vector<LogicalProcessor> vProcessors;
+
+        uint8_t MaxEfficiencyClass() const
+        {
+            uint8_t iMax = 0;
+            for (const auto& processor : vProcessors)
+                iMax = std::max(iMax, processor.iEfficiencyClass);
+            return iMax;
+        }
+
+        uint8_t MinEfficiencyClass() const
+        {
+            uint8_t iMin = UINT8_MAX;
+            for (const auto& processor : vProcessors)
+                iMin = std::min(iMin, processor.iEfficiencyClass);
+            return vProcessors.empty() ? 0 : iMin;
+        }
+
+        bool IsHybrid() const { return MaxEfficiencyClass() != MinEfficiencyClass(); }
+    };
+
+    enum class CoreSet
+    {
+        Keep,             // Leave affinity alone
+        All,
+        Performance,      // Fastest efficiency class
+        PerformanceNoSmt, // Fastest efficiency class, one logical processor per core
+        Efficiency,       // Slowest efficiency class, same as Keep on non-hybrid CPUs
+        L3,               // One L3 cache domain
+    };
+
+    // Same values as THREAD_PRIORITY_*
+    constexpr int kPriorityIdle = -15;
+    constexpr int kPriorityLowest = -2;
+    constexpr int kPriorityBelowNormal = -1;
+    constexpr int kPriorityNormal = 0;
+    constexpr int kPriorityAboveNormal = 1;
+    constexpr int kPriorityHighest = 2;
+    constexpr int kPriorityTimeCritical = 15;
+
+    struct Action
+    {
+        CoreSet eCores = CoreSet::Keep;
+        uint32_t iL3 = 0;
+        std::optional<int> iPriority;
+    };
+
+    // Checked in this order, the first kind with a match wins. Within a kind the longest pattern wins.
+    enum class MatchKind
+    {
+        Fix,    // Threads owned by the fix
+        Jxl,    // JPEG XL encoder workers
+        Name,   // Thread description
+        Module, // Module containing the thread's start address
+    };
+
+    struct Rule
+    {
+        MatchKind eKind;
+        std::string sPattern; // Glob, '*' and '?', case insensitive. Unused for Fix/Jxl.
+        Action action;
+    };
+
+    struct ThreadInfo
+    {
+        std::string sName;
+        std::string sModule;
+        bool bFixOwned = false;
+        bool bJxl = false;
+    };
+
+    struct Decision
+    {
+        const Rule* pRule = nullptr;
+        bool bAffinity = false;
+        uint16_t iGroup = 0;
+        uint64_t iMask = 0;
+        bool bPriority = false;
+        int iPriority = kPriorityNormal;
+    };
+
+    inline bool GlobMatch(std::string_view pattern, std::string_view text)
+    {
+        size_t p = 0, t = 0, star = std::string_view::npos, retry = 0;
+        while (t < text.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || tolower((unsigned char)pattern[p]) == tolower((unsigned char)text[t]))) {
+                p++;
+                t++;
+            }
+            else if (p < pattern.size() && pattern[p] == '*') {
+                star = p++;
+                retry = t;
+            }
+            else if (star != std::string_view::npos) {
+                p = star + 1;
+                t = ++retry;
+            }
+            else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == '*')
+            p++;
+        return p == pattern.size();
+    }
+
+    namespace Detail
+    {
+        inline std::string Trim(std::string_view text)
+        {
+            size_t start = 0, end = text.size();
+            while (start < end && isspace((unsigned char)text[start]))
+                start++;
+            while (end > start && isspace((unsigned char)text[end - 1]))
+                end--;
+            std::string sOut(text.substr(start, end - start));
+            for (auto& c : sOut)
+                c = (char)tolower((unsigned char)c);
+            return sOut;
+        }
+    }
+
+    // key:   "fix", "jxl", "name:<glob>" or "module:<glob>"
+    // value: "<cores>[, <priority>]"
+    //        cores:    keep, all, performance, performance-nosmt, efficiency, l3:<n>
+    //        priority: idle, lowest, below_normal, normal, above_normal, highest, time_critical
+    inline bool ParseRule(std::string_view key, std::string_view value, Rule& rule)
+    {
+        using Detail::Trim;
+
+        std::string sKey = Trim(key);
+        rule = {};
+        if (sKey == "fix") {
+            rule.eKind = MatchKind::Fix;
+        }
+        else if (sKey == "jxl") {
+            rule.eKind = MatchKind::Jxl;
+        }
+        else if (sKey.rfind("name:", 0) == 0 || sKey.rfind("module:", 0) == 0) {
+            size_t iColon = key.find(':');
+            rule.eKind = sKey[0] == 'n' ? MatchKind::Name : MatchKind::Module;
+            rule.sPattern = std::string(key.substr(iColon + 1));
+            rule.sPattern.erase(0, rule.sPattern.find_first_not_of(" \t"));
+            rule.sPattern.erase(rule.sPattern.find_last_not_of(" \t") + 1);
+            if (rule.sPattern.empty())
+                return false;
+        }
+        else {
+            return false;
+        }
+
+        size_t iComma = value.find(',');
+        std::string sCores = Trim(value.substr(0, iComma));
+        if (sCores == "keep")
+            rule.action.eCores = CoreSet::Keep;
+        else if (sCores == "all")
+            rule.action.eCores = CoreSet::All;
+        else if (sCores == "performance")
+            rule.action.eCores = CoreSet::Performance;
+        else if (sCores == "performance-nosmt")
+            rule.action.eCores = CoreSet::PerformanceNoSmt;
+        else if (sCores == "efficiency")
+            rule.action.eCores = CoreSet::Efficiency;
+        else if (sCores.rfind("l3:", 0) == 0 && sCores.size() > 3 && sCores.find_first_not_of("0123456789", 3) == std::string::npos) {
+            rule.action.eCores = CoreSet::L3;
+            rule.action.iL3 = (uint32_t)std::stoul(sCores.substr(3));
+        }
+        else
+            return false;
+
+        if (iComma == std::string_view::npos)
+            return true;
+
+        static constexpr std::pair<std::string_view, int> kPriorities[] = {
+            { "idle", kPriorityIdle }, { "lowest", kPriorityLowest }, { "below_normal", kPriorityBelowNormal },
+            { "normal", kPriorityNormal }, { "above_normal", kPriorityAboveNormal }, { "highest", kPriorityHighest },
+            { "time_critical", kPriorityTimeCritical },
+        };
+        std::string sPriority = Trim(value.substr(iComma + 1));
+        for (const auto& [sName, iPriority] : kPriorities) {
+            if (sPriority == sName) {
+                rule.action.iPriority = iPriority;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline const Rule* Match(const std::vector<Rule>& rules, const ThreadInfo& thread)
+    {
+        for (MatchKind eKind : { MatchKind::Fix, MatchKind::Jxl, MatchKind::Name, MatchKind::Module }) {
+            const Rule* pBest = nullptr;
+            for (const auto& rule : rules) {
+                if (rule.eKind != eKind)
+                    continue;
+
+                bool bMatch = false;
+                switch (eKind) {
+                case MatchKind::Fix: bMatch = thread.bFixOwned; break;
+                case MatchKind::Jxl: bMatch = thread.bJxl; break;
+                case MatchKind::Name: bMatch = !thread.sName.empty() && GlobMatch(rule.sPattern, thread.sName); break;
+                case MatchKind::Module: bMatch = !thread.sModule.empty() && GlobMatch(rule.sPattern, thread.sModule); break;
+                }
+                if (bMatch && (!pBest || rule.sPattern.size() > pBest->sPattern.size()))
+                    pBest = &rule;
+            }
+            if (pBest)
+                return pBest;
+        }
+        return nullptr;
+    }
+
+    inline Decision Evaluate(const Topology& topology, const std::vector<Rule>& rules, const ThreadInfo& thread)
+    {
+        Decision decision;
+        decision.pRule = Match(rules, thread);
+        if (!decision.pRule)
+            return decision;
+
+        const Action& action = decision.pRule->action;
+        if (action.iPriority) {
+            decision.bPriority = true;
+            decision.iPriority = *action.iPriority;
+        }
+
+        auto Selected = [&](const LogicalProcessor& processor) {
+            switch (action.eCores) {
+            case CoreSet::All: return true;
+            case CoreSet::Performance: return processor.iEfficiencyClass == topology.MaxEfficiencyClass();
+            case CoreSet::PerformanceNoSmt: return processor.iEfficiencyClass == topology.MaxEfficiencyClass() && processor.bFirstOnCore;
+            case CoreSet::Efficiency: return processor.iEfficiencyClass == topology.MinEfficiencyClass();
+            case CoreSet::L3: return processor.iL3 == action.iL3;
+            default: return false;
+            }
+        };
+
+        if (action.eCores == CoreSet::Keep || (action.eCores == CoreSet::Efficiency && !topology.IsHybrid()))
+            return decision;
+
+        // Affinity is per processor group, use the group with the most selected processors
+        std::vector<uint32_t> vGroupCounts;
+        for (const auto& processor : topology.vProcessors) {
+            if (!Selected(processor))
+                continue;
+            if (processor.iGroup >= vGroupCounts.size())
+                vGroupCounts.resize(processor.iGroup + 1);
+            vGroupCounts[processor.iGroup]++;
+        }
+        if (vGroupCounts.empty())
+            return decision;
+
+        decision.iGroup = (uint16_t)(std::max_element(vGroupCounts.begin(), vGroupCounts.end()) - vGroupCounts.begin());
+        for (const auto& processor : topology.vProcessors) {
+            if (processor.iGroup == decision.iGroup && Selected(processor) && processor.iNumber < 64)
+                decision.iMask |= 1ull << processor.iNumber;
+        }
+        decision.bAffinity = decision.iMask != 0;
+        return decision;
+    }
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// Timeline of what the fix does, exported as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev).
+// Enable() allocates every buffer up front, a thread claims one the first time it records (or when it registers) with
+// a single atomic add, so a hook never allocates. Each buffer is a ring that overwrites its oldest zones, an export
+// has the latest kEventsPerThread - 1 zones of every thread. Threads past kMaxThreads aren't recorded. Nothing in here
+// touches the OS, the caller says how to get a thread's id and name and writes the JSON out.
+namespace Trace
+{
+    enum Category : uint32_t
+    {
+        Startup = 1 << 0, // Startup tasks
+        Scan = 1 << 1,    // Pattern scans
+        Install = 1 << 2, // Patches and hooks being written
+        Hooks = 1 << 3,   // Hook callbacks
+    };
+
+    inline const char* CategoryName(uint32_t iCategory)
+    {
+        switch (iCategory) {
+        case Startup: return "startup";
+        case Scan: return "scan";
+        case Install: return "install";
+        case Hooks: return "hooks";
+        default: return "unknown";
+        }
+    }
+
+    // "startup, scan, install, hooks", unknown names are ignored
+    inline uint32_t ParseCategories(std::string_view text)
+    {
+        uint32_t iMask = 0;
+        while (!text.empty()) {
+            size_t iComma = text.find(',');
+            std::string_view item = text.substr(0, iComma);
+            text = iComma == std::string_view::npos ? std::string_view() : text.substr(iComma + 1);
+            while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+                item.remove_prefix(1);
+            while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+                item.remove_suffix(1);
+            for (uint32_t iCategory : { Startup, Scan, Install, Hooks }) {
+                if (item == CategoryName(iCategory))
+                    iMask |= iCategory;
+            }
+        }
+        return iMask;
+    }
+
+    constexpr size_t kEventsPerThread = 4096;
+    constexpr size_t kMaxThreads = 64; // 10 MB of buffers in all
+
+    struct Event
+    {
+        const char* sName; // Literal or Intern()ed
+        uint32_t iCategory;
+        int64_t iStart;    // Nanoseconds since Enable()
+        int64_t iDuration;
+        uint64_t iArg;     // Shown as "address" when not 0
+    };
+
+    struct ThreadBuffer
+    {
+        uint32_t iThreadId = 0;
+        std::string sThreadName; // Set when the thread registers, or looked up by the first export that sees it
+        Event events[kEventsPerThread];
+        std::atomic<uint64_t> iWritten = 0; // Every zone ever recorded, written by the owning thread only
+    };
+
+    struct State
+    {
+        std::atomic<uint32_t> iEnabled = 0; // Category mask
+        std::chrono::steady_clock::time_point tStart;
+        uint32_t (*fnThreadId)() = nullptr;
+        std::string (*fnThreadName)(uint32_t iThreadId) = nullptr;
+        std::unique_ptr<ThreadBuffer[]> buffers;
+        std::atomic<size_t> iClaimed = 0;
+        std::atomic<uint64_t> iUnrecorded = 0; // Zones of threads that found every buffer claimed
+        std::mutex mutex;
+        std::deque<std::string> vNames;
+    };
+
+    inline State Global;
+    inline thread_local ThreadBuffer* pThreadBuffer = nullptr;
+
+    // Timestamps are relative to tStart. Called once, before anything records.
+    inline void Enable(uint32_t iCategories, std::chrono::steady_clock::time_point tStart, uint32_t (*fnThreadId)(), std::string (*fnThreadName)(uint32_t))
+    {
+        Global.tStart = tStart;
+        Global.fnThreadId = fnThreadId;
+        Global.fnThreadName = fnThreadName;
+        if (!Global.buffers)
+            Global.buffers = std::make_unique<ThreadBuffer[]>(kMaxThreads);
+        Global.iEnabled.store(iCategories, std::memory_order_release);
+    }
+
+    inline bool IsEnabled(uint32_t iCategory) { return (Global.iEnabled.load(std::memory_order_acquire) & iCategory) != 0; }
+
+    // Copy of a name that isn't a literal, kept until the process exits
+    inline const char* Intern(std::string_view sName)
+    {
+        std::scoped_lock lock(Global.mutex);
+        return Global.vNames.emplace_back(sName).c_str();
+    }
+
+    inline int64_t Since(std::chrono::steady_clock::time_point t)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t - Global.tStart).count();
+    }
+
+    inline int64_t Now() { return Since(std::chrono::steady_clock::now()); }
+
+    namespace Detail
+    {
+        inline ThreadBuffer* Claim()
+        {
+            if (!Global.buffers || Global.iClaimed.load(std::memory_order_relaxed) >= kMaxThreads)
+                return nullptr;
+            size_t iIndex = Global.iClaimed.fetch_add(1, std::memory_order_relaxed);
+            if (iIndex >= kMaxThreads)
+                return nullptr;
+
+            static std::atomic<uint32_t> iNextId = 1;
+            ThreadBuffer* buffer = &Global.buffers[iIndex];
+            buffer->iThreadId = Global.fnThreadId ? Global.fnThreadId() : iNextId++;
+            pThreadBuffer = buffer;
+            return buffer;
+        }
+    }
+
+    // Claims a buffer for the calling thread ahead of its first zone and names it now, while it's known.
+    // For the fix's own threads, game threads are claimed by their first zone and named by the export.
+    inline void RegisterThread()
+    {
+        if (!Global.iEnabled.load(std::memory_order_acquire) || pThreadBuffer)
+            return;
+        ThreadBuffer* buffer = Detail::Claim();
+        if (buffer && Global.fnThreadName)
+            buffer->sThreadName = Global.fnThreadName(buffer->iThreadId);
+    }
+
+    inline void Record(const Event& event)
+    {
+        ThreadBuffer* buffer = pThreadBuffer;
+        if (!buffer && !(buffer = Detail::Claim())) {
+            Global.iUnrecorded.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        uint64_t iWritten = buffer->iWritten.load(std::memory_order_relaxed);
+        buffer->events[iWritten % kEventsPerThread] = event;
+        buffer->iWritten.store(iWritten + 1, std::memory_order_release);
+    }
+
+    class Zone
+    {
+    public:
+        Zone(uint32_t iCategory, const char* sName, uint64_t iArg = 0) : iCategory(iCategory), sName(sName), iArg(iArg)
+        {
+            if (IsEnabled(iCategory))
+                iStart = Now();
+        }
+
+        ~Zone()
+        {
+            if (iStart >= 0)
+                Record({ sName, iCategory, iStart, Now() - iStart, iArg });
+        }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        uint32_t iCategory;
+        const char* sName;
+        uint64_t iArg;
+        int64_t iStart = -1;
+    };
+
+    namespace Detail
+    {
+        inline void AppendEscaped(std::string& out, const char* text)
+        {
+            for (; *text; text++) {
+                char c = *text;
+                if (c == '"' || c == '\\') {
+                    out += '\\';
+                    out += c;
+                }
+                else if ((unsigned char)c < 0x20) {
+                    out += ' ';
+                }
+                else {
+                    out += c;
+                }
+            }
+        }
+    }
+
+    // The latest zones of every thread. `pLost` is how many were overwritten or never recorded.
+    inline void ExportJson(std::string& out, uint64_t* pLost = nullptr)
+    {
+        std::scoped_lock lock(Global.mutex);
+
+        uint64_t iLost = Global.iUnrecorded.load(std::memory_order_relaxed);
+        out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool bFirst = true;
+        char sNumbers[128];
+        size_t iClaimed = std::min(Global.iClaimed.load(std::memory_order_relaxed), kMaxThreads);
+        auto events = std::make_unique<Event[]>(kEventsPerThread);
+        for (size_t iBuffer = 0; iBuffer < iClaimed; iBuffer++) {
+            ThreadBuffer& buffer = Global.buffers[iBuffer];
+            uint64_t iWritten = buffer.iWritten.load(std::memory_order_acquire);
+            if (iWritten == 0)
+                continue; // Claimed but nothing recorded yet, its id may not be stored
+
+            // Copy the ring, then drop whatever the owner wrote over while it was being copied. The slot after the
+            // newest zone may be half written.
+            uint64_t iFirst = iWritten > kEventsPerThread ? iWritten - kEventsPerThread : 0;
+            for (uint64_t i = iFirst; i < iWritten; i++)
+                events[i - iFirst] = buffer.events[i % kEventsPerThread];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t iNow = buffer.iWritten.load(std::memory_order_relaxed);
+            uint64_t iValid = iNow >= kEventsPerThread ? iNow - kEventsPerThread + 1 : 0;
+            uint64_t iKept = iValid > iFirst ? iValid : iFirst;
+            iLost += iKept;
+
+            if (buffer.sThreadName.empty() && Global.fnThreadName)
+                buffer.sThreadName = Global.fnThreadName(buffer.iThreadId);
+            if (!buffer.sThreadName.empty()) {
+                out += bFirst ? "" : ",\n";
+                bFirst = false;
+                snprintf(sNumbers, sizeof(sNumbers), "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", buffer.iThreadId);
+                out += sNumbers;
+                Detail::AppendEscaped(out, buffer.sThreadName.c_str());
+                out += "\"}}";
+            }
+
+            for (uint64_t i = iKept; i < iWritten; i++) {
+                const Event& event = events[i - iFirst];
+                out += bFirst ? "" : ",\n";
+                bFirst = false;
+                out += "{\"ph\":\"X\",\"name\":\"";
+                Detail::AppendEscaped(out, event.sName);
+                snprintf(sNumbers, sizeof(sNumbers), "\",\"cat\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", CategoryName(event.iCategory),
+                    buffer.iThreadId, event.iStart / 1000.0, event.iDuration / 1000.0);
+                out += sNumbers;
+                if (event.iArg) {
+                    snprintf(sNumbers, sizeof(sNumbers), ",\"args\":{\"address\":\"%llx\"}", (unsigned long long)event.iArg);
+                    out += sNumbers;
+                }
+                out += "}";
+            }
+        }
+        out += "\n]}\n";
+        if (pLost)
+            *pLost = iLost;
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Window focus state machine and the message filtering around it.
+// Kept free of any Win32 calls so it can be driven by scripted event sequences outside of the game.
+namespace Focus
+{
+    // Win32 message ids the dispatch logic needs, so it builds without windows.h
+    namespace Message
+    {
+        constexpr uint32_t Activate = 0x0006;    // WM_ACTIVATE
+        constexpr uint32_t SetFocus = 0x0007;    // WM_SETFOCUS
+        constexpr uint32_t KillFocus = 0x0008;   // WM_KILLFOCUS
+        constexpr uint32_t ActivateApp = 0x001C; // WM_ACTIVATEAPP
+        constexpr uint32_t NcActivate = 0x0086;  // WM_NCACTIVATE
+    }
+
+    // Whether NewWndProc has to ask user32 who is in the foreground for this message, every other message runs with
+    // the cached state. uWakeMessage is the fix's registered wake-up message, 0 if registering it failed.
+    inline bool IsFocusMessage(uint32_t uMessage, uint32_t uWakeMessage)
+    {
+        switch (uMessage) {
+        case Message::Activate:
+        case Message::ActivateApp:
+        case Message::NcActivate:
+        case Message::SetFocus:
+        case Message::KillFocus:
+            return true;
+        default:
+            return uWakeMessage != 0 && uMessage == uWakeMessage;
+        }
+    }
+
+    // Windows CallWndProcHook has already looked at. Every message for every window on the thread comes through the
+    // hook until the game window shows up, its class name is only fetched the first time a window is seen.
+    // Direct mapped on the handle, a window that collides with another is just looked at again.
+    class CheckedWindows
+    {
+    public:
+        // True the first time (since being evicted) a window is seen
+        bool CheckOnce(const void* window)
+        {
+            const void*& slot = slots[((uintptr_t)window >> 4) % kSlots];
+            if (slot == window)
+                return false;
+            slot = window;
+            return true;
+        }
+
+    private:
+        static constexpr size_t kSlots = 32;
+        const void* slots[kSlots] = {};
+    };
+
+    enum class Event : uint8_t
+    {
+        Foreground, // Game window became the foreground/top window
+        Background, // Another window became the foreground window
+    };
+
+    enum class Action : uint8_t
+    {
+        None,
+        Activate,   // Send WA_CLICKACTIVE to the game
+        Deactivate, // Send WA_INACTIVE to the game
+    };
+
+    class StateMachine
+    {
+    public:
+        // Returns what the game needs to be told for this event.
+        Action OnEvent(Event event)
+        {
+            switch (event) {
+            case Event::Foreground:
+                bForeground = true;
+                if (!bActive) {
+                    bActive = true;
+                    return Action::Activate;
+                }
+                break;
+
+            case Event::Background:
+                bForeground = false;
+                // With background audio the game is never told it lost focus
+                if (bActive && !bKeepActiveInBackground) {
+                    bActive = false;
+                    return Action::Deactivate;
+                }
+                break;
+            }
+            return Action::None;
+        }
+
+        void SetKeepActiveInBackground(bool bKeep) { bKeepActiveInBackground = bKeep; }
+
+        // What the game believes
+        bool IsActive() const { return bActive; }
+        // What the user is actually looking at
+        bool IsForeground() const { return bForeground; }
+
+    private:
+        bool bActive = false;
+        bool bForeground = false;
+        bool bKeepActiveInBackground = false;
+    };
+}
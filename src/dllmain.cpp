@@ -1,6 +1,22 @@
 #include "stdafx.h"
 #include "helper.hpp"
 #include "GameObject.h"
+#include "WindowFocus.hpp"
+#include "AspectMath.hpp"
+#include "EntitySnapshot.hpp"
+#include "DamageScaling.hpp"
+#include "CombatLog.hpp"
+#include "Ring.hpp"
+#include "HookBench.hpp"
+#include "BinLog.hpp"
+#include "ThreadPolicy.hpp"
+#include "SharedState.hpp"
+#include "GameState.hpp"
+#include "HookTrace.hpp"
+#include "InitArena.hpp"
+#include "LodCurve.hpp"
+#include "TraceZones.hpp"
+#include "FrameLimiter.hpp"
 
 #include <inipp/inipp.h>
 #include <spdlog/spdlog.h>
@@ -24,6 +40,11 @@ std::filesystem::path sThisModulePath;
 // Ini
 inipp::Ini<char> ini;
 std::string sConfigFile = sFixName + ".ini";
+std::string sSigPackFile = sFixName + ".sigpack";
+std::string sCombatLogFile = sFixName + "_combat.fxcl";
+std::string sHookBenchFile = sFixName + "_hookbench.csv";
+std::string sHookTraceFile = sFixName + "_hooks.fxht";
+std::string sTraceFile = sFixName + "_trace.json";
 std::pair DesktopDimensions = { 0,0 };
 
 // Ini variables
@@ -48,23 +69,45 @@ bool bCutsceneFramegen;
 bool bMotionBlurFramegen;
 float fJXLQuality = 75.0f;
 int iJXLThreads = 1;
+bool bJXLAdaptive;
+int iJXLTimeBudget = 1000;
+int iJXLMaxEffort = 7;
 bool bDisableDbgCheck;
 bool bDisableDOF;
 bool bDisableCinematicEffects;
 bool bBackgroundAudio;
 bool bResizableWindow;
 bool bDisableScreensaver;
+float fBackgroundFPS = 0.0f;
 bool bAdjustStaggerTimers;
 bool bAdjustDamageOutput;
+bool bCombatLog;
+bool bHookBenchmark;
+bool bDiagnostics;
+bool bThreadPolicy;
+bool bSignatureRecovery;
+bool bSharedState;
+bool bStateProfiles;
+bool bHookTrace;
+int iHookTraceMaxCalls = 1000;
+bool bTrace;
+std::string sTraceCategories = "startup, scan, install, hooks";
+std::string sTraceHotkey = "7A";
+int iTraceHotkey;
+int iSignatureRecoveryMismatches = 0;
+int iSignatureRecoveryTimeBudget = 2000;
 int iMaxDynRes;
 int iMinDynRes;
 float fLODMulti = 1.00f;
+std::string sLODCurve;
 float fStaggerTimerMultiplierType1 = 1.0f;
 float fStaggerTimerMultiplierType2 = 1.0f;
 float fStaggerTimerMultiplierType3 = 1.0f;
 float fCliveDamageScale = 1.0f;
 float fHealthDamageScale = 1.0f;
 float fWillDamageScale = 1.0f;
+DamageScaling::Table DamageScalingRules;
+std::vector<ThreadPolicy::Rule> ThreadPolicyRules;
 
 // Aspect ratio + HUD stuff
 float fPi = (float)3.141592653;
@@ -82,25 +125,37 @@ int iCurrentResY;
 float fEikonCursorWidthOffset;
 float fEikonCursorHeightOffset;
 bool bIsMoviePlaying = false;
+s32 iHealthDamageScale = DamageScaling::kOne;
+s32 iCliveDamageScale = DamageScaling::kOne;
+s32 iWillDamageScale = DamageScaling::kOne;
+std::atomic<bool> bSizeMove = false; // Window is being moved or resized, set by NewWndProc
+std::atomic<uint64_t> iFrameCounter = 0; // Bumped once per frame by CurrentResolutionMidHook
+bool bFrameCounterHooked = false;
+ULONGLONG ullPhotoModeLastSeen = 0;
+std::atomic<uint64_t> ullCutsceneLastSeen = 0; // Written by game threads, read once a frame by UpdateGameState
+std::atomic<uint64_t> ullCombatLastSeen = 0;
+GameState::Tracker GameStateTracker;
+std::vector<LodCurve::Point> LODCurvePoints;
+LodCurve::Table LODCurve;
+HookLogic::Params HookParams;
+HookTrace::Recorder HookRecorder;
+FrameLimit::Limiter BackgroundLimiter;
+HANDLE hForegroundEvent = NULL; // Set while the game window is in the foreground, created when there's a background framerate
 LPCWSTR sWindowClassName = L"FAITHGame";
+SharedState::Writer SharedStateWriter;
 
 void CalculateAspectRatio(bool bLog)
 {
-    // Calculate aspect ratio
-    fAspectRatio = (float)iCurrentResX / (float)iCurrentResY;
-    fAspectMultiplier = fAspectRatio / fNativeAspect;
-
-    // HUD variables
-    fHUDWidth = iCurrentResY * fNativeAspect;
-    fHUDHeight = (float)iCurrentResY;
-    fHUDWidthOffset = (float)(iCurrentResX - fHUDWidth) / 2;
-    fHUDHeightOffset = 0;
-    if (fAspectRatio < fNativeAspect) {
-        fHUDWidth = (float)iCurrentResX;
-        fHUDHeight = (float)iCurrentResX / fNativeAspect;
-        fHUDWidthOffset = 0;
-        fHUDHeightOffset = (float)(iCurrentResY - fHUDHeight) / 2;
-    }
+    // Calculate aspect ratio and HUD variables
+    Aspect::Layout layout = Aspect::Calculate(iCurrentResX, iCurrentResY, fNativeAspect);
+    fAspectRatio = layout.fAspectRatio;
+    fAspectMultiplier = layout.fAspectMultiplier;
+    fHUDWidth = layout.fHUDWidth;
+    fHUDHeight = layout.fHUDHeight;
+    fHUDWidthOffset = layout.fHUDWidthOffset;
+    fHUDHeightOffset = layout.fHUDHeightOffset;
+    HookParams = { layout, fNativeAspect };
+    HookRecorder.SetParams(HookParams);
 
     if (bLog) {
         // Log details about current resolution
@@ -114,6 +169,21 @@ void CalculateAspectRatio(bool bLog)
         spdlog::info("Current Resolution: fHUDHeightOffset: {}", fHUDHeightOffset);
         spdlog::info("----------");
     }   
+
+    // Let external tools know
+    SharedState::Display display{};
+    display.iResX = iCurrentResX;
+    display.iResY = iCurrentResY;
+    display.fAspectRatio = fAspectRatio;
+    display.fAspectMultiplier = fAspectMultiplier;
+    display.fHUDWidth = fHUDWidth;
+    display.fHUDHeight = fHUDHeight;
+    display.fHUDWidthOffset = fHUDWidthOffset;
+    display.fHUDHeightOffset = fHUDHeightOffset;
+    display.fFPSCap = fFPSCap;
+    display.fCustomFPS = fCustomFPS;
+    display.iFlags = (bUncapFPS ? SharedState::UncapFPS : 0) | (bCustomFPS ? SharedState::CustomFPS : 0);
+    SharedStateWriter.PublishDisplay(display);
 }
 
 // Spdlog sink (truncate on startup, single file)
@@ -247,17 +317,36 @@ void Configuration()
     inipp::get_value(ini.sections["Motion Blur + Frame Generation"], "Enabled", bMotionBlurFramegen);
     inipp::get_value(ini.sections["JPEG XL Tweaks"], "NumThreads", iJXLThreads);
     inipp::get_value(ini.sections["JPEG XL Tweaks"], "Quality", fJXLQuality);
+    inipp::get_value(ini.sections["JPEG XL Tweaks"], "Adaptive", bJXLAdaptive);
+    inipp::get_value(ini.sections["JPEG XL Tweaks"], "TimeBudget", iJXLTimeBudget);
+    inipp::get_value(ini.sections["JPEG XL Tweaks"], "MaxEffort", iJXLMaxEffort);
     inipp::get_value(ini.sections["Disable Graphics Debugger Check"], "Enabled", bDisableDbgCheck);
     inipp::get_value(ini.sections["Disable Depth of Field"], "Enabled", bDisableDOF);
     inipp::get_value(ini.sections["Disable Cinematic Effects"], "Enabled", bDisableCinematicEffects);
     inipp::get_value(ini.sections["Game Window"], "BackgroundAudio", bBackgroundAudio);
     inipp::get_value(ini.sections["Game Window"], "Resizable", bResizableWindow);
     inipp::get_value(ini.sections["Game Window"], "DisableScreensaver", bDisableScreensaver);
+    inipp::get_value(ini.sections["Game Window"], "BackgroundFramerate", fBackgroundFPS);
     inipp::get_value(ini.sections["Dynamic Resolution"], "MaxResolution", iMaxDynRes);
     inipp::get_value(ini.sections["Dynamic Resolution"], "MinResolution", iMinDynRes);
     inipp::get_value(ini.sections["Level of Detail"], "Multiplier", fLODMulti);
+    inipp::get_value(ini.sections["Level of Detail"], "Curve", sLODCurve);
 	inipp::get_value(ini.sections["Gameplay Tweaks"], "AdjustStaggerTimers", bAdjustStaggerTimers);
 	inipp::get_value(ini.sections["Gameplay Tweaks"], "AdjustDamageOutput", bAdjustDamageOutput);
+	inipp::get_value(ini.sections["Combat Log"], "Enabled", bCombatLog);
+	inipp::get_value(ini.sections["Hook Benchmark"], "Enabled", bHookBenchmark);
+	inipp::get_value(ini.sections["Diagnostics"], "Enabled", bDiagnostics);
+	inipp::get_value(ini.sections["Thread Policy"], "Enabled", bThreadPolicy);
+	inipp::get_value(ini.sections["Signature Recovery"], "Enabled", bSignatureRecovery);
+	inipp::get_value(ini.sections["Shared State"], "Enabled", bSharedState);
+	inipp::get_value(ini.sections["State Profiles"], "Enabled", bStateProfiles);
+	inipp::get_value(ini.sections["Hook Trace"], "Enabled", bHookTrace);
+	inipp::get_value(ini.sections["Hook Trace"], "MaxCallsPerHook", iHookTraceMaxCalls);
+	inipp::get_value(ini.sections["Trace"], "Enabled", bTrace);
+	inipp::get_value(ini.sections["Trace"], "Categories", sTraceCategories);
+	inipp::get_value(ini.sections["Trace"], "Hotkey", sTraceHotkey);
+	inipp::get_value(ini.sections["Signature Recovery"], "MaxMismatches", iSignatureRecoveryMismatches);
+	inipp::get_value(ini.sections["Signature Recovery"], "TimeBudget", iSignatureRecoveryTimeBudget);
 	inipp::get_value(ini.sections["Gameplay Tweaks"], "StaggerTimerMultiplierType1", fStaggerTimerMultiplierType1);
 	inipp::get_value(ini.sections["Gameplay Tweaks"], "StaggerTimerMultiplierType2", fStaggerTimerMultiplierType2);
 	inipp::get_value(ini.sections["Gameplay Tweaks"], "StaggerTimerMultiplierType3", fStaggerTimerMultiplierType3);
@@ -322,12 +411,28 @@ void Configuration()
         spdlog::warn("Config Parse: fJXLQuality value invalid, clamped to {}", fJXLQuality);
     }
     spdlog::info("Config Parse: fJXLQuality: {}", fJXLQuality);
+    spdlog::info("Config Parse: bJXLAdaptive: {}", bJXLAdaptive);
+    if (iJXLTimeBudget < 50 || iJXLTimeBudget > 30000) {
+        iJXLTimeBudget = std::clamp(iJXLTimeBudget, 50, 30000);
+        spdlog::warn("Config Parse: iJXLTimeBudget value invalid, clamped to {}", iJXLTimeBudget);
+    }
+    spdlog::info("Config Parse: iJXLTimeBudget: {}", iJXLTimeBudget);
+    if (iJXLMaxEffort < 1 || iJXLMaxEffort > 9) {
+        iJXLMaxEffort = std::clamp(iJXLMaxEffort, 1, 9);
+        spdlog::warn("Config Parse: iJXLMaxEffort value invalid, clamped to {}", iJXLMaxEffort);
+    }
+    spdlog::info("Config Parse: iJXLMaxEffort: {}", iJXLMaxEffort);
     spdlog::info("Config Parse: bDisableDbgCheck: {}", bDisableDbgCheck);
     spdlog::info("Config Parse: bDisableDOF: {}", bDisableDOF);
     spdlog::info("Config Parse: bDisableCinematicEffects: {}", bDisableCinematicEffects);
     spdlog::info("Config Parse: bBackgroundAudio: {}", bBackgroundAudio);
     spdlog::info("Config Parse: bResizableWindow: {}", bResizableWindow);
     spdlog::info("Config Parse: bDisableScreensaver: {}", bDisableScreensaver);
+    if (fBackgroundFPS != 0.0f && (fBackgroundFPS < 1.0f || fBackgroundFPS > 500.0f)) {
+        fBackgroundFPS = std::clamp(fBackgroundFPS, 1.0f, 500.0f);
+        spdlog::warn("Config Parse: fBackgroundFPS value invalid, clamped to {}", fBackgroundFPS);
+    }
+    spdlog::info("Config Parse: fBackgroundFPS: {}", fBackgroundFPS);
     if (iMaxDynRes < 50 || iMaxDynRes > 100) {
         iMaxDynRes = std::clamp(iMaxDynRes, 50, 100);
         spdlog::warn("Config Parse: iMaxDynRes value invalid, clamped to {}", iMaxDynRes);
@@ -343,6 +448,18 @@ void Configuration()
 		spdlog::warn("Config Parse: fLODMulti value invalid, clamped to {}", fLODMulti);
 	}
 	spdlog::info("Config Parse: fLODMulti: {}", fLODMulti);
+	if (!LodCurve::Parse(sLODCurve, LODCurvePoints)) {
+		spdlog::warn("Config Parse: sLODCurve value invalid, ignoring \"{}\"", sLODCurve);
+		LODCurvePoints.clear();
+	}
+	for (auto& point : LODCurvePoints) {
+		if (point.fMultiplier < 0.10f || point.fMultiplier > 10.00f) {
+			point.fMultiplier = std::clamp(point.fMultiplier, 0.10f, 10.00f);
+			spdlog::warn("Config Parse: sLODCurve multiplier at {} invalid, clamped to {}", point.fDistance, point.fMultiplier);
+		}
+	}
+	LODCurve = LodCurve::Compile(LODCurvePoints);
+	spdlog::info("Config Parse: sLODCurve: {}", sLODCurve);
 
 	if ((float)fStaggerTimerMultiplierType1 < 0.00f || (float)fStaggerTimerMultiplierType1 > 100.00f) {
 		fStaggerTimerMultiplierType1 = std::clamp((float)fStaggerTimerMultiplierType1, 0.00f, 100.00f);
@@ -380,11 +497,129 @@ void Configuration()
 	}
 	spdlog::info("Config Parse: fWillDamageScale: {}", fWillDamageScale);
 
+	iHealthDamageScale = DamageScaling::ToFixed(fHealthDamageScale);
+	iCliveDamageScale = DamageScaling::ToFixed(fCliveDamageScale);
+	iWillDamageScale = DamageScaling::ToFixed(fWillDamageScale);
+
+	// Per entity class rules, "<TableIndex> = <health scale>, <will scale>"
+	for (const auto& [sKey, sValue] : ini.sections["Damage Scaling"]) {
+		u64 iTableIndex = 0;
+		float fHealth = 0.0f;
+		float fWill = 0.0f;
+		try {
+			size_t iUsed = 0;
+			iTableIndex = std::stoull(sKey, &iUsed, 0);
+			if (iUsed != sKey.size())
+				throw std::invalid_argument(sKey);
+
+			size_t iComma = sValue.find(',');
+			if (iComma == std::string::npos)
+				throw std::invalid_argument(sValue);
+			fHealth = std::stof(sValue.substr(0, iComma));
+			fWill = std::stof(sValue.substr(iComma + 1));
+		}
+		catch (const std::exception&) {
+			spdlog::warn("Config Parse: Damage Scaling: Ignoring invalid rule \"{} = {}\"", sKey, sValue);
+			continue;
+		}
+
+		if (fHealth < 0.00f || fHealth > 100.00f || fWill < 0.00f || fWill > 100.00f) {
+			fHealth = std::clamp(fHealth, 0.00f, 100.00f);
+			fWill = std::clamp(fWill, 0.00f, 100.00f);
+			spdlog::warn("Config Parse: Damage Scaling: {:#x} value invalid, clamped to {}, {}", iTableIndex, fHealth, fWill);
+		}
+
+		if (!DamageScalingRules.Add(iTableIndex, fHealth, fWill)) {
+			spdlog::warn("Config Parse: Damage Scaling: Ignoring rule for {:#x}, duplicate or too many rules.", iTableIndex);
+			continue;
+		}
+		spdlog::info("Config Parse: Damage Scaling: {:#x}: health = {}, will = {}", iTableIndex, fHealth, fWill);
+	}
+
 	spdlog::info("Config Parse: bAdjustStaggerTimers: {}", bAdjustStaggerTimers);
 	spdlog::info("Config Parse: bAdjustDamageOutput: {}", bAdjustDamageOutput);
+	spdlog::info("Config Parse: bCombatLog: {}", bCombatLog);
+	spdlog::info("Config Parse: bHookBenchmark: {}", bHookBenchmark);
+	spdlog::info("Config Parse: bDiagnostics: {}", bDiagnostics);
+	spdlog::info("Config Parse: bThreadPolicy: {}", bThreadPolicy);
+	spdlog::info("Config Parse: bSignatureRecovery: {}", bSignatureRecovery);
+	if (iSignatureRecoveryMismatches < 0 || iSignatureRecoveryMismatches > (int)Fuzzy::kMaxMismatchLimit) {
+		iSignatureRecoveryMismatches = std::clamp(iSignatureRecoveryMismatches, 0, (int)Fuzzy::kMaxMismatchLimit);
+		spdlog::warn("Config Parse: iSignatureRecoveryMismatches value invalid, clamped to {}", iSignatureRecoveryMismatches);
+	}
+	spdlog::info("Config Parse: iSignatureRecoveryMismatches: {}", iSignatureRecoveryMismatches);
+	if (iSignatureRecoveryTimeBudget < 10 || iSignatureRecoveryTimeBudget > 60000) {
+		iSignatureRecoveryTimeBudget = std::clamp(iSignatureRecoveryTimeBudget, 10, 60000);
+		spdlog::warn("Config Parse: iSignatureRecoveryTimeBudget value invalid, clamped to {}", iSignatureRecoveryTimeBudget);
+	}
+	spdlog::info("Config Parse: iSignatureRecoveryTimeBudget: {}", iSignatureRecoveryTimeBudget);
+	Memory::FuzzyRecovery = { bSignatureRecovery, (size_t)iSignatureRecoveryMismatches, (double)iSignatureRecoveryTimeBudget };
+	spdlog::info("Config Parse: bSharedState: {}", bSharedState);
+	spdlog::info("Config Parse: bHookTrace: {}", bHookTrace);
+	if (iHookTraceMaxCalls < 1 || iHookTraceMaxCalls > 100000) {
+		iHookTraceMaxCalls = std::clamp(iHookTraceMaxCalls, 1, 100000);
+		spdlog::warn("Config Parse: iHookTraceMaxCalls value invalid, clamped to {}", iHookTraceMaxCalls);
+	}
+	spdlog::info("Config Parse: iHookTraceMaxCalls: {}", iHookTraceMaxCalls);
+	spdlog::info("Config Parse: bTrace: {}", bTrace);
+	if (Trace::ParseCategories(sTraceCategories) == 0) {
+		sTraceCategories = "startup, scan, install, hooks";
+		spdlog::warn("Config Parse: sTraceCategories value invalid, set to {}", sTraceCategories);
+	}
+	spdlog::info("Config Parse: sTraceCategories: {}", sTraceCategories);
+	iTraceHotkey = sTraceHotkey.empty() ? 0 : Util::HexStringToInt(sTraceHotkey);
+	if (iTraceHotkey < 0 || iTraceHotkey > 0xFE) {
+		iTraceHotkey = 0;
+		spdlog::warn("Config Parse: iTraceHotkey value invalid, set to {}", iTraceHotkey);
+	}
+	spdlog::info("Config Parse: iTraceHotkey: {:X}", iTraceHotkey);
+
+	// Thread rules, "fix", "jxl", "name:<pattern>" or "module:<pattern>" = "<cores>[, <priority>]"
+	for (const auto& [sKey, sValue] : ini.sections["Thread Policy"]) {
+		if (sKey == "Enabled")
+			continue;
+
+		ThreadPolicy::Rule rule;
+		if (!ThreadPolicy::ParseRule(sKey, sValue, rule)) {
+			spdlog::warn("Config Parse: Thread Policy: Ignoring invalid rule \"{} = {}\"", sKey, sValue);
+			continue;
+		}
+		ThreadPolicyRules.push_back(rule);
+		spdlog::info("Config Parse: Thread Policy: {} = {}", sKey, sValue);
+	}
+
+	// Gameplay uses the settings above, every other state starts from those and overrides what its section sets
+	GameState::Profile BaseProfile = { iMinDynRes, iMaxDynRes, fLODMulti };
+	GameStateTracker.SetProfile(GameState::State::Gameplay, BaseProfile);
+	spdlog::info("Config Parse: bStateProfiles: {}", bStateProfiles);
+	if (bStateProfiles) {
+		for (auto eState : { GameState::State::Combat, GameState::State::Cutscene, GameState::State::Movie, GameState::State::PhotoMode }) {
+			std::string sSection = std::string("Profile ") + GameState::Name(eState);
+			GameState::Profile profile = BaseProfile;
+			inipp::get_value(ini.sections[sSection], "MinResolution", profile.iMinDynRes);
+			inipp::get_value(ini.sections[sSection], "MaxResolution", profile.iMaxDynRes);
+			inipp::get_value(ini.sections[sSection], "LODMultiplier", profile.fLODMulti);
+			if (profile.iMinDynRes < 50 || profile.iMinDynRes > 100 || profile.iMaxDynRes < 50 || profile.iMaxDynRes > 100 ||
+				profile.fLODMulti < 0.10f || profile.fLODMulti > 10.00f) {
+				profile.iMinDynRes = std::clamp(profile.iMinDynRes, 50, 100);
+				profile.iMaxDynRes = std::clamp(profile.iMaxDynRes, 50, 100);
+				profile.fLODMulti = std::clamp(profile.fLODMulti, 0.10f, 10.00f);
+				spdlog::warn("Config Parse: {}: value invalid, clamped to {}-{}%, LOD {}", sSection, profile.iMinDynRes, profile.iMaxDynRes, profile.fLODMulti);
+			}
+			GameStateTracker.SetProfile(eState, profile);
+			spdlog::info("Config Parse: {}: resolution = {}-{}%, LOD = {}", sSection, profile.iMinDynRes, profile.iMaxDynRes, profile.fLODMulti);
+		}
+	}
 
 	spdlog::info("----------");
 
+	// Optional signature pack with build hints and alternate signatures
+	if (Memory::LoadSignaturePack(sThisModulePath / sSigPackFile)) {
+		const auto& header = Memory::SignaturePack.GetHeader();
+		spdlog::info("Signature Pack: Loaded {} ({} signatures, {} build hints).", sThisModulePath.string() + sSigPackFile, header.entryCount, header.hintCount);
+		spdlog::info("----------");
+	}
+
 	// Grab desktop resolution/aspect
 	DesktopDimensions = Util::GetPhysicalDesktopDimensions();
 	iCurrentResX = DesktopDimensions.first;
@@ -392,6 +627,138 @@ void Configuration()
 	CalculateAspectRatio(true);
 }
 
+// Callbacks shared with the replay tool, recorded while the hook trace is on
+void RunHook(HookLogic::Hook eHook, SafetyHookContext& ctx)
+{
+    Trace::Zone zone(Trace::Hooks, HookLogic::kSites[(size_t)eHook].sName);
+    if (HookRecorder.IsActive())
+        HookRecorder.Run(eHook, ctx, HookParams, Util::SafeCopy);
+    else
+        HookLogic::kSites[(size_t)eHook].fn(ctx, HookParams);
+}
+
+// Once a frame, from the current resolution hook
+void UpdateGameState()
+{
+    GameState::Signals signals = { bIsMoviePlaying, ullPhotoModeLastSeen, ullCutsceneLastSeen.load(std::memory_order_relaxed),
+        ullCombatLastSeen.load(std::memory_order_relaxed) };
+    GameState::Transition transition;
+    if (GameStateTracker.Update(signals, GetTickCount64(), transition)) {
+        const GameState::Profile& profile = GameStateTracker.Active();
+        spdlog::info("Game State: {} -> {} after {:.1f}s, resolution = {}-{}%, LOD = {}", GameState::Name(transition.eFrom), GameState::Name(transition.eTo),
+            transition.iDurationMs / 1000.0, profile.iMinDynRes, profile.iMaxDynRes, profile.fLODMulti);
+    }
+}
+
+// Conditional hooks are switched here rather than on the render thread that notices the resolution change, switching
+// one suspends every other thread. Hooks that were busy are retried every 50ms until they're all switched.
+HANDLE hConditionalHooksEvent = NULL;
+
+void ConditionalHooksThread()
+{
+    Util::SetThreadName(sFixName + " Conditional Hooks");
+
+    DWORD dwTimeout = INFINITE;
+    while (true) {
+        WaitForSingleObject(hConditionalHooksEvent, dwTimeout);
+        dwTimeout = Memory::UpdateConditionalHooks() ? INFINITE : 50;
+    }
+}
+
+void StartConditionalHooksThread()
+{
+    hConditionalHooksEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (!hConditionalHooksEvent) {
+        spdlog::error("Conditional Hooks: Failed to create event ({}).", GetLastError());
+        return;
+    }
+    std::thread(ConditionalHooksThread).detach();
+}
+
+void RequestConditionalHooksUpdate()
+{
+    if (hConditionalHooksEvent)
+        SetEvent(hConditionalHooksEvent);
+}
+
+// Writes the latest traced zones over FFXVIFix_trace.json. Never from DllMain, it allocates and does file I/O.
+void ExportTrace()
+{
+    static std::atomic<bool> bExporting = false;
+    if (bExporting.exchange(true))
+        return;
+
+    std::string sJson;
+    uint64_t iLost = 0;
+    Trace::ExportJson(sJson, &iLost);
+    std::ofstream file(sThisModulePath / sTraceFile, std::ios::binary | std::ios::trunc);
+    file.write(sJson.data(), sJson.size());
+    if (!file) {
+        spdlog::error("Trace: Could not write {}.", sThisModulePath.string() + sTraceFile);
+    }
+    else {
+        spdlog::info("Trace: Wrote {:.1f} KB to {} ({} zones overwritten or not recorded).", sJson.size() / 1024.0, sThisModulePath.string() + sTraceFile, iLost);
+    }
+    bExporting = false;
+}
+
+// Times each kind of hook on a synthetic function (see HookBench.hpp), results are logged and appended to
+// FFXVIFix_hookbench.csv so they can be compared between versions.
+void HookBenchmark()
+{
+    constexpr int kIterations = 1'000'000;
+
+    auto code = static_cast<std::uint8_t*>(VirtualAlloc(nullptr, HookBench::kCodeSize, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE));
+    if (!code) {
+        spdlog::error("Hook Bench: Failed to allocate synthetic function.");
+        return;
+    }
+
+    // Stay on one core so the TSC readings are comparable
+    DWORD_PTR oldAffinity = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << GetCurrentProcessorNumber());
+    int iOldPriority = GetThreadPriority(GetCurrentThread());
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+    auto results = HookBench::RunVariants(code, kIterations, [](const char* sName) { spdlog::error("Hook Bench: {}: Failed to create hook.", sName); });
+
+    SetThreadPriority(GetCurrentThread(), iOldPriority);
+    if (oldAffinity)
+        SetThreadAffinityMask(GetCurrentThread(), oldAffinity);
+    VirtualFree(code, 0, MEM_RELEASE);
+
+    auto csvPath = sThisModulePath / sHookBenchFile;
+    bool bNewFile = !std::filesystem::exists(csvPath);
+    std::ofstream csv(csvPath, std::ios::app);
+    if (bNewFile)
+        csv << "time,version,variant,cycles" << std::endl;
+
+    auto tNow = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    for (const auto& [sName, dCycles] : results) {
+        spdlog::info("Hook Bench: {}: {:.1f} cycles/call ({:+.1f} over baseline)", sName, dCycles, dCycles - results.front().second);
+        csv << tNow << "," << sFixVer << "," << sName << "," << dCycles << std::endl;
+    }
+}
+
+// Once a frame, from the current resolution hook. Waits on the foreground event so refocusing ends the wait straight away.
+void LimitBackgroundFramerate()
+{
+    bool bBackground = WaitForSingleObject(hForegroundEvent, 0) == WAIT_TIMEOUT;
+    int64_t iNowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    bool bWasLimiting = BackgroundLimiter.IsLimiting();
+    int64_t iWaitNs = BackgroundLimiter.OnFrame(bBackground, iNowNs);
+    if (BackgroundLimiter.IsLimiting() != bWasLimiting) {
+        if (BackgroundLimiter.IsLimiting())
+            spdlog::info("Background Framerate: Window lost focus, limited to {} FPS.", fBackgroundFPS);
+        else
+            spdlog::info("Background Framerate: Window focused, limit lifted.");
+    }
+
+    if (iWaitNs > 0) {
+        WaitForSingleObject(hForegroundEvent, (DWORD)((iWaitNs + 999999) / 1000000));
+    }
+}
+
 void Resolution()
 {
     if (bFixResolution) {
@@ -400,7 +767,7 @@ void Resolution()
         if (StartupResolutionScanResult) {
             spdlog::info("Startup Resolution: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)StartupResolutionScanResult - (uintptr_t)baseModule);
             Memory::PatchBytes((uintptr_t)StartupResolutionScanResult + 0x4, "\x85", 1);
-            spdlog::info("Startup Resolution: Patched instruction.");
+            spdlog::info("Startup Resolution: Patch queued.");
         }
         else if (!StartupResolutionScanResult) {
             spdlog::error("Startup Resolution: Pattern scan failed.");
@@ -412,7 +779,7 @@ void Resolution()
             spdlog::info("Resolution Fix: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)ResolutionFixScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid ResolutionFixMidHook{};
-            ResolutionFixMidHook = safetyhook::create_mid(ResolutionFixScanResult + 0x5,
+            Memory::CreateMid(ResolutionFixMidHook, ResolutionFixScanResult + 0x5,
                 [](SafetyHookContext& ctx) {
                     ctx.rdi = ctx.r8;
                     ctx.rsi = ctx.r9;
@@ -427,7 +794,7 @@ void Resolution()
         if (WindowedResolutionsScanResult) {
             spdlog::info("Windowed Resolutions: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)WindowedResolutionsScanResult - (uintptr_t)baseModule);
             static SafetyHookMid WindowedResolutionsMidHook{};
-            WindowedResolutionsMidHook = safetyhook::create_mid(WindowedResolutionsScanResult,
+            Memory::CreateMid(WindowedResolutionsMidHook, WindowedResolutionsScanResult,
                 [](SafetyHookContext& ctx) {
                     // Change first resolution option (seems to be 8K?)
                     if (ctx.rax + 0x4 && ctx.rbx == 0) {
@@ -456,17 +823,46 @@ void Resolution()
         spdlog::info("Current Resolution: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)CurrentResolutionScanResult - (uintptr_t)baseModule);
 
         static SafetyHookMid CurrentResolutionMidHook{};
-        CurrentResolutionMidHook = safetyhook::create_mid(CurrentResolutionScanResult,
+        bFrameCounterHooked = true;
+        Memory::CreateMid(CurrentResolutionMidHook, CurrentResolutionScanResult,
             [](SafetyHookContext& ctx) {
+                Trace::Zone zone(Trace::Hooks, "Current Resolution");
+                iFrameCounter.fetch_add(1, std::memory_order_relaxed);
+
                 // Get current resolution
                 int iResX = static_cast<int>(ctx.rax & 0xFFFFFFFF);
                 int iResY = static_cast<int>((ctx.rax >> 32) & 0xFFFFFFFF);
 
-                // Log resolution
-                if (iResX != iCurrentResX || iResY != iCurrentResY) {
+                static bool bResizePending = false;
+                bool bChanged = iResX != iCurrentResX || iResY != iCurrentResY;
+                if (bChanged) {
                     iCurrentResX = iResX;
                     iCurrentResY = iResY;
+                }
+
+                if (bChanged && bSizeMove) {
+                    // Dragging the window edge changes the resolution every frame, keep the HUD values right but leave
+                    // logging and switching hooks until it's let go
+                    CalculateAspectRatio(false);
+                    Memory::UpdateConstantPatches();
+                    bResizePending = true;
+                }
+                else if (bChanged || (bResizePending && !bSizeMove)) {
+                    // Log resolution
                     CalculateAspectRatio(true);
+                    Memory::UpdateConstantPatches();
+                    bResizePending = false;
+
+                    // Switch off hooks that have nothing to do at this aspect ratio
+                    RequestConditionalHooksUpdate();
+                }
+
+                if (bStateProfiles) {
+                    UpdateGameState();
+                }
+
+                if (hForegroundEvent) {
+                    LimitBackgroundFramerate();
                 }
             });
     }
@@ -479,10 +875,14 @@ void Resolution()
     if (FSRFramegenAspectScanResult) {
         spdlog::info("FSR Framegen Aspect: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)FSRFramegenAspectScanResult - (uintptr_t)baseModule);
 
+        // Point the aspect ratio load at our own slot, the mid hook is only needed if it isn't the expected vmovss
         static SafetyHookMid FSRFramegenAspectMidHook{};
-        FSRFramegenAspectMidHook = safetyhook::create_mid(FSRFramegenAspectScanResult + 0xE,
-            [](SafetyHookContext& ctx) {
-                ctx.xmm0.f32[0] = fAspectRatio;
+        Memory::CreateConstantPatch("FSR Framegen Aspect", FSRFramegenAspectScanResult + 0x6, Patch::Op::Load, 0, [] { return fAspectRatio; }, nullptr,
+            [FSRFramegenAspectScanResult] {
+                Memory::CreateMid(FSRFramegenAspectMidHook, FSRFramegenAspectScanResult + 0xE,
+                    [](SafetyHookContext& ctx) {
+                        ctx.xmm0.f32[0] = fAspectRatio;
+                    });
             });
     }
     else if (!FSRFramegenAspectScanResult) {
@@ -495,13 +895,9 @@ void Resolution()
         spdlog::info("Vignette Strength: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)VignetteStrengthScanResult - (uintptr_t)baseModule);
 
         static SafetyHookMid VignetteStrengthMidHook{};
-        VignetteStrengthMidHook = safetyhook::create_mid(VignetteStrengthScanResult + 0x12,
+        Memory::CreateConditionalMid("Vignette Strength", VignetteStrengthMidHook, VignetteStrengthScanResult + 0x12, [] { return fAspectRatio > fNativeAspect; },
             [](SafetyHookContext& ctx) {
-                if (fAspectRatio > fNativeAspect) {
-                    if (ctx.r15 + 0x6C) {
-                        *reinterpret_cast<float*>(ctx.r15 + 0x6C) = 1.00f / fAspectMultiplier;
-                    }
-                }
+                RunHook(HookLogic::Hook::VignetteStrength, ctx);
             });
     }
     else if (!VignetteStrengthScanResult) {
@@ -518,19 +914,9 @@ void HUD()
             spdlog::info("HUD: HUD Size: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)HUDSizeScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid HUDSizeMidHook{};
-            HUDSizeMidHook = safetyhook::create_mid(HUDSizeScanResult + 0x6,
+            Memory::CreateMid(HUDSizeMidHook, HUDSizeScanResult + 0x6,
                 [](SafetyHookContext& ctx) {
-                    // Make the hud size the same as the current resolution
-                    ctx.r12 = ctx.rdi;
-                    ctx.r15 = ctx.rbp;
-
-                    // Pillarboxing/letterboxing
-                    ctx.r13 = 0;
-                    ctx.rax = 0; // -> [rsp+40]
-
-                    if (ctx.rsp + 0x40) {
-                        *reinterpret_cast<int*>(ctx.rsp + 0x40) = 0;
-                    }
+                    RunHook(HookLogic::Hook::HUDSize, ctx);
                 });
         }
         else if (!HUDSizeScanResult) {
@@ -543,9 +929,12 @@ void HUD()
             spdlog::info("HUD: HUD Pillarboxing: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)HUDPillarboxingScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid HUDPillarboxingMidHook{};
-            HUDPillarboxingMidHook = safetyhook::create_mid(HUDPillarboxingScanResult,
-                [](SafetyHookContext& ctx) {
-                    ctx.xmm5.f32[0] = fAspectRatio;
+            Memory::CreateConstantPatch("HUD Pillarboxing", HUDPillarboxingScanResult, Patch::Op::Set, 5, [] { return fAspectRatio; }, nullptr,
+                [HUDPillarboxingScanResult] {
+                    Memory::CreateMid(HUDPillarboxingMidHook, HUDPillarboxingScanResult,
+                        [](SafetyHookContext& ctx) {
+                            ctx.xmm5.f32[0] = fAspectRatio;
+                        });
                 });
         }
         else if (!HUDPillarboxingScanResult) {
@@ -558,7 +947,7 @@ void HUD()
             spdlog::info("HUD: Gameplay HUD Width: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)GameplayHUDWidthScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid GameplayHUDWidthMidHook{};
-            GameplayHUDWidthMidHook = safetyhook::create_mid(GameplayHUDWidthScanResult,
+            Memory::CreateMid(GameplayHUDWidthMidHook, GameplayHUDWidthScanResult,
                 [](SafetyHookContext& ctx) {
                     if (ctx.xmm2.f32[0] > fNativeAspect) {
                         switch (iHUDSize) {
@@ -593,7 +982,7 @@ void HUD()
             spdlog::info("HUD: Gameplay HUD Height: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)GameplayHUDHeightScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid GameplayHUDHeightMidHook{};
-            GameplayHUDHeightMidHook = safetyhook::create_mid(GameplayHUDHeightScanResult,
+            Memory::CreateMid(GameplayHUDHeightMidHook, GameplayHUDHeightScanResult,
                 [](SafetyHookContext& ctx) {
                     if (ctx.xmm2.f32[0] < fNativeAspect) {
                         switch (iHUDSize) {
@@ -628,7 +1017,7 @@ void HUD()
             spdlog::info("HUD: Eikon Cursor: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)EikonCursorScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid EikonCursorWidthOffsetMidHook{};
-            EikonCursorWidthOffsetMidHook = safetyhook::create_mid(EikonCursorScanResult + 0x22,
+            Memory::CreateConditionalMid("Eikon Cursor Width", EikonCursorWidthOffsetMidHook, EikonCursorScanResult + 0x22, [] { return fAspectRatio > fNativeAspect; },
                 [](SafetyHookContext& ctx) {
                     if (fAspectRatio > fNativeAspect) {
                         ctx.xmm0.f32[0] += fEikonCursorWidthOffset;
@@ -636,7 +1025,7 @@ void HUD()
                 });
 
             static SafetyHookMid EikonCursorHeightOffsetMidHook{};
-            EikonCursorHeightOffsetMidHook = safetyhook::create_mid(EikonCursorScanResult,
+            Memory::CreateConditionalMid("Eikon Cursor Height", EikonCursorHeightOffsetMidHook, EikonCursorScanResult, [] { return fAspectRatio < fNativeAspect; },
                 [](SafetyHookContext& ctx) {
                     if (fAspectRatio < fNativeAspect) {
                         ctx.xmm0.f32[0] += fEikonCursorHeightOffset;
@@ -653,18 +1042,12 @@ void HUD()
             spdlog::info("HUD: Photo Mode Blur: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)PhotoModeBgBlurScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid PhotoModeBgBlurMidHook{};
-            PhotoModeBgBlurMidHook = safetyhook::create_mid(PhotoModeBgBlurScanResult,
+            Memory::CreateMid(PhotoModeBgBlurMidHook, PhotoModeBgBlurScanResult,
                 [](SafetyHookContext& ctx) {
-                    if (ctx.rcx + 0x40) {
-                        // Check size, should be 660x1080
-                        if ((*reinterpret_cast<int*>(ctx.rcx + 0x40) >= 655 && *reinterpret_cast<int*>(ctx.rcx + 0x40) <= 665) && (*reinterpret_cast<int*>(ctx.rcx + 0x44) >= 1075 && *reinterpret_cast<int*>(ctx.rcx + 0x44) <= 1085)) {
-                            // Check horizontal position
-                            if ((*reinterpret_cast<float*>(ctx.rcx + 0xB0) >= -675.00f && *reinterpret_cast<float*>(ctx.rcx + 0xB0) <= -665.00f) || (*reinterpret_cast<float*>(ctx.rcx + 0xB0) >= 1925.00f && *reinterpret_cast<float*>(ctx.rcx + 0xB0) <= 1935.00f)) {
-                                // Write 0 to width
-                                *reinterpret_cast<int*>(ctx.rcx + 0x40) = 0;
-                            }
-                        }
-                    }
+                    // Only runs while the photo mode UI is up
+                    ullPhotoModeLastSeen = GetTickCount64();
+
+                    RunHook(HookLogic::Hook::PhotoModeBlur, ctx);
                 });
         }
         else if (!PhotoModeBgBlurScanResult) {
@@ -677,27 +1060,9 @@ void HUD()
             spdlog::info("HUD: Fades: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)FadeToBlackScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid FadeToBlackMidHook{};
-            FadeToBlackMidHook = safetyhook::create_mid(FadeToBlackScanResult,
+            Memory::CreateConditionalMid("Fades", FadeToBlackMidHook, FadeToBlackScanResult, [] { return fAspectRatio != fNativeAspect; },
                 [](SafetyHookContext& ctx) {
-                    // Fade to black is 1940x1100. TODO: Add another check here?
-                    if (ctx.rdx == (int)1940 && ctx.r8 == (int)1100) {
-                        if (ctx.rcx + 0x38 && ctx.rcx + 0x3C) {
-                            if (fAspectRatio > fNativeAspect) {
-                                float fWidth = ceilf(1080.00f * fAspectRatio);
-                                float fWidthOffset = ceilf((fWidth - 1920.00f) / 2);
-
-                                ctx.rdx = (int)fWidth;
-                                *reinterpret_cast<int*>(ctx.rcx + 0x38) = (int)-fWidthOffset;
-                            }
-                            else if (fAspectRatio < fNativeAspect) {
-                                float fHeight = ceilf(1920.00f / fAspectRatio);
-                                float fHeightOffset = ceilf((fHeight - 1080.00f) / 2);
-
-                                ctx.r8 = (int)fHeight;
-                                *reinterpret_cast<int*>(ctx.rcx + 0x3C) = (int)-fHeightOffset;
-                            }
-                        }
-                    }
+                    RunHook(HookLogic::Hook::Fades, ctx);
                 });
         }
         else if (!FadeToBlackScanResult) {
@@ -705,14 +1070,14 @@ void HUD()
         }
     }
 
-    if (bFixMovies && !bAltFixMovies) {
+    if ((bFixMovies && !bAltFixMovies) || bStateProfiles) {
         // Get movie status 
         uint8_t* MovieStatusScanResult = Memory::PatternScan(baseModule, "0F 84 ?? ?? ?? ?? C5 ?? ?? ?? ?? ?? ?? ?? C4 ?? ?? ?? ?? 48 8B ?? 80 ?? ?? ?? ?? ?? 02");
         if (MovieStatusScanResult) {
             spdlog::info("HUD: Movies: Status: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)MovieStatusScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid MovieStatusMidHook{};
-            MovieStatusMidHook = safetyhook::create_mid(MovieStatusScanResult,
+            Memory::CreateMid(MovieStatusMidHook, MovieStatusScanResult,
                 [](SafetyHookContext& ctx) {
                     // Check zero flag 
                     if ((ctx.rflags & (1 << 6)) == 0)
@@ -727,7 +1092,9 @@ void HUD()
         else if (!MovieStatusScanResult) {
             spdlog::error("HUD: Movies: Status: Pattern scan failed.");
         }
+    }
 
+    if (bFixMovies && !bAltFixMovies) {
         // Movie size
         uint8_t* MovieSize1ScanResult = Memory::PatternScan(baseModule, "44 89 ?? ?? ?? 44 89 ?? ?? ?? C5 ?? ?? ?? ?? 41 ?? ?? ?? 77 ??");
         uint8_t* MovieSize2ScanResult = Memory::PatternScan(baseModule, "49 ?? ?? 4C 89 ?? ?? 4C 89 ?? ?? E8 ?? ?? ?? ?? 8B ?? ?? ?? 48 8D ?? ??");
@@ -736,14 +1103,17 @@ void HUD()
             spdlog::info("HUD: Movies: Size: 2: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)MovieSize2ScanResult - (uintptr_t)baseModule);
 
             static bool bUpdate = false;
+            static BinLog::Callsite MovieSize1Log("Movie Size 1: {}x{} -> {}x{} (aspect {:.4f})", 2);
 
             static SafetyHookMid MovieSize1MidHook{};
-            MovieSize1MidHook = safetyhook::create_mid(MovieSize1ScanResult,
+            Memory::CreateConditionalMid("Movie Size 1", MovieSize1MidHook, MovieSize1ScanResult, [] { return fAspectRatio != fNativeAspect; },
                 [](SafetyHookContext& ctx) {
                     bUpdate = false;
 
                     // Force an update which forces the second hook to execute
                     if (bIsMoviePlaying) {
+                        uint32_t iOriginalWidth = (uint32_t)ctx.r10;
+                        uint32_t iOriginalHeight = (uint32_t)ctx.r11;
                         if (fAspectRatio > fNativeAspect) {
                             ctx.r10 = (int)std::round(fHUDWidth);
                         }
@@ -751,11 +1121,12 @@ void HUD()
                             ctx.r11 = (int)std::round(fHUDHeight);
                         }
                         bUpdate = true;
+                        MovieSize1Log.Write(iOriginalWidth, iOriginalHeight, (uint32_t)ctx.r10, (uint32_t)ctx.r11, fAspectRatio);
                     }
                 });
 
             static SafetyHookMid MovieSize2MidHook{};
-            MovieSize2MidHook = safetyhook::create_mid(MovieSize2ScanResult,
+            Memory::CreateConditionalMid("Movie Size 2", MovieSize2MidHook, MovieSize2ScanResult, [] { return fAspectRatio != fNativeAspect; },
                 [](SafetyHookContext& ctx) {
                     if (bIsMoviePlaying && bUpdate) {
                         if (fAspectRatio > fNativeAspect) {
@@ -777,7 +1148,7 @@ void HUD()
             spdlog::info("HUD: Movies: Offset: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)MovieOffsetScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid MovieOffsetMidHook{};
-            MovieOffsetMidHook = safetyhook::create_mid(MovieOffsetScanResult,
+            Memory::CreateConditionalMid("Movie Offset", MovieOffsetMidHook, MovieOffsetScanResult, [] { return fAspectRatio != fNativeAspect; },
                 [](SafetyHookContext& ctx) {
                     if (bIsMoviePlaying) {
                         if (fAspectRatio > fNativeAspect) {
@@ -807,7 +1178,7 @@ void HUD()
             Memory::PatchBytes((uintptr_t)AltMoviesScanResult + 0x1E, "\x4C", 1);
 
             static SafetyHookMid AltMoviesMidHook{};
-            AltMoviesMidHook = safetyhook::create_mid(AltMoviesScanResult + 0xF,
+            Memory::CreateMid(AltMoviesMidHook, AltMoviesScanResult + 0xF,
                 [](SafetyHookContext& ctx) {
                     float Width = ctx.xmm0.f32[0];
                     float Height = ctx.xmm1.f32[0];
@@ -849,7 +1220,7 @@ void Camera()
 			spdlog::info("FOV: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)FOVScanResult - (uintptr_t)baseModule);
 
 			static SafetyHookMid FOVMidHook{};
-			FOVMidHook = safetyhook::create_mid(FOVScanResult,
+			Memory::CreateConditionalMid("FOV", FOVMidHook, FOVScanResult, [] { return fAspectRatio < fNativeAspect; },
 				[](SafetyHookContext& ctx) {
 					// Fix cropped FOV when at <16:9
 					if (fAspectRatio < fNativeAspect) {
@@ -871,7 +1242,7 @@ void Camera()
 			spdlog::info("Gameplay Camera: FOV: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)GameplayFOVScanResult - (uintptr_t)baseModule);
 
 			static SafetyHookMid GameplayFOVMidHook{};
-			GameplayFOVMidHook = safetyhook::create_mid(GameplayFOVScanResult + 0x10,
+			Memory::CreateMid(GameplayFOVMidHook, GameplayFOVScanResult + 0x10,
 				[](SafetyHookContext& ctx) {
 					float fov = std::clamp(ctx.xmm0.f32[0] + fGameplayCamFOV, 1.0f, 179.0f);
 					ctx.xmm0.f32[0] = fov;
@@ -886,7 +1257,7 @@ void Camera()
 		uint8_t* LockOnFOVScanResult = Memory::PatternScan(baseModule, "c5 fa ?? ?? ?? ?? ?? ?? c3 cc cc cc 48 8b 42 ?? 48 89 41"); // a function that returns 0.6981317f from rodata, called from a function pointer at the sig 'ff 90 ?? ?? 00 00 c5 fa 11 47 ?? 48 8b 03 48 8b cb'
 		if (LockOnFOVScanResult) {
 			spdlog::info("Gameplay Camera: LockOn FOV: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)LockOnFOVScanResult - (uintptr_t)baseModule);
-			sLockOnFOVInlineHook = safetyhook::create_inline(reinterpret_cast<void*>(LockOnFOVScanResult), LockOnFOVHook);
+			Memory::CreateInline(sLockOnFOVInlineHook, reinterpret_cast<void*>(LockOnFOVScanResult), LockOnFOVHook);
 		}
 		else if (!LockOnFOVScanResult) {
 			spdlog::error("Gameplay Camera: LockOn FOV: Pattern scan failed.");
@@ -900,7 +1271,7 @@ void Camera()
 			spdlog::info("Gameplay Camera: Position: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)GameplayCameraPosScanResult - (uintptr_t)baseModule);
 
 			static SafetyHookMid GameplayCameraHorPosMidHook{};
-			GameplayCameraHorPosMidHook = safetyhook::create_mid(GameplayCameraPosScanResult + 0x8,
+			Memory::CreateMid(GameplayCameraHorPosMidHook, GameplayCameraPosScanResult + 0x8,
 				[](SafetyHookContext& ctx) {
 					if (fGameplayCamHorPos != 0.95f)
 						ctx.xmm1.f32[0] = fGameplayCamHorPos;
@@ -921,9 +1292,12 @@ void Camera()
 			spdlog::info("Gameplay Camera: Distance: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)GameplayCameraDistScanResult - (uintptr_t)baseModule);
 
 			static SafetyHookMid GameplayCameraDistMidHook{};
-			GameplayCameraDistMidHook = safetyhook::create_mid(GameplayCameraDistScanResult,
-				[](SafetyHookContext& ctx) {
-					ctx.xmm3.f32[0] *= fGameplayCamDistMulti;
+			Memory::CreateConstantPatch("Gameplay Camera: Distance", GameplayCameraDistScanResult, Patch::Op::Multiply, 3, [] { return fGameplayCamDistMulti; }, nullptr,
+				[GameplayCameraDistScanResult] {
+					Memory::CreateMid(GameplayCameraDistMidHook, GameplayCameraDistScanResult,
+						[](SafetyHookContext& ctx) {
+							ctx.xmm3.f32[0] *= fGameplayCamDistMulti;
+						});
 				});
 		}
 		else if (!GameplayCameraDistScanResult) {
@@ -941,20 +1315,36 @@ void Framerate()
             spdlog::info("FPS: Cutscene Framerate Cap: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)CutsceneFramerateCapScanResult - (uintptr_t)baseModule);
             int iFPSCap = static_cast<int>(fFPSCap * 100.00f);
             Memory::Write((uintptr_t)CutsceneFramerateCapScanResult + 0xC, (int)iFPSCap);
-            spdlog::info("FPS: Cutscene Framerate Cap: Patched instruction and set framerate cap to {:d}.", iFPSCap);
+            spdlog::info("FPS: Cutscene Framerate Cap: Patch queued, framerate cap set to {:d}.", iFPSCap);
         }
         else if (!CutsceneFramerateCapScanResult) {
             spdlog::error("FPS: Cutscene Framerate Cap: Pattern scan failed.");
         }
     }
 
-    if (bUncapFPS) {  
+    if (bUncapFPS || bStateProfiles) {  
         // Remove 30fps framerate cap
         uint8_t* FramerateCapScanResult = Memory::PatternScan(baseModule, "75 ?? 85 ?? 74 ?? 40 ?? 01 41 ?? ?? ?? ?? ?? ?? ??");
         if (FramerateCapScanResult) {
             spdlog::info("FPS: Disable Cutscene Framerate Cap: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)FramerateCapScanResult - (uintptr_t)baseModule);
-            Memory::PatchBytes((uintptr_t)FramerateCapScanResult + 0x8, "\x00", 1);
-            spdlog::info("FPS: Disable Cutscene Framerate Cap: Patched instruction.");
+            if (bUncapFPS) {
+                Memory::PatchBytes((uintptr_t)FramerateCapScanResult + 0x8, "\x00", 1);
+                spdlog::info("FPS: Disable Cutscene Framerate Cap: Patch queued.");
+            }
+
+            if (bStateProfiles) {
+                // The je skips setting the cap flag, not taken = the game wants the cutscene cap.
+                // Hooked after the patch above is queued so the relocated flag write keeps it.
+                static SafetyHookMid CutsceneStateMidHook{};
+                Memory::CreateMid(CutsceneStateMidHook, FramerateCapScanResult + 0x4,
+                    [](SafetyHookContext& ctx) {
+                        // Check zero flag
+                        if ((ctx.rflags & (1 << 6)) == 0) {
+                            ullCutsceneLastSeen.store(GetTickCount64(), std::memory_order_relaxed);
+                        }
+                    });
+                spdlog::info("Game State: Cutscene: Hook queued.");
+            }
         }
         else if (!FramerateCapScanResult) {
             spdlog::error("FPS: Disable Cutscene Framerate Cap: Pattern scan failed.");
@@ -967,7 +1357,7 @@ void Framerate()
         if (CutsceneFramegenScanResult) {
             spdlog::info("FPS: Cutscene Frame Generation: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)CutsceneFramegenScanResult - (uintptr_t)baseModule);
             Memory::PatchBytes((uintptr_t)CutsceneFramegenScanResult + 0x3, "\xEB", 1);
-            spdlog::info("FPS: Cutscene Frame Generation: Patched instruction.");
+            spdlog::info("FPS: Cutscene Frame Generation: Patch queued.");
         }
         else if (!CutsceneFramegenScanResult) {
             spdlog::error("FPS: Cutscene Frame Generation: Pattern scan failed.");
@@ -979,7 +1369,7 @@ void Framerate()
         if (GameplayFramerateCapScanResult) {
             spdlog::info("FPS: Custom Framerate: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)GameplayFramerateCapScanResult - (uintptr_t)baseModule);
             static SafetyHookMid GameplayFramerateCapMidHook{};
-            GameplayFramerateCapMidHook = safetyhook::create_mid(GameplayFramerateCapScanResult,
+            Memory::CreateMid(GameplayFramerateCapMidHook, GameplayFramerateCapScanResult,
                 [](SafetyHookContext& ctx) {
                     int iNumerator = static_cast<int>(ctx.rdx & 0xFFFFFFFF);
                     int iDenominator = static_cast<int>((ctx.rdx >> 32) & 0xFFFFFFFF);
@@ -1011,7 +1401,7 @@ void Misc()
             // Stop the game from setting the motion blur float to 0 when frame generation is enabled.
             Memory::PatchBytes((uintptr_t)FrameGenMotionBlurLogicScanResult, "\xEB", 1);
 
-            spdlog::info("Frame Generation Motion Blur: Patched instructions.");
+            spdlog::info("Frame Generation Motion Blur: Patches queued.");
         }
         else if (!FrameGenMotionBlurLockoutScanResult || !FrameGenMotionBlurLogicScanResult) {
             spdlog::error("Frame Generation Motion Blur: Pattern scan failed.");
@@ -1024,7 +1414,7 @@ void Misc()
         if (GraphicsDbgCheckScanResult) {
             spdlog::info("Graphics Debugger Check: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)GraphicsDbgCheckScanResult - (uintptr_t)baseModule);
             Memory::PatchBytes((uintptr_t)GraphicsDbgCheckScanResult, "\xEB", 1);
-            spdlog::info("Graphics Debugger Check: Patched instruction.");
+            spdlog::info("Graphics Debugger Check: Patch queued.");
         }
         else if (!GraphicsDbgCheckScanResult) {
             spdlog::error("Graphics Debugger Check: Pattern scan failed.");
@@ -1038,11 +1428,11 @@ void Misc()
         if (DepthofFieldScanResult && NearDepthofFieldScanResult) {
             spdlog::info("Disable Depth of Field: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)DepthofFieldScanResult - (uintptr_t)baseModule);
             Memory::PatchBytes((uintptr_t)DepthofFieldScanResult, "\xEB", 1);
-            spdlog::info("Disable Depth of Field: Patched instruction.");
+            spdlog::info("Disable Depth of Field: Patch queued.");
 
             spdlog::info("Disable Depth of Field: Near: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)NearDepthofFieldScanResult - (uintptr_t)baseModule);
             Memory::PatchBytes((uintptr_t)NearDepthofFieldScanResult, "\xEB", 1);
-            spdlog::info("Disable Depth of Field: Near: Patched instruction.");
+            spdlog::info("Disable Depth of Field: Near: Patch queued.");
         }
         else if (!DepthofFieldScanResult || !NearDepthofFieldScanResult) {
             spdlog::error("Disable Depth of Field: Pattern scan failed.");
@@ -1056,7 +1446,7 @@ void Misc()
             spdlog::info("Cinematic Effects: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)CinematicEffectsScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid CinematicEffectsMidHook{};
-            CinematicEffectsMidHook = safetyhook::create_mid(CinematicEffectsScanResult,
+            Memory::CreateMid(CinematicEffectsMidHook, CinematicEffectsScanResult,
                 [](SafetyHookContext& ctx) {
                     if (ctx.rcx & 0x0B) {
                         ctx.rcx = (ctx.rcx & ~0xFF) | 0x03;
@@ -1072,18 +1462,22 @@ void Misc()
         }
     }
 
-    if (iMaxDynRes != 95 || iMinDynRes != 50) {
+    if (GameStateTracker.AnyProfile([](const GameState::Profile& profile) { return profile.iMaxDynRes != 95 || profile.iMinDynRes != 50; })) {
         // Dynamic resolution upper/lower bounds
         uint8_t* DynamicResBoundsScanResult = Memory::PatternScan(baseModule, "0F ?? ?? ?? 3A ?? 0F ?? ?? 0F ?? ?? 0F ?? ?? ?? 3B ?? 0F ?? ?? 3B ?? 0F ?? ?? ??");
         if (DynamicResBoundsScanResult) {
             spdlog::info("Dynamic Resolution: Bounds: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)DynamicResBoundsScanResult - (uintptr_t)baseModule);
 
+            static BinLog::Callsite DynamicResBoundsLog("Dynamic Resolution: Bounds: {}%-{}% -> {}%-{}%", 1);
+
             static SafetyHookMid DynamicResBoundsMidHook{};
-            DynamicResBoundsMidHook = safetyhook::create_mid(DynamicResBoundsScanResult,
+            Memory::CreateMid(DynamicResBoundsMidHook, DynamicResBoundsScanResult,
                 [](SafetyHookContext& ctx) {
                     if (ctx.rdi + 0x22) {
-                        *reinterpret_cast<BYTE*>(ctx.rdi + 0x22) = static_cast<BYTE>(iMaxDynRes); // Max scale
-                        *reinterpret_cast<BYTE*>(ctx.rdi + 0x20) = static_cast<BYTE>(iMinDynRes); // Min scale
+                        const GameState::Profile& profile = GameStateTracker.Active();
+                        DynamicResBoundsLog.Write(*reinterpret_cast<BYTE*>(ctx.rdi + 0x20), *reinterpret_cast<BYTE*>(ctx.rdi + 0x22), profile.iMinDynRes, profile.iMaxDynRes);
+                        *reinterpret_cast<BYTE*>(ctx.rdi + 0x22) = static_cast<BYTE>(profile.iMaxDynRes); // Max scale
+                        *reinterpret_cast<BYTE*>(ctx.rdi + 0x20) = static_cast<BYTE>(profile.iMinDynRes); // Min scale
                     }
                 });
         }
@@ -1092,16 +1486,17 @@ void Misc()
         }
     }
 
-    if (fLODMulti != 1.00f) {
+    if (!LODCurvePoints.empty() || GameStateTracker.AnyProfile([](const GameState::Profile& profile) { return profile.fLODMulti != 1.00f; })) {
         // LOD distance
         uint8_t* LevelOfDetailScanResult = Memory::PatternScan(baseModule, "44 ?? ?? ?? ?? ?? ?? 75 ?? C5 ?? ?? ?? ?? ?? ?? ?? C5 ?? ?? E8 ?? ?? ?? ??");
         if (LevelOfDetailScanResult) {
             spdlog::info("LOD Distance: Framerate: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)LevelOfDetailScanResult - (uintptr_t)baseModule);
 
             static SafetyHookMid LevelOfDetailMidHook{};
-            LevelOfDetailMidHook = safetyhook::create_mid(LevelOfDetailScanResult,
+            Memory::CreateMid(LevelOfDetailMidHook, LevelOfDetailScanResult,
                 [](SafetyHookContext& ctx) {
-                    ctx.xmm6.f32[0] *= fLODMulti;
+                    // xmm6 = base LOD distance
+                    ctx.xmm6.f32[0] *= LODCurve.Evaluate(ctx.xmm6.f32[0]) * GameStateTracker.Active().fLODMulti;
                 });
         }
         else if (!LevelOfDetailScanResult) {
@@ -1110,6 +1505,147 @@ void Misc()
     }
 }
 
+// Thread policy
+ThreadPolicy::Topology CpuTopology;
+std::atomic<bool> bThreadPolicyActive = false; // Read from DllMain, set once the topology and rules are ready
+std::mutex ThreadPolicyMutex;
+std::map<DWORD, const ThreadPolicy::Rule*> ThreadPolicyApplied; // Last rule applied to each thread
+std::map<DWORD, bool> JxlWorkerThreads;
+
+// Threads starting, exiting or found to be JXL workers, queued for the policy thread. DllMain only pushes and signals,
+// everything else (querying the thread, the maps, logging) happens on the policy thread outside of the loader lock.
+enum class ThreadEventKind : uint8_t
+{
+    Started,
+    Exited,
+    Jxl,
+};
+
+struct ThreadEvent
+{
+    DWORD dwThreadId;
+    ThreadEventKind eKind;
+};
+
+MpscRing<ThreadEvent, 1024> ThreadEvents;
+HANDLE hThreadPolicyEvent = NULL;
+
+void QueueThreadEvent(DWORD dwThreadId, ThreadEventKind eKind)
+{
+    ThreadEvents.Push({ dwThreadId, eKind });
+    SetEvent(hThreadPolicyEvent);
+}
+
+void ApplyThreadPolicy(DWORD dwThreadId, HANDLE hThread, bool bLog)
+{
+    HMODULE startModule = Util::GetThreadStartModule(hThread);
+
+    ThreadPolicy::ThreadInfo thread;
+    thread.sName = Util::GetThreadName(hThread);
+    thread.sModule = Util::GetModuleName(startModule);
+    thread.bFixOwned = startModule == thisModule || thread.sName.starts_with(sFixName);
+
+    std::scoped_lock lock(ThreadPolicyMutex);
+    thread.bJxl = JxlWorkerThreads.contains(dwThreadId);
+
+    // Only touch a thread when the rule that applies to it changes, so sweeps leave alone whatever the game set since
+    auto decision = ThreadPolicy::Evaluate(CpuTopology, ThreadPolicyRules, thread);
+    auto& lastRule = ThreadPolicyApplied[dwThreadId];
+    if (!decision.pRule || decision.pRule == lastRule)
+        return;
+    lastRule = decision.pRule;
+
+    if (decision.bAffinity) {
+        GROUP_AFFINITY affinity{ .Mask = (KAFFINITY)decision.iMask, .Group = decision.iGroup };
+        if (!SetThreadGroupAffinity(hThread, &affinity, nullptr) && bLog)
+            spdlog::warn("Thread Policy: Failed to set affinity of thread {} ({}).", dwThreadId, GetLastError());
+    }
+    if (decision.bPriority) {
+        if (!SetThreadPriority(hThread, decision.iPriority) && bLog)
+            spdlog::warn("Thread Policy: Failed to set priority of thread {} ({}).", dwThreadId, GetLastError());
+    }
+
+    if (bLog) {
+        spdlog::info("Thread Policy: Thread {} (name = \"{}\", module = {}, fix = {}, jxl = {}): affinity = {}, priority = {}",
+            dwThreadId, thread.sName, thread.sModule, thread.bFixOwned, thread.bJxl,
+            decision.bAffinity ? fmt::format("{}:{:#x}", decision.iGroup, decision.iMask) : "unchanged",
+            decision.bPriority ? std::to_string(decision.iPriority) : "unchanged");
+    }
+}
+
+void ApplyThreadPolicy(DWORD dwThreadId, bool bLog)
+{
+    if (HANDLE hThread = OpenThread(THREAD_QUERY_INFORMATION | THREAD_SET_INFORMATION, FALSE, dwThreadId)) {
+        ApplyThreadPolicy(dwThreadId, hThread, bLog);
+        CloseHandle(hThread);
+    }
+}
+
+void ThreadPolicyThread()
+{
+    Util::SetThreadName(sFixName + " Thread Policy");
+
+    // Threads are checked as they start (queued by DllMain), but most get their name afterwards so go over all of them now and then
+    DWORD dwResult = WAIT_TIMEOUT;
+    while (true) {
+        ThreadEvent event;
+        while (ThreadEvents.Pop(event)) {
+            std::unique_lock lock(ThreadPolicyMutex);
+            switch (event.eKind) {
+            case ThreadEventKind::Started:
+                // Thread IDs are reused, forget whatever was applied to an earlier thread with this one
+                ThreadPolicyApplied.erase(event.dwThreadId);
+                JxlWorkerThreads.erase(event.dwThreadId);
+                lock.unlock();
+                ApplyThreadPolicy(event.dwThreadId, false);
+                break;
+            case ThreadEventKind::Exited:
+                ThreadPolicyApplied.erase(event.dwThreadId);
+                JxlWorkerThreads.erase(event.dwThreadId);
+                break;
+            case ThreadEventKind::Jxl:
+                JxlWorkerThreads[event.dwThreadId] = true;
+                ThreadPolicyApplied.erase(event.dwThreadId);
+                lock.unlock();
+                ApplyThreadPolicy(event.dwThreadId, true);
+                break;
+            }
+        }
+
+        if (dwResult == WAIT_TIMEOUT) {
+            for (DWORD dwThreadId : Util::GetProcessThreadIds())
+                ApplyThreadPolicy(dwThreadId, true);
+        }
+        dwResult = WaitForSingleObject(hThreadPolicyEvent, 30000);
+    }
+}
+
+void ThreadScheduling()
+{
+    if (bThreadPolicy && !ThreadPolicyRules.empty()) {
+        CpuTopology = Util::GetCpuTopology();
+        size_t iCores = 0, iL3 = 0;
+        for (const auto& processor : CpuTopology.vProcessors) {
+            iCores = std::max<size_t>(iCores, processor.iCore + 1);
+            iL3 = std::max<size_t>(iL3, processor.iL3 + 1);
+        }
+        spdlog::info("Thread Policy: {} logical processors, {} cores, {} L3 domains, hybrid = {}", CpuTopology.vProcessors.size(), iCores, iL3, CpuTopology.IsHybrid());
+        for (const auto& processor : CpuTopology.vProcessors) {
+            spdlog::debug("Thread Policy: CPU {}:{}: core {}, efficiency class {}, L3 {}{}", processor.iGroup, processor.iNumber, processor.iCore,
+                processor.iEfficiencyClass, processor.iL3, processor.bFirstOnCore ? "" : " (SMT)");
+        }
+
+        hThreadPolicyEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+        if (!hThreadPolicyEvent) {
+            spdlog::error("Thread Policy: Failed to create event ({}).", GetLastError());
+            return;
+        }
+
+        bThreadPolicyActive = true;
+        std::thread(ThreadPolicyThread).detach();
+    }
+}
+
 // JXL Hooks
 SafetyHookInline JxlEncoderDistanceFromQuality_sh{};
 float JxlEncoderDistanceFromQuality_hk(float quality)
@@ -1126,12 +1662,232 @@ size_t JxlThreadParallelRunnerDefaultNumWorkerThreads_hk(void)
     return iJXLThreads;
 }
 
+// The workers are std::threads (start address in the CRT, no name), so they're told apart by running the encoder's
+// work items: JxlThreadParallelRunner is given a wrapper around them that reports the thread the first time it runs one.
+// Types from libjxl's parallel_runner.h.
+using JxlParallelRunInit = int(*)(void* jpegxl_opaque, size_t num_threads);
+using JxlParallelRunFunction = void(*)(void* jpegxl_opaque, uint32_t value, size_t thread_id);
+
+struct JxlRunContext
+{
+    void* jpegxl_opaque;
+    JxlParallelRunInit init;
+    JxlParallelRunFunction func;
+    DWORD dwCallerThreadId; // Runs the work itself when there are no workers, it isn't one
+};
+
+int JxlRunInit_wrap(void* opaque, size_t num_threads)
+{
+    auto context = static_cast<JxlRunContext*>(opaque);
+    return context->init(context->jpegxl_opaque, num_threads);
+}
+
+void JxlRunFunction_wrap(void* opaque, uint32_t value, size_t thread_id)
+{
+    auto context = static_cast<JxlRunContext*>(opaque);
+    thread_local bool bReported = false;
+    if (!bReported && GetCurrentThreadId() != context->dwCallerThreadId) {
+        bReported = true;
+        QueueThreadEvent(GetCurrentThreadId(), ThreadEventKind::Jxl);
+    }
+    context->func(context->jpegxl_opaque, value, thread_id);
+}
+
+SafetyHookInline JxlThreadParallelRunner_sh{};
+int JxlThreadParallelRunner_hk(void* runner_opaque, void* jpegxl_opaque, JxlParallelRunInit init, JxlParallelRunFunction func, uint32_t start_range, uint32_t end_range)
+{
+    // The runner returns once every work item is done, so the context can live on this stack
+    JxlRunContext context{ jpegxl_opaque, init, func, GetCurrentThreadId() };
+    return JxlThreadParallelRunner_sh.fastcall<int>(runner_opaque, &context, JxlRunInit_wrap, JxlRunFunction_wrap, start_range, end_range);
+}
+
+// Adaptive JXL encoding
+// Encoder status/setting values from libjxl's encode.h
+constexpr int JXL_ENC_SUCCESS = 0;
+constexpr int JXL_ENC_FRAME_SETTING_EFFORT = 0;
+
+struct JXLEncodeState
+{
+    uint32_t iWidth = 0;
+    uint32_t iHeight = 0;
+    int64_t iGameEffort = -1; // Effort requested by the game, -1 if it never set one
+    int iEffort = 0;
+    float fDistance = 0.00f;
+    double dEstimatedMs = 0.0;
+    std::chrono::steady_clock::time_point tStart{};
+    bool bEncoding = false;
+};
+std::mutex JXLEncodeMutex;
+JXLEncodeState JXLEncode;
+
+// Rough single-thread cost in milliseconds per megapixel for effort 1-9, corrected at runtime from measured encode times
+double JXLEffortCost[10] = { 0.0, 2.0, 6.0, 10.0, 25.0, 45.0, 60.0, 90.0, 300.0, 800.0 };
+
+bool IsGameplayActive()
+{
+    // Photo mode background blur hook fires every frame while photo mode is open
+    return !bIsMoviePlaying && (GetTickCount64() - ullPhotoModeLastSeen) > 2000;
+}
+
+void SelectJXLEncodeSettings(JXLEncodeState& state, float fBaseDistance)
+{
+    double dMegapixels = ((double)state.iWidth * (double)state.iHeight) / 1000000.0;
+    double dThreadScale = 1.0 / std::max(1.0, iJXLThreads * 0.8); // Workers don't scale perfectly
+    double dBudgetMs = IsGameplayActive() ? iJXLTimeBudget / 2.0 : (double)iJXLTimeBudget;
+
+    // Highest effort that fits in the time budget
+    int iEffort = 1;
+    for (int i = iJXLMaxEffort; i >= 1; i--) {
+        if (JXLEffortCost[i] * dMegapixels * dThreadScale <= dBudgetMs) {
+            iEffort = i;
+            break;
+        }
+    }
+
+    // Never go above what the game asked for
+    if (state.iGameEffort > 0)
+        iEffort = std::min(iEffort, (int)state.iGameEffort);
+
+    state.iEffort = iEffort;
+    state.dEstimatedMs = JXLEffortCost[iEffort] * dMegapixels * dThreadScale;
+
+    // If even the fastest effort blows the budget, trade some quality for size/time
+    float fDistanceScale = std::clamp((float)(state.dEstimatedMs / dBudgetMs), 1.00f, 2.00f);
+    state.fDistance = std::clamp(fBaseDistance * fDistanceScale, 0.00f, 25.00f);
+}
+
+SafetyHookInline JxlEncoderSetBasicInfo_sh{};
+int JxlEncoderSetBasicInfo_hk(void* enc, const uint32_t* info)
+{
+    // JxlBasicInfo: JXL_BOOL have_container, uint32_t xsize, uint32_t ysize, ...
+    if (info) {
+        std::scoped_lock lock(JXLEncodeMutex);
+        JXLEncode.iWidth = info[1];
+        JXLEncode.iHeight = info[2];
+        JXLEncode.iGameEffort = -1;
+    }
+    return JxlEncoderSetBasicInfo_sh.fastcall<int>(enc, info);
+}
+
+SafetyHookInline JxlEncoderFrameSettingsSetOption_sh{};
+int JxlEncoderFrameSettingsSetOption_hk(void* frame_settings, int option, int64_t value)
+{
+    if (option == JXL_ENC_FRAME_SETTING_EFFORT) {
+        std::scoped_lock lock(JXLEncodeMutex);
+        JXLEncode.iGameEffort = value;
+    }
+    return JxlEncoderFrameSettingsSetOption_sh.fastcall<int>(frame_settings, option, value);
+}
+
+using JxlEncoderSetFrameDistance_t = int(*)(void* frame_settings, float distance);
+JxlEncoderSetFrameDistance_t JxlEncoderSetFrameDistance_fn = nullptr;
+
+SafetyHookInline JxlEncoderAddImageFrame_sh{};
+int JxlEncoderAddImageFrame_hk(void* frame_settings, const void* pixel_format, const void* buffer, size_t size)
+{
+    // Image size and the game's settings are all known by the time a frame is added
+    {
+        std::scoped_lock lock(JXLEncodeMutex);
+        if (JXLEncode.iWidth != 0 && JXLEncode.iHeight != 0) {
+            float fBaseDistance = JxlEncoderDistanceFromQuality_sh.fastcall<float>(fJXLQuality);
+            SelectJXLEncodeSettings(JXLEncode, fBaseDistance);
+
+            JxlEncoderFrameSettingsSetOption_sh.fastcall<int>(frame_settings, JXL_ENC_FRAME_SETTING_EFFORT, (int64_t)JXLEncode.iEffort);
+            JxlEncoderSetFrameDistance_fn(frame_settings, JXLEncode.fDistance);
+
+            spdlog::info("JXL Tweaks: Adaptive: {}x{}, gameplay = {}, game effort = {}, effort = {}, distance = {:.3f}, estimated = {:.0f}ms",
+                JXLEncode.iWidth, JXLEncode.iHeight, IsGameplayActive(), JXLEncode.iGameEffort, JXLEncode.iEffort, JXLEncode.fDistance, JXLEncode.dEstimatedMs);
+
+            JXLEncode.tStart = std::chrono::steady_clock::now();
+            JXLEncode.bEncoding = true;
+        }
+    }
+    return JxlEncoderAddImageFrame_sh.fastcall<int>(frame_settings, pixel_format, buffer, size);
+}
+
+SafetyHookInline JxlEncoderProcessOutput_sh{};
+int JxlEncoderProcessOutput_hk(void* enc, uint8_t** next_out, size_t* avail_out)
+{
+    int result = JxlEncoderProcessOutput_sh.fastcall<int>(enc, next_out, avail_out);
+
+    if (result == JXL_ENC_SUCCESS) {
+        std::scoped_lock lock(JXLEncodeMutex);
+        if (std::exchange(JXLEncode.bEncoding, false)) {
+            double dEncodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - JXLEncode.tStart).count();
+            spdlog::info("JXL Tweaks: Adaptive: Encode took {:.0f}ms (estimated {:.0f}ms) at effort {}", dEncodeMs, JXLEncode.dEstimatedMs, JXLEncode.iEffort);
+
+            // Nudge the cost model towards what we measured
+            if (JXLEncode.dEstimatedMs > 0.0) {
+                double dCorrection = std::clamp(dEncodeMs / JXLEncode.dEstimatedMs, 0.25, 4.0);
+                JXLEffortCost[JXLEncode.iEffort] *= (1.0 + dCorrection) / 2.0;
+            }
+        }
+    }
+
+    return result;
+}
+
+// Loader notifications, used to wait for the JXL libraries without polling
+typedef struct _LDR_DLL_NOTIFICATION_DATA {
+    ULONG Flags;
+    PCUNICODE_STRING FullDllName;
+    PCUNICODE_STRING BaseDllName;
+    PVOID DllBase;
+    ULONG SizeOfImage;
+} LDR_DLL_NOTIFICATION_DATA, *PLDR_DLL_NOTIFICATION_DATA;
+
+typedef VOID(CALLBACK* PLDR_DLL_NOTIFICATION_FUNCTION)(ULONG NotificationReason, PLDR_DLL_NOTIFICATION_DATA NotificationData, PVOID Context);
+typedef NTSTATUS(NTAPI* LdrRegisterDllNotification_t)(ULONG Flags, PLDR_DLL_NOTIFICATION_FUNCTION NotificationFunction, PVOID Context, PVOID* Cookie);
+typedef NTSTATUS(NTAPI* LdrUnregisterDllNotification_t)(PVOID Cookie);
+
+constexpr ULONG LDR_DLL_NOTIFICATION_REASON_LOADED = 1;
+
+VOID CALLBACK DllLoadedNotification(ULONG NotificationReason, PLDR_DLL_NOTIFICATION_DATA NotificationData, PVOID Context)
+{
+    // Called with the loader lock held, just wake the waiting thread
+    if (NotificationReason == LDR_DLL_NOTIFICATION_REASON_LOADED)
+        SetEvent((HANDLE)Context);
+}
+
+void WaitForModules(std::initializer_list<LPCWSTR> modules)
+{
+    Pipeline::ScopedPhase phase(Pipeline::Phase::Wait);
+
+    auto bAllLoaded = [&]() {
+        for (LPCWSTR module : modules) {
+            if (!GetModuleHandle(module))
+                return false;
+        }
+        return true;
+    };
+
+    HMODULE ntdllModule = GetModuleHandleW(L"ntdll.dll");
+    auto LdrRegisterDllNotification_fn = (LdrRegisterDllNotification_t)GetProcAddress(ntdllModule, "LdrRegisterDllNotification");
+    auto LdrUnregisterDllNotification_fn = (LdrUnregisterDllNotification_t)GetProcAddress(ntdllModule, "LdrUnregisterDllNotification");
+
+    HANDLE hLoadedEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    PVOID pCookie = nullptr;
+    if (hLoadedEvent && LdrRegisterDllNotification_fn && LdrUnregisterDllNotification_fn)
+        LdrRegisterDllNotification_fn(0, DllLoadedNotification, hLoadedEvent, &pCookie);
+
+    // Fall back to polling if the notification couldn't be registered
+    while (!bAllLoaded()) {
+        if (pCookie)
+            WaitForSingleObject(hLoadedEvent, INFINITE);
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    if (pCookie)
+        LdrUnregisterDllNotification_fn(pCookie);
+    if (hLoadedEvent)
+        CloseHandle(hLoadedEvent);
+}
+
 void JXL()
 {
     // JXL Tweaks
-    while (!GetModuleHandle(L"jxl.dll") || !GetModuleHandle(L"jxl_threads.dll")) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+    WaitForModules({ L"jxl.dll", L"jxl_threads.dll" });
 
     HMODULE jxlLib = GetModuleHandle(L"jxl.dll");
     HMODULE jxlThreadsLib = GetModuleHandle(L"jxl_threads.dll");
@@ -1152,16 +1908,51 @@ void JXL()
     spdlog::info("JXL Tweaks: JxlEncoderDistanceFromQuality address = {:x}", (uintptr_t)JxlEncoderDistanceFromQuality_fn);
     spdlog::info("JXL Tweaks: JxlThreadParallelRunnerDefaultNumWorkerThreads address = {:x}", (uintptr_t)JxlThreadParallelRunnerDefaultNumWorkerThreads_fn);
 
-    JxlEncoderDistanceFromQuality_sh = safetyhook::create_inline(JxlEncoderDistanceFromQuality_fn, reinterpret_cast<void*>(JxlEncoderDistanceFromQuality_hk));
-    JxlThreadParallelRunnerDefaultNumWorkerThreads_sh = safetyhook::create_inline(JxlThreadParallelRunnerDefaultNumWorkerThreads_fn, reinterpret_cast<void*>(JxlThreadParallelRunnerDefaultNumWorkerThreads_hk));
-    spdlog::info("JXL Tweaks: Hooked functions.");
+    Memory::CreateInline(JxlEncoderDistanceFromQuality_sh, JxlEncoderDistanceFromQuality_fn, reinterpret_cast<void*>(JxlEncoderDistanceFromQuality_hk));
+    Memory::CreateInline(JxlThreadParallelRunnerDefaultNumWorkerThreads_sh, JxlThreadParallelRunnerDefaultNumWorkerThreads_fn, reinterpret_cast<void*>(JxlThreadParallelRunnerDefaultNumWorkerThreads_hk));
+    spdlog::info("JXL Tweaks: Hooks queued.");
+
+    if (bThreadPolicyActive) {
+        FARPROC JxlThreadParallelRunner_fn = GetProcAddress(jxlThreadsLib, "JxlThreadParallelRunner");
+        if (!JxlThreadParallelRunner_fn) {
+            spdlog::error("JXL Tweaks: Thread Policy: Failed to get function address.");
+        }
+        else {
+            Memory::CreateInline(JxlThreadParallelRunner_sh, JxlThreadParallelRunner_fn, reinterpret_cast<void*>(JxlThreadParallelRunner_hk));
+            spdlog::info("JXL Tweaks: Thread Policy: JxlThreadParallelRunner hook queued.");
+        }
+    }
+
+    if (bJXLAdaptive) {
+        FARPROC JxlEncoderSetBasicInfo_fn = GetProcAddress(jxlLib, "JxlEncoderSetBasicInfo");
+        FARPROC JxlEncoderFrameSettingsSetOption_fn = GetProcAddress(jxlLib, "JxlEncoderFrameSettingsSetOption");
+        JxlEncoderSetFrameDistance_fn = reinterpret_cast<JxlEncoderSetFrameDistance_t>(GetProcAddress(jxlLib, "JxlEncoderSetFrameDistance"));
+        FARPROC JxlEncoderAddImageFrame_fn = GetProcAddress(jxlLib, "JxlEncoderAddImageFrame");
+        FARPROC JxlEncoderProcessOutput_fn = GetProcAddress(jxlLib, "JxlEncoderProcessOutput");
+
+        if (!JxlEncoderSetBasicInfo_fn || !JxlEncoderFrameSettingsSetOption_fn || !JxlEncoderSetFrameDistance_fn || !JxlEncoderAddImageFrame_fn || !JxlEncoderProcessOutput_fn) {
+            spdlog::error("JXL Tweaks: Adaptive: Failed to get function addresses.");
+            return;
+        }
+
+        Memory::CreateInline(JxlEncoderSetBasicInfo_sh, JxlEncoderSetBasicInfo_fn, reinterpret_cast<void*>(JxlEncoderSetBasicInfo_hk));
+        Memory::CreateInline(JxlEncoderFrameSettingsSetOption_sh, JxlEncoderFrameSettingsSetOption_fn, reinterpret_cast<void*>(JxlEncoderFrameSettingsSetOption_hk));
+        Memory::CreateInline(JxlEncoderAddImageFrame_sh, JxlEncoderAddImageFrame_fn, reinterpret_cast<void*>(JxlEncoderAddImageFrame_hk));
+        Memory::CreateInline(JxlEncoderProcessOutput_sh, JxlEncoderProcessOutput_fn, reinterpret_cast<void*>(JxlEncoderProcessOutput_hk));
+        spdlog::info("JXL Tweaks: Adaptive: Hooks queued.");
+    }
 }
 
 HHOOK   hkCallWndProc  = NULL;
 WNDPROC OldWndProc     = NULL;
 HWND    hWndGame       = NULL;
 BOOL    bWindowFocused = FALSE;
-BOOL    bSizeMove      = FALSE;
+BOOL    bFocusDirty    = TRUE; // Check focus on the first message after subclassing
+UINT    uFocusChangedMsg = 0;
+Focus::StateMachine FocusState;
+
+static_assert(Focus::Message::Activate == WM_ACTIVATE && Focus::Message::SetFocus == WM_SETFOCUS && Focus::Message::KillFocus == WM_KILLFOCUS &&
+    Focus::Message::ActivateApp == WM_ACTIVATEAPP && Focus::Message::NcActivate == WM_NCACTIVATE);
 
 SafetyHookInline ShowWindow_sh{};
 BOOL
@@ -1188,6 +1979,16 @@ LRESULT __stdcall NewWndProc(HWND window, UINT message_type, WPARAM w_param, LPA
     if (window != hWndGame)
         return CallWindowProc(OldWndProc, window, message_type, w_param, l_param);
 
+    // Hotkey for writing out the trace, ignoring auto-repeat
+    if (bTrace && iTraceHotkey && (message_type == WM_KEYDOWN || message_type == WM_SYSKEYDOWN) && w_param == (WPARAM)iTraceHotkey && !(l_param & (1 << 30))) {
+        std::thread([] { ExportTrace(); }).detach();
+    }
+
+    // Last export before the game exits, from the window thread rather than DLL_PROCESS_DETACH under the loader lock
+    if (bTrace && message_type == WM_DESTROY) {
+        ExportTrace();
+    }
+
     // Game does not process Win32 keyboard or mouse messages, and this causes
     //   windows to beep on system keys and other events. Just block all of these
     if ((message_type >= WM_KEYFIRST   && message_type <= WM_KEYLAST) ||
@@ -1199,34 +2000,52 @@ LRESULT __stdcall NewWndProc(HWND window, UINT message_type, WPARAM w_param, LPA
 
     BOOL style_changed    = FALSE;
 
-    HWND hWndForeground =
-          GetForegroundWindow ();
+    // Only ask user32 who is in the foreground when something focus related
+    // happened, every other message runs with the cached state
+    BOOL focus_check = std::exchange(bFocusDirty, FALSE);
+    if (Focus::IsFocusMessage(message_type, uFocusChangedMsg))
+        focus_check = TRUE;
 
-    if (hWndForeground == hWndGame || GetTopWindow (NULL) == hWndGame) {
-        if (!std::exchange(bWindowFocused, true)) {
-            // Get styles
-            LONG lStyle   = GetWindowLong(window, GWL_STYLE);
-            LONG lExStyle = GetWindowLong(window, GWL_EXSTYLE);
+    Focus::Action focus_action = Focus::Action::None;
 
-            // Add re-sizable style and enable maximize button
-            if (bResizableWindow) {
-                // Check for borderless/fullscreen styles
-                if ((lStyle & WS_THICKFRAME) != WS_THICKFRAME && (lStyle & WS_POPUP) == 0 && (lExStyle & WS_EX_TOPMOST) == 0) {
-                    // Add resizable + maximize styles
-                    lStyle |= (WS_THICKFRAME | WS_MAXIMIZEBOX);
-                    SetWindowLong(window, GWL_STYLE, lStyle);
+    if (focus_check) {
+        HWND hWndForeground =
+              GetForegroundWindow ();
 
-                    style_changed = TRUE;
-                }
-            }
+        focus_action =
+            FocusState.OnEvent ((hWndForeground == hWndGame || GetTopWindow (NULL) == hWndGame) ? Focus::Event::Foreground
+                                                                                                 : Focus::Event::Background);
+        bWindowFocused = FocusState.IsActive ();
 
-            CallWindowProc(OldWndProc, hWndGame, WM_ACTIVATE, WA_CLICKACTIVE, 0);
+        if (hForegroundEvent) {
+            if (FocusState.IsForeground ())
+                SetEvent   (hForegroundEvent);
+            else
+                ResetEvent (hForegroundEvent);
         }
     }
-    else if (!bBackgroundAudio) {
-        if (std::exchange(bWindowFocused, false)) {
-            CallWindowProc(OldWndProc, hWndGame, WM_ACTIVATE, WA_INACTIVE, 0);
+
+    if (focus_action == Focus::Action::Activate) {
+        // Get styles
+        LONG lStyle   = GetWindowLong(window, GWL_STYLE);
+        LONG lExStyle = GetWindowLong(window, GWL_EXSTYLE);
+
+        // Add re-sizable style and enable maximize button
+        if (bResizableWindow) {
+            // Check for borderless/fullscreen styles
+            if ((lStyle & WS_THICKFRAME) != WS_THICKFRAME && (lStyle & WS_POPUP) == 0 && (lExStyle & WS_EX_TOPMOST) == 0) {
+                // Add resizable + maximize styles
+                lStyle |= (WS_THICKFRAME | WS_MAXIMIZEBOX);
+                SetWindowLong(window, GWL_STYLE, lStyle);
+
+                style_changed = TRUE;
+            }
         }
+
+        CallWindowProc(OldWndProc, hWndGame, WM_ACTIVATE, WA_CLICKACTIVE, 0);
+    }
+    else if (focus_action == Focus::Action::Deactivate) {
+        CallWindowProc(OldWndProc, hWndGame, WM_ACTIVATE, WA_INACTIVE, 0);
     }
 
     switch (message_type) {
@@ -1257,6 +2076,10 @@ LRESULT __stdcall NewWndProc(HWND window, UINT message_type, WPARAM w_param, LPA
         return DefWindowProcW(window, message_type, w_param, l_param);
     }
 
+    // Our own wake-up message, the game doesn't need to see it. 0 (WM_NULL) if registering it failed.
+    if (uFocusChangedMsg != 0 && message_type == uFocusChangedMsg)
+        return 0;
+
     if (style_changed) // Force window to update
       SetWindowPos(window, NULL, 0, 0, 0, 0, SWP_FRAMECHANGED | SWP_NOMOVE   |
                                                    SWP_NOSIZE | SWP_NOZORDER | SWP_NOREPOSITION);
@@ -1270,13 +2093,27 @@ void SubclassGameWindow (HWND hWnd)
     if (user32Module) {
         FARPROC ShowWindow_fn = GetProcAddress(user32Module, "ShowWindow");
         if (ShowWindow_fn) {
-            ShowWindow_sh = safetyhook::create_inline(ShowWindow_fn, reinterpret_cast<void*>(ShowWindow_hk));
+            // One submission, so the window is never subclassed while the ShowWindow hook is still queued
+            Pipeline::Installer::Get().Submit([hWnd, ShowWindow_fn] {
+                Trace::Zone zone(Trace::Install, "create_inline", (uintptr_t)ShowWindow_fn);
+                ShowWindow_sh = safetyhook::create_inline(reinterpret_cast<void*>(ShowWindow_fn), reinterpret_cast<void*>(ShowWindow_hk));
+
+                // Set new wnd proc
+                OldWndProc = (WNDPROC)SetWindowLongPtr(hWnd, GWLP_WNDPROC, (LONG_PTR)NewWndProc);
+                spdlog::info("Window Focus: Subclassed Game Window");
+
+                hWndGame = hWnd;
 
-            // Set new wnd proc
-            OldWndProc = (WNDPROC)SetWindowLongPtr(hWnd, GWLP_WNDPROC, (LONG_PTR)NewWndProc);
-            spdlog::info("Window Focus: Subclassed Game Window");
+                auto lExStyle = GetWindowLongPtrW(hWndGame, GWL_EXSTYLE);
 
-            hWndGame = hWnd;
+                // The game does not have AppWindow style, so it does not
+                // correctly register itself to appear in the taskbar and
+                // activate the way applications are supposed to...
+                if ((lExStyle & WS_EX_APPWINDOW) == 0) {
+                    lExStyle |= WS_EX_APPWINDOW;
+                    SetWindowLongPtrW(hWndGame, GWL_EXSTYLE, lExStyle);
+                }
+            });
         }
         else {
             spdlog::error("Window Focus: Failed to get function address for ShowWindow.");
@@ -1301,20 +2138,17 @@ LRESULT CALLBACK CallWndProcHook (
     wchar_t wnd_class_name [32];
     HWND    hWndMsg = ((CWPSTRUCT *)lParam)->hwnd;
 
+    // Every message for every window on the thread comes through here until
+    // the game window shows up, so remember which windows were already checked
+    static Focus::CheckedWindows checked_wnds;
+
+    if (! checked_wnds.CheckOnce (hWndMsg))
+        return ret;
+
     if (RealGetWindowClassW (hWndMsg, wnd_class_name, 31) > 0) {
         if (! wcscmp (wnd_class_name, sWindowClassName)) {
             UnhookWindowsHookEx (hkCallWndProc);
             SubclassGameWindow  (hWndMsg);
-
-            auto lExStyle = GetWindowLongPtrW(hWndGame, GWL_EXSTYLE);
-
-            // The game does not have AppWindow style, so it does not
-            // correctly register itself to appear in the taskbar and
-            // activate the way applications are supposed to...
-            if ((lExStyle & WS_EX_APPWINDOW) == 0) {
-                lExStyle |= WS_EX_APPWINDOW;
-                SetWindowLongPtrW(hWndGame, GWL_EXSTYLE, lExStyle);
-            }
         }
     }
 
@@ -1340,62 +2174,247 @@ DWORD GetMainThreadId (void)
     return 0;
 }
 
-void WindowFocus()
+void CALLBACK ForegroundEventProc (
+  HWINEVENTHOOK hWinEventHook,
+  DWORD         event,
+  HWND          hWnd,
+  LONG          idObject,
+  LONG          idChild,
+  DWORD         idEventThread,
+  DWORD         dwmsEventTime )
+{
+    // Wake the game's window thread so NewWndProc can deal with the
+    // game's stupid handling of window activation
+    if (hWndGame != 0 && uFocusChangedMsg != 0)
+        PostMessage (hWndGame, uFocusChangedMsg, 0, 0);
+}
+
+void WindowFocusThread()
 {
-    if (bBackgroundAudio || bResizableWindow || bDisableScreensaver) {
-        // Hook wndproc and then subclass the window when we find the game's main window
-        hkCallWndProc =
-          SetWindowsHookExW (WH_CALLWNDPROC, CallWndProcHook, 0, GetMainThreadId ());
+    Util::SetThreadName(sFixName + " Window Focus");
 
-        if (hkCallWndProc != 0)
+    // Hook wndproc and then subclass the window when we find the game's main window
+    hkCallWndProc =
+      SetWindowsHookExW (WH_CALLWNDPROC, CallWndProcHook, 0, GetMainThreadId ());
+
+    if (hkCallWndProc != 0)
+    {
+        // Foreground changes are delivered to this thread's message queue,
+        // so it sleeps in GetMessage until one actually happens
+        HWINEVENTHOOK hkForeground =
+          SetWinEventHook (EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, NULL,
+                           ForegroundEventProc, 0, 0, WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNTHREAD);
+
+        if (hkForeground == 0) {
+            spdlog::error("Window Focus: Failed to set foreground event hook.");
+            return;
+        }
+
+        MSG msg = {};
+        while (GetMessage (&msg, 0, 0, 0) > 0)
         {
-            // Loop and periodically wake the game's window thread to deal with
-            // stupid handling of window activation by the game
-            MSG msg = {};
-            do
-            {
-                Sleep (666UL);
+            TranslateMessage (&msg);
+            DispatchMessage  (&msg);
+        }
+
+        UnhookWinEvent (hkForeground);
+    }
+}
 
-                if (hWndGame != 0)
-                    SendMessage (hWndGame, WM_NULL, 0, 0);
+void WindowFocus()
+{
+    if (bBackgroundAudio || bResizableWindow || bDisableScreensaver || fBackgroundFPS > 0.0f) {
+        FocusState.SetKeepActiveInBackground (bBackgroundAudio);
 
-                PeekMessage (&msg, 0, 0, 0, 0);
-            } while (msg.message != WM_QUIT);
+        // Starts out set so nothing is limited before the first focus check
+        if (fBackgroundFPS > 0.0f) {
+            BackgroundLimiter.SetFramerate (fBackgroundFPS);
+            hForegroundEvent = CreateEventW (NULL, TRUE, TRUE, NULL);
         }
+        uFocusChangedMsg = RegisterWindowMessageW (L"FFXVIFix_FocusChanged");
+        if (uFocusChangedMsg == 0) {
+            spdlog::error("Window Focus: Failed to register focus message ({}), focus is only checked on activation messages.", GetLastError());
+        }
+
+        // Both hooks belong to the thread that installs them, so they get a thread
+        // of their own that lives for the rest of the session
+        std::thread (WindowFocusThread).detach ();
     }
 }
 
 static SafetyHookInline sNormalDamageInlineHook{};
 static SafetyHookInline sWillDamageInlineHook{};
+static SafetyHookInline sObjectTableIteratorInlineHook{};
+
+Entities::SnapshotBuffer EntitySnapshot;
+std::atomic<uint64_t> iLastSnapshotFrame = 0;
+std::atomic_flag bBuildingSnapshot; // SnapshotBuffer::Build and PublishFrame take one thread at a time
+bool bEntitySnapshot = false; // Set when the iterator is hooked, cleared by CheckEntitySnapshot before any hook is applied
+
+// Copies the snapshot that was just built to the shared state, only called by the thread that built it
+void PublishEntities() {
+	LARGE_INTEGER timestamp;
+	QueryPerformanceCounter(&timestamp);
+
+	const Entities::Snapshot& snapshot = EntitySnapshot.Latest();
+	SharedStateWriter.PublishFrame(timestamp.QuadPart, [&](SharedState::Entity* entities, u32 iMax) {
+		u32 iCount = (u32)std::min<size_t>(snapshot.iCount, iMax);
+		for (u32 i = 0; i < iCount; i++) {
+			const CombatDetail* combat = snapshot.Combat[i];
+			entities[i] = { snapshot.TableIndex[i], (u64)combat, snapshot.Health[i], snapshot.Will[i], snapshot.StaggerType[i], snapshot.StaggerTimer[i],
+				combat->Prone, combat->WillBarHalf, {} };
+		}
+		return iCount;
+		});
+}
+
+// Runs in the Commit task once every feature has been scanned. The snapshot is rebuilt once per frame and the only frame
+// counter comes from the Current Resolution hook, without it the snapshot would never be built.
+void CheckEntitySnapshot() {
+	if (!bEntitySnapshot || bFrameCounterHooked)
+		return;
+
+	bEntitySnapshot = false;
+	spdlog::error("Object Table Iterator: Entity snapshot needs the Current Resolution hook to count frames and is disabled.");
+	if (bAdjustDamageOutput && !DamageScalingRules.Empty())
+		spdlog::error("Object Table Iterator: Damage scaling rules are disabled.");
+	if (bCombatLog)
+		spdlog::error("Object Table Iterator: Combat log records will have no table index.");
+	if (bSharedState)
+		spdlog::error("Object Table Iterator: Shared state won't publish entity frames.");
+}
+
+void GameplayTweak_ObjectTableIteratorHook(uintptr_t arg1, Struct_Param2* arg2) {
+	// The iterator runs as a parallel job, every worker calls it for the same table within a few microseconds.
+	// Let the first one in build the snapshot and skip the rest until the next frame.
+	u64 iFrame = iFrameCounter.load(std::memory_order_relaxed);
+	if (bEntitySnapshot && iLastSnapshotFrame.load(std::memory_order_relaxed) != iFrame && !bBuildingSnapshot.test_and_set(std::memory_order_acquire)) {
+		// Checked again now that no other thread can be building
+		if (iLastSnapshotFrame.load(std::memory_order_relaxed) != iFrame) {
+			iLastSnapshotFrame.store(iFrame, std::memory_order_relaxed);
+			EntitySnapshot.Build(arg2);
+			if (SharedStateWriter.IsOpen())
+				PublishEntities();
+		}
+		bBuildingSnapshot.clear(std::memory_order_release);
+	}
+
+	sObjectTableIteratorInlineHook.call(arg1, arg2);
+}
+
+// Combat events, one ring per game thread that records
+SpscRingPool<CombatLog::Event, 1024, 16> CombatEvents;
+
+void RecordCombatEvent(CombatLog::Kind kind, const CombatDetail* combat, s32 delta, u32 before, u32 after, u8 staggerType = 0, float timer = 0.0f) {
+	LARGE_INTEGER timestamp;
+	QueryPerformanceCounter(&timestamp);
+
+	Entities::Record entity;
+	u64 tableIndex = EntitySnapshot.Find(combat, entity) ? entity.TableIndex : 0;
+
+	CombatEvents.Push({ (u64)timestamp.QuadPart, (u64)combat, tableIndex, delta, before, after, timer, kind, staggerType });
+}
+
+void CombatLogThread() {
+	Util::SetThreadName(sFixName + " Combat Log");
+
+	std::ofstream file(sThisModulePath / sCombatLogFile, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		spdlog::error("Combat Log: Could not open {}.", sThisModulePath.string() + sCombatLogFile);
+		return;
+	}
+	spdlog::info("Combat Log: Recording to {}.", sThisModulePath.string() + sCombatLogFile);
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+
+	CombatLog::Encoder encoder;
+	std::vector<uint8_t> buffer;
+	encoder.Header(buffer, (u64)frequency.QuadPart);
+
+	u64 iLastDropped = 0;
+	while (true) {
+		CombatEvents.Drain([&](const CombatLog::Event& event) { encoder.Encode(buffer, event); });
+		if (!buffer.empty()) {
+			file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+			file.flush();
+			buffer.clear();
+		}
+
+		if (u64 iDropped = CombatEvents.Dropped(); iDropped != iLastDropped) {
+			spdlog::warn("Combat Log: {} events dropped so far.", iDropped);
+			iLastDropped = iDropped;
+		}
+		Sleep(50);
+	}
+}
+
+// Rule for the entity's class, nullptr if there are no rules or the entity isn't in the snapshot
+const DamageScaling::Scales* FindDamageScaling(const CombatDetail* combat) {
+	Entities::Record entity;
+	if (DamageScalingRules.Empty() || !EntitySnapshot.Find(combat, entity))
+		return nullptr;
+	return DamageScalingRules.Find(entity.TableIndex);
+}
 
 unsigned char GameplayTweak_NormalDamageHook(CombatDetail* thisx, int healthDelta) {
-	if (thisx->Will == 20 && thisx->WillBarHalf == 0 && thisx->WillBarHalf1 == 0) {
-		healthDelta *= fCliveDamageScale;
+	if (!bAdjustDamageOutput) {
+		// Hooked for the combat log or state profiles only
+	}
+	else if (const auto* scales = FindDamageScaling(thisx)) {
+		healthDelta = DamageScaling::Apply(healthDelta, scales->Health);
+	}
+	else if (thisx->Will == 20 && thisx->WillBarHalf == 0 && thisx->WillBarHalf1 == 0) {
+		healthDelta = DamageScaling::Apply(healthDelta, iCliveDamageScale);
 	}
 	else {
-		healthDelta *= fHealthDamageScale;
+		healthDelta = DamageScaling::Apply(healthDelta, iHealthDamageScale);
 	}
 
-	return sNormalDamageInlineHook.call<unsigned char>(thisx, healthDelta);
+	if (bStateProfiles)
+		ullCombatLastSeen.store(GetTickCount64(), std::memory_order_relaxed);
+
+	u32 before = thisx->Health;
+	unsigned char result = sNormalDamageInlineHook.call<unsigned char>(thisx, healthDelta);
+	if (bCombatLog)
+		RecordCombatEvent(CombatLog::Kind::Health, thisx, healthDelta, before, thisx->Health);
+	return result;
 }
 
 int GameplayTweak_WillDamageHook(CombatDetail* thisx, int willDelta, unsigned char arg3, unsigned char arg4) {
-	willDelta *= fWillDamageScale;
-	return sWillDamageInlineHook.call<int>(thisx, willDelta, arg3, arg4);
+	if (bAdjustDamageOutput) {
+		const auto* scales = FindDamageScaling(thisx);
+		willDelta = DamageScaling::Apply(willDelta, scales ? scales->Will : iWillDamageScale);
+	}
+
+	if (bStateProfiles)
+		ullCombatLastSeen.store(GetTickCount64(), std::memory_order_relaxed);
+
+	u32 before = thisx->Will;
+	int result = sWillDamageInlineHook.call<int>(thisx, willDelta, arg3, arg4);
+	if (bCombatLog)
+		RecordCombatEvent(CombatLog::Kind::Will, thisx, willDelta, before, thisx->Will);
+	return result;
 }
 
 void GameplayTweaks()
 {
-	if (bAdjustStaggerTimers) {
+	if (bAdjustStaggerTimers || bCombatLog) {
 		// 
 		// type 2
 		uint8_t* FullStaggerScanResult = Memory::PatternScan(baseModule, "c5 fa 11 43 ?? c5 fa 11 43 ?? c7 43 ?? 01 00 00 00");
 		if (FullStaggerScanResult) {
 			spdlog::info("Stagger Type 2: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)FullStaggerScanResult - (uintptr_t)baseModule);
 			static SafetyHookMid FullStaggerMidHook{};
-			FullStaggerMidHook = safetyhook::create_mid(FullStaggerScanResult,
+			Memory::CreateMid(FullStaggerMidHook, FullStaggerScanResult,
 				[](SafetyHookContext& ctx) {
-					ctx.xmm0.f32[0] *= fStaggerTimerMultiplierType2;
+					if (bAdjustStaggerTimers)
+						ctx.xmm0.f32[0] *= fStaggerTimerMultiplierType2;
+					if (bCombatLog) {
+						auto combat = reinterpret_cast<CombatDetail*>(ctx.rbx);
+						// The hooked code goes on to store an immediate 1 (c7 43 ?? 01 00 00 00)
+						RecordCombatEvent(CombatLog::Kind::Stagger, combat, 0, combat->StaggerType, 1, 2, ctx.xmm0.f32[0]);
+					}
 				});
 		}
 		else if (!FullStaggerScanResult) {
@@ -1407,9 +2426,15 @@ void GameplayTweaks()
 		if (FullStaggerScanResult2) {
 			spdlog::info("Stagger Type 3: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)FullStaggerScanResult2 - (uintptr_t)baseModule);
 			static SafetyHookMid FullStaggerMidHook2{};
-			FullStaggerMidHook2 = safetyhook::create_mid(FullStaggerScanResult2,
+			Memory::CreateMid(FullStaggerMidHook2, FullStaggerScanResult2,
 				[](SafetyHookContext& ctx) {
-					ctx.xmm6.f32[0] *= fStaggerTimerMultiplierType3;
+					if (bAdjustStaggerTimers)
+						ctx.xmm6.f32[0] *= fStaggerTimerMultiplierType3;
+					if (bCombatLog) {
+						auto combat = reinterpret_cast<CombatDetail*>(ctx.rbx);
+						// The hooked code goes on to store al (88 43 ??)
+						RecordCombatEvent(CombatLog::Kind::Stagger, combat, 0, combat->StaggerType, (u8)ctx.rax, 3, ctx.xmm6.f32[0]);
+					}
 				});
 			spdlog::info("Stagger Type 3: OK");
 		}
@@ -1425,11 +2450,14 @@ void GameplayTweaks()
 
 			// effectively creating a code cave here
 			Memory::PatchBytes((uintptr_t)PartialStaggerScanResult, "\x90\x90\x90\x90\x90\x90\x90", 7);
-			PartialStaggerMidHook = safetyhook::create_mid(PartialStaggerScanResult,
+			Memory::CreateMid(PartialStaggerMidHook, PartialStaggerScanResult,
 				[](SafetyHookContext& ctx) {
 					if (ctx.r9 != 0) {
 						float original = *reinterpret_cast<float*>(ctx.r9 + 0x7C);
-						reinterpret_cast<CombatDetail*>(ctx.rbx)->StaggerTimer = original * fStaggerTimerMultiplierType1;
+						auto combat = reinterpret_cast<CombatDetail*>(ctx.rbx);
+						combat->StaggerTimer = bAdjustStaggerTimers ? original * fStaggerTimerMultiplierType1 : original;
+						if (bCombatLog)
+							RecordCombatEvent(CombatLog::Kind::Stagger, combat, 0, combat->StaggerType, combat->StaggerType, 1, combat->StaggerTimer);
 					}
 				});
 		}
@@ -1438,12 +2466,27 @@ void GameplayTweaks()
 		}
 	}
 
-	if (bAdjustDamageOutput) {
+	if (bAdjustDamageOutput || bCombatLog || bSharedState) {
+		// Entity snapshot for the damage hooks, the combat log and the shared state
+		uint8_t* ObjectTableIteratorScanResult = Memory::PatternScan(baseModule, "48 89 5c 24 ?? 57 48 83 ec ?? 48 8b 3a 48 8b da b8 ?? 00 00 00 f0 48 0f c1 43 ?? 48 3b 43 ?? 73 ?? 48 8b ?? ?? 48 8b ?? ?? e8 ?? ?? ?? ?? eb ?? 48 8b ?? ?? ?? 48 83 c4 ?? 5f c3 cc 48 8b 0a e9 ?? ?? ?? ?? 48 89 5c 24 ?? 48 89 74 24 ?? 57 48 83 ec ?? 48");
+		if (ObjectTableIteratorScanResult) {
+			spdlog::info("Object Table Iterator: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)ObjectTableIteratorScanResult - (uintptr_t)baseModule);
+			bEntitySnapshot = true;
+			Memory::CreateInline(sObjectTableIteratorInlineHook, reinterpret_cast<void*>(ObjectTableIteratorScanResult), GameplayTweak_ObjectTableIteratorHook);
+			spdlog::info("Object Table Iterator: Hook queued.");
+		}
+		else if (!ObjectTableIteratorScanResult) {
+			spdlog::error("Object Table Iterator: Pattern scan failed.");
+		}
+	}
+
+	if (bAdjustDamageOutput || bCombatLog || bStateProfiles) {
+
 		uint8_t* NormalDamageScanResult = Memory::PatternScan(baseModule, "48 89 5c 24 08 48 89 74 24 10 48 89 7c 24 18 41 56 48 83 ec ?? 8b fa");
 		if (NormalDamageScanResult) {
 			spdlog::info("Normal Damage: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)NormalDamageScanResult - (uintptr_t)baseModule);
-			sNormalDamageInlineHook = safetyhook::create_inline(reinterpret_cast<void*>(NormalDamageScanResult), GameplayTweak_NormalDamageHook);
-			spdlog::info("Normal Damage: Hooked.");
+			Memory::CreateInline(sNormalDamageInlineHook, reinterpret_cast<void*>(NormalDamageScanResult), GameplayTweak_NormalDamageHook);
+			spdlog::info("Normal Damage: Hook queued.");
 		}
 		else if (!NormalDamageScanResult) {
 			spdlog::error("Normal Damage: Pattern scan failed.");
@@ -1452,28 +2495,215 @@ void GameplayTweaks()
 		uint8_t* WillDamageScanResult = Memory::PatternScan(baseModule, "48 89 5c 24 08 56 48 83 ec ?? 41 8a f1 48 8b d9 85 d2");
 		if (WillDamageScanResult) {
 			spdlog::info("Will Damage: Address is {:s}+{:x}", sExeName.c_str(), (uintptr_t)WillDamageScanResult - (uintptr_t)baseModule);
-			sWillDamageInlineHook = safetyhook::create_inline(reinterpret_cast<void*>(WillDamageScanResult), GameplayTweak_WillDamageHook);
-			spdlog::info("Will Damage: Hooked.");
+			Memory::CreateInline(sWillDamageInlineHook, reinterpret_cast<void*>(WillDamageScanResult), GameplayTweak_WillDamageHook);
+			spdlog::info("Will Damage: Hook queued.");
 		}
 		else if (!WillDamageScanResult) {
 			spdlog::error("Will Damage: Pattern scan failed.");
 		}
 	}
+
+	if (bCombatLog) {
+		std::thread(CombatLogThread).detach();
+	}
+}
+
+
+// Named so readers can find it: OpenFileMapping(FILE_MAP_READ, FALSE, L"Local\\FFXVIFix_SharedState"), see SharedState.hpp
+void SharedMemory()
+{
+    std::wstring sMappingName = L"Local\\" + std::wstring(sFixName.begin(), sFixName.end()) + L"_SharedState";
+    HANDLE hMapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SharedState::Region), sMappingName.c_str());
+    if (!hMapping) {
+        spdlog::error("Shared State: Failed to create file mapping ({}).", GetLastError());
+        return;
+    }
+
+    // Stays mapped for the lifetime of the process
+    void* pView = MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, sizeof(SharedState::Region));
+    if (!pView) {
+        spdlog::error("Shared State: Failed to map view ({}).", GetLastError());
+        CloseHandle(hMapping);
+        return;
+    }
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    SharedStateWriter.Open(pView, frequency.QuadPart);
+    CalculateAspectRatio(false);
+    spdlog::info("Shared State: Publishing {} bytes as {}.", sizeof(SharedState::Region), std::string(sMappingName.begin(), sMappingName.end()));
+}
+
+void HookTraceThread()
+{
+    Util::SetThreadName(sFixName + " Hook Trace");
+
+    std::ofstream file(sThisModulePath / sHookTraceFile, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        spdlog::error("Hook Trace: Could not open {}.", sThisModulePath.string() + sHookTraceFile);
+        return;
+    }
+
+    HookRecorder.Start((size_t)iHookTraceMaxCalls, HookParams);
+    spdlog::info("Hook Trace: Recording up to {} calls per hook to {}.", iHookTraceMaxCalls, sThisModulePath.string() + sHookTraceFile);
+
+    while (true) {
+        HookRecorder.Drain([&](const uint8_t* data, size_t size) {
+            file.write(reinterpret_cast<const char*>(data), size);
+            file.flush();
+            });
+        Sleep(250);
+    }
+}
+
+void LogStartupTimes(const Pipeline::Graph& startup, double dSetupMs)
+{
+    constexpr auto Scan = (size_t)Pipeline::Phase::Scan;
+    constexpr auto Install = (size_t)Pipeline::Phase::Install;
+    constexpr auto Wait = (size_t)Pipeline::Phase::Wait;
+
+    double dTotalMs[(size_t)Pipeline::Phase::Count] = {};
+
+    spdlog::info("----------");
+    spdlog::info("Startup: Logging + Configuration: {:.2f}ms", dSetupMs);
+    for (const auto& task : startup.Tasks()) {
+        const auto& times = task.times;
+        spdlog::info("Startup: {}: {:.2f}ms -> {:.2f}ms (scan = {:.2f}ms, install = {:.2f}ms, wait = {:.2f}ms)",
+            task.sName, times.dStartMs, times.dEndMs, times.dPhaseMs[Scan], times.dPhaseMs[Install], times.dPhaseMs[Wait]);
+
+        for (size_t i = 0; i < (size_t)Pipeline::Phase::Count; i++)
+            dTotalMs[i] += times.dPhaseMs[i];
+    }
+    spdlog::info("Startup: Total: {:.2f}ms (scan = {:.2f}ms, install = {:.2f}ms, wait = {:.2f}ms)",
+        dSetupMs + startup.WallMs(), dTotalMs[Scan], dTotalMs[Install], dTotalMs[Wait]);
+    spdlog::info("----------");
+}
+
+// Startup allocations, see InitArena.hpp
+constexpr size_t kInitArenaSize = 1024 * 1024;
+InitArena::AllocationCounter InitAllocations;
+std::optional<InitArena::Arena> StartupArena;
+void* pStartupArenaBlock = nullptr;
+
+// Only replaces operator new for this module, the game's allocations aren't counted
+void* operator new(size_t size)
+{
+    InitAllocations.Add(size);
+    if (void* p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
 }
 
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+void CreateStartupArena()
+{
+    InitAllocations.bCounting = true;
+    pStartupArenaBlock = VirtualAlloc(nullptr, kInitArenaSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!pStartupArenaBlock)
+        return;
+    StartupArena.emplace(pStartupArenaBlock, kInitArenaSize);
+    InitArena::pResource = &*StartupArena;
+}
+
+// Every startup task has finished, nothing allocated from the arena is alive any more
+void ReleaseStartupArena()
+{
+    InitAllocations.bCounting = false;
+    InitArena::pResource = nullptr;
+    Memory::ReleaseCodeHistograms();
+
+    spdlog::info("Startup: {} heap allocations ({:.1f} KB).", InitAllocations.iCount.load(), InitAllocations.iBytes.load() / 1024.0);
+    if (StartupArena) {
+        spdlog::info("Startup: Arena: {:.1f} of {} KB used, {} allocations didn't fit.", StartupArena->Used() / 1024.0, StartupArena->Capacity() / 1024,
+            StartupArena->Overflows());
+        StartupArena.reset();
+        VirtualFree(pStartupArenaBlock, 0, MEM_RELEASE);
+        pStartupArenaBlock = nullptr;
+    }
+}
 
 DWORD __stdcall Main(void*)
 {
+    auto tStart = std::chrono::steady_clock::now();
+    CreateStartupArena();
     Logging();
     Configuration();
-    Resolution();
-    HUD();
-    Camera();
-    Framerate();
-    Misc();
-	GameplayTweaks();
-    JXL();
-    WindowFocus();
+    if (bTrace) {
+        Trace::Enable(Trace::ParseCategories(sTraceCategories), tStart, [] { return (uint32_t)GetCurrentThreadId(); },
+            [](uint32_t iThreadId) {
+                std::string sName;
+                if (HANDLE hThread = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, iThreadId)) {
+                    sName = Util::GetThreadName(hThread);
+                    CloseHandle(hThread);
+                }
+                return sName;
+            });
+        Trace::RegisterThread();
+        if (Trace::IsEnabled(Trace::Startup)) {
+            Trace::Record({ "Logging + Configuration", Trace::Startup, 0, Trace::Now(), 0 });
+        }
+    }
+    if (bSharedState) {
+        SharedMemory();
+    }
+    if (bDiagnostics) {
+        BinLog::Enable();
+    }
+    if (bHookTrace) {
+        std::thread(HookTraceThread).detach();
+    }
+    ThreadScheduling();
+    double dSetupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+    // Scans run in parallel, their hooks/patches are queued and applied by the Commit task
+    Pipeline::Graph startup;
+    startup.SetThreadInit([](const Pipeline::Graph::Task& task) {
+        Util::SetThreadName(sFixName + " Startup");
+        Trace::RegisterThread();
+        if (task.eKind == Pipeline::Graph::Kind::Scan)
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+        });
+    startup.Add("Resolution", Resolution);
+    startup.Add("HUD", HUD);
+    startup.Add("Camera", Camera);
+    startup.Add("Framerate", Framerate);
+    startup.Add("Misc", Misc);
+    startup.Add("GameplayTweaks", GameplayTweaks);
+    startup.Add("Commit", [] {
+        // Started first, hooks applied below can fire and ask for an update straight away
+        StartConditionalHooksThread();
+        CheckEntitySnapshot();
+        size_t iCount = Pipeline::Installer::Get().Commit();
+        spdlog::info("Startup: Applied {} hooks/patches.", iCount);
+        RequestConditionalHooksUpdate();
+        }, { "Resolution", "HUD", "Camera", "Framerate", "Misc", "GameplayTweaks" }, Pipeline::Graph::Kind::Other);
+    startup.Add("WindowFocus", WindowFocus, {}, Pipeline::Graph::Kind::Other);
+
+    // Waits for the game to load its JXL libraries, which may never happen, so it isn't part of the graph Main() waits on.
+    // Hooks it creates before the Commit task are queued like any other.
+    std::thread([] {
+        Util::SetThreadName(sFixName + " JXL");
+        JXL();
+        }).detach();
+    {
+        Trace::Zone zone(Trace::Startup, "Startup");
+        if (!startup.Run()) {
+            spdlog::error("Startup: {}, nothing was applied.", startup.Error());
+            return false;
+        }
+    }
+
+    LogStartupTimes(startup, dSetupMs);
+    ReleaseStartupArena();
+    if (bTrace) {
+        ExportTrace();
+    }
+
+    if (bHookBenchmark) {
+        HookBenchmark();
+    }
     return true;
 }
 
@@ -1497,7 +2727,15 @@ BOOL APIENTRY DllMain(HMODULE hModule,
         break;
     }
     case DLL_THREAD_ATTACH:
+        // Loader lock is held, only queue the thread. Start address rules are applied as soon as the policy thread
+        // wakes, name rules wait for the next sweep.
+        if (bThreadPolicyActive)
+            QueueThreadEvent(GetCurrentThreadId(), ThreadEventKind::Started);
+        break;
     case DLL_THREAD_DETACH:
+        if (bThreadPolicyActive)
+            QueueThreadEvent(GetCurrentThreadId(), ThreadEventKind::Exited);
+        break;
     case DLL_PROCESS_DETACH:
         break;
     }
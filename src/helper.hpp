@@ -1,68 +1,477 @@
 #include "stdafx.h"
+#include "Pattern.hpp"
+#include "FuzzyScan.hpp"
+#include "InitArena.hpp"
+#include "PatchCompiler.hpp"
+#include "PEImage.hpp"
+#include "Pipeline.hpp"
+#include "SigPack.hpp"
+#include "ThreadPolicy.hpp"
 
+#include <tlhelp32.h>
+#include <safetyhook.hpp>
+#include <Zydis.h>
+#include <spdlog/spdlog.h>
+
+// Hooks and patches are queued (see Pipeline::Installer), call sites can only log that they were submitted.
+// Whether they could be applied is logged from here once the Commit task gets to them.
 namespace Memory
 {
     template<typename T>
     void Write(uintptr_t writeAddress, T value)
     {
-        DWORD oldProtect;
-        VirtualProtect((LPVOID)(writeAddress), sizeof(T), PAGE_EXECUTE_WRITECOPY, &oldProtect);
-        *(reinterpret_cast<T*>(writeAddress)) = value;
-        VirtualProtect((LPVOID)(writeAddress), sizeof(T), oldProtect, &oldProtect);
+        Pipeline::Installer::Get().Submit([=] {
+            DWORD oldProtect;
+            if (!VirtualProtect((LPVOID)(writeAddress), sizeof(T), PAGE_EXECUTE_WRITECOPY, &oldProtect)) {
+                spdlog::error("Install: Failed to write {} bytes at {:#x}, VirtualProtect error {}.", sizeof(T), writeAddress, GetLastError());
+                return;
+            }
+            *(reinterpret_cast<T*>(writeAddress)) = value;
+            VirtualProtect((LPVOID)(writeAddress), sizeof(T), oldProtect, &oldProtect);
+            });
     }
 
     void PatchBytes(uintptr_t address, const char* pattern, unsigned int numBytes)
     {
-        DWORD oldProtect;
-        VirtualProtect((LPVOID)address, numBytes, PAGE_EXECUTE_READWRITE, &oldProtect);
-        memcpy((LPVOID)address, pattern, numBytes);
-        VirtualProtect((LPVOID)address, numBytes, oldProtect, &oldProtect);
+        // Patterns are always string literals, so they outlive the queue
+        Pipeline::Installer::Get().Submit([=] {
+            Trace::Zone zone(Trace::Install, "PatchBytes", address);
+            DWORD oldProtect;
+            if (!VirtualProtect((LPVOID)address, numBytes, PAGE_EXECUTE_READWRITE, &oldProtect)) {
+                spdlog::error("Install: Failed to patch {} bytes at {:#x}, VirtualProtect error {}.", numBytes, address, GetLastError());
+                return;
+            }
+            memcpy((LPVOID)address, pattern, numBytes);
+            VirtualProtect((LPVOID)address, numBytes, oldProtect, &oldProtect);
+            });
     }
 
-    // CSGOSimple's pattern scan
-    // https://github.com/OneshotGH/CSGOSimple-master/blob/master/CSGOSimple/helpers/utils.cpp
-    std::uint8_t* PatternScan(void* module, const char* signature)
-    {
-        static auto pattern_to_byte = [](const char* pattern) {
-            auto bytes = std::vector<int>{};
-            auto start = const_cast<char*>(pattern);
-            auto end = const_cast<char*>(pattern) + strlen(pattern);
-
-            for (auto current = start; current < end; ++current) {
-                if (*current == '?') {
-                    ++current;
-                    if (*current == '?')
-                        ++current;
-                    bytes.push_back(-1);
+    template<typename T>
+    void CreateMid(SafetyHookMid& hook, T target, safetyhook::MidHookFn destination)
+    {
+        Pipeline::Installer::Get().Submit([&hook, target, destination] {
+            Trace::Zone zone(Trace::Install, "create_mid", (uintptr_t)target);
+            hook = safetyhook::create_mid((void*)target, destination);
+            if (!hook)
+                spdlog::error("Install: Failed to create mid hook at {:#x}.", (uintptr_t)target);
+            });
+    }
+
+    template<typename T, typename D>
+    void CreateInline(SafetyHookInline& hook, T target, D destination)
+    {
+        Pipeline::Installer::Get().Submit([&hook, target, destination] {
+            Trace::Zone zone(Trace::Install, "create_inline", (uintptr_t)target);
+            hook = safetyhook::create_inline((void*)target, (void*)destination);
+            if (!hook)
+                spdlog::error("Install: Failed to create inline hook at {:#x}.", (uintptr_t)target);
+            });
+    }
+
+    // Headers of a loaded module, they always fit in its first page
+    bool ModuleImage(void* module, PE::Image& image)
+    {
+        return PE::Parse(reinterpret_cast<const std::uint8_t*>(module), 0x1000, image);
+    }
+
+    // Writes over code that other threads may be running. Every other thread in the process is suspended for the
+    // write, and nothing is written if one of them stopped part way into the range (on its first byte is fine, the
+    // old and new bytes both start an instruction there).
+    bool WriteCodeWhileFrozen(std::uint8_t* address, const std::uint8_t* bytes, size_t size)
+    {
+        // Collect the threads first, nothing can allocate once they're suspended
+        std::vector<HANDLE> threads;
+        HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+        if (hSnapshot == INVALID_HANDLE_VALUE)
+            return false;
+
+        THREADENTRY32 te32{ .dwSize = sizeof(THREADENTRY32) };
+        if (Thread32First(hSnapshot, &te32)) {
+            do {
+                if (te32.th32OwnerProcessID == GetCurrentProcessId() && te32.th32ThreadID != GetCurrentThreadId()) {
+                    if (HANDLE hThread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT, FALSE, te32.th32ThreadID))
+                        threads.push_back(hThread);
                 }
-                else {
-                    bytes.push_back(strtoul(current, &current, 16));
+            } while (Thread32Next(hSnapshot, &te32));
+        }
+        CloseHandle(hSnapshot);
+
+        for (HANDLE hThread : threads)
+            SuspendThread(hThread);
+
+        bool bSafe = true;
+        for (HANDLE hThread : threads) {
+            CONTEXT context{ .ContextFlags = CONTEXT_CONTROL };
+            if (GetThreadContext(hThread, &context) && context.Rip > (DWORD64)address && context.Rip < (DWORD64)address + size)
+                bSafe = false;
+        }
+
+        if (bSafe) {
+            DWORD oldProtect;
+            VirtualProtect(address, size, PAGE_EXECUTE_READWRITE, &oldProtect);
+            memcpy(address, bytes, size);
+            VirtualProtect(address, size, oldProtect, &oldProtect);
+            FlushInstructionCache(GetCurrentProcess(), address, size);
+        }
+
+        for (HANDLE hThread : threads) {
+            ResumeThread(hThread);
+            CloseHandle(hThread);
+        }
+        return bSafe;
+    }
+
+    // Mid hooks that only do anything under some condition (usually the aspect ratio).
+    // Disarming writes the original bytes back over the jump, the stub and trampoline stay allocated so arming again
+    // is just another write. UpdateConditionalHooks() re-evaluates every condition.
+    struct ConditionalHook
+    {
+        const char* sName;
+        std::uint8_t* pTarget;
+        bool (*fnCondition)();
+        std::vector<std::uint8_t> vOriginalBytes;
+        std::vector<std::uint8_t> vHookedBytes;
+        bool bArmed;
+        bool bBusyLogged; // Since the last successful switch
+    };
+
+    std::mutex ConditionalHooksMutex;
+    std::vector<ConditionalHook> ConditionalHooks;
+
+    template<typename T>
+    void CreateConditionalMid(const char* sName, SafetyHookMid& hook, T target, bool (*condition)(), safetyhook::MidHookFn destination)
+    {
+        Pipeline::Installer::Get().Submit([sName, &hook, target, condition, destination] {
+            Trace::Zone zone(Trace::Install, sName, (uintptr_t)target);
+            hook = safetyhook::create_mid((void*)target, destination);
+            if (!hook) {
+                spdlog::error("Install: {}: Failed to create mid hook at {:#x}.", sName, (uintptr_t)target);
+                return;
+            }
+
+            std::uint8_t* address = hook.target();
+            std::scoped_lock lock(ConditionalHooksMutex);
+            ConditionalHooks.push_back({ sName, address, condition, hook.original_bytes(), { address, address + hook.original_bytes().size() }, true, false });
+            });
+    }
+
+    // Returns false if a hook couldn't be switched yet. Suspends every other thread for each switch, so it's called from a
+    // thread of the fix's own (see ConditionalHooksThread in dllmain.cpp), never from a hook in the middle of a frame.
+    bool UpdateConditionalHooks()
+    {
+        bool bSettled = true;
+        std::scoped_lock lock(ConditionalHooksMutex);
+        for (auto& entry : ConditionalHooks) {
+            bool bWanted = entry.fnCondition();
+            if (bWanted == entry.bArmed)
+                continue;
+
+            const auto& bytes = bWanted ? entry.vHookedBytes : entry.vOriginalBytes;
+            if (!WriteCodeWhileFrozen(entry.pTarget, bytes.data(), bytes.size())) {
+                // A thread was inside the patched bytes, leave it for the next update
+                if (!entry.bBusyLogged) {
+                    spdlog::warn("Conditional Hooks: {}: Busy, will retry.", entry.sName);
+                    entry.bBusyLogged = true;
                 }
+                bSettled = false;
+                continue;
+            }
+
+            entry.bArmed = bWanted;
+            entry.bBusyLogged = false;
+            spdlog::info("Conditional Hooks: {}: {}.", entry.sName, bWanted ? "Armed" : "Disarmed");
+        }
+        return bSettled;
+    }
+
+    bool DecodeInstruction(const std::uint8_t* address, ZydisDecodedInstruction& instruction, ZydisDecodedOperand* operands)
+    {
+        static const ZydisDecoder decoder = [] {
+            ZydisDecoder decoder;
+            ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+            return decoder;
+        }();
+        return ZYAN_SUCCESS(ZydisDecoderDecodeFull(&decoder, address, ZYDIS_MAX_INSTRUCTION_LENGTH, &instruction, operands));
+    }
+
+    size_t InstructionLength(const std::uint8_t* address, size_t size)
+    {
+        ZydisDecodedInstruction instruction;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        return size >= ZYDIS_MAX_INSTRUCTION_LENGTH && DecodeInstruction(address, instruction, operands) ? instruction.length : 0;
+    }
+
+    Patch::Instruction DescribeInstruction(const ZydisDecodedInstruction& instruction, const ZydisDecodedOperand* operands)
+    {
+        Patch::Instruction description;
+        description.iLength = instruction.length;
+        for (ZyanU8 i = 0; i < instruction.operand_count; i++) {
+            if (operands[i].type == ZYDIS_OPERAND_TYPE_MEMORY && operands[i].mem.base == ZYDIS_REGISTER_RIP) {
+                description.bRipRelative = true;
+                description.iDispOffset = instruction.raw.disp.offset;
             }
-            return bytes;
+        }
+        description.bRelativeBranch = instruction.raw.imm[0].is_relative || instruction.raw.imm[1].is_relative;
+        return description;
+    }
+
+    // Constant patches, see PatchCompiler.hpp. Slots live next to their detour code within rel32 range of the game.
+    struct ConstantPatch
+    {
+        const char* sName;
+        float* pSlot;
+        float (*fnValue)();
+        safetyhook::Allocation allocation;
+    };
+
+    std::mutex ConstantPatchesMutex;
+    std::vector<std::unique_ptr<ConstantPatch>> ConstantPatches;
+
+    // Applies `op` on xmm<iXmm> with the value from fnValue() at target, without a hook where the code there allows it.
+    // `fallback` is called instead (to create the equivalent mid hook) when it doesn't. Patches with a condition are
+    // armed and disarmed by UpdateConditionalHooks() like conditional mid hooks, and every slot is refreshed by
+    // UpdateConstantPatches().
+    void CreateConstantPatch(const char* sName, std::uint8_t* target, Patch::Op op, int iXmm, float (*value)(), bool (*condition)(), std::function<void()> fallback)
+    {
+        Pipeline::Installer::Get().Submit([=] {
+            Trace::Zone zone(Trace::Install, sName, (uintptr_t)target);
+            auto Fail = [&](const char* sReason) {
+                spdlog::warn("Constant Patch: {}: {}, using a mid hook instead.", sName, sReason);
+                fallback();
             };
 
-        auto dosHeader = (PIMAGE_DOS_HEADER)module;
-        auto ntHeaders = (PIMAGE_NT_HEADERS)((std::uint8_t*)module + dosHeader->e_lfanew);
+            // Take whole instructions until there's room for a jump
+            std::vector<Patch::Instruction> stolen;
+            size_t iStolen = 0;
+            ZydisDecodedInstruction instruction;
+            ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+            while (iStolen < (op == Patch::Op::Load ? 1 : Patch::kJmpSize)) {
+                if (!DecodeInstruction(target + iStolen, instruction, operands))
+                    return Fail("Failed to decode instruction");
+                if (op == Patch::Op::Load && (instruction.mnemonic != ZYDIS_MNEMONIC_VMOVSS || instruction.operand_count_visible != 2 ||
+                    operands[0].type != ZYDIS_OPERAND_TYPE_REGISTER || operands[0].reg.value != ZYDIS_REGISTER_XMM0 + iXmm ||
+                    operands[1].type != ZYDIS_OPERAND_TYPE_MEMORY))
+                    return Fail("Instruction is not a vmovss load into the expected register");
+                stolen.push_back(DescribeInstruction(instruction, operands));
+                iStolen += instruction.length;
+            }
+
+            auto allocation = safetyhook::Allocator::global()->allocate_near({ target }, 64);
+            if (!allocation)
+                return Fail("No memory near target");
+
+            // Slot first, code after it
+            auto entry = std::make_unique<ConstantPatch>(ConstantPatch{ sName, reinterpret_cast<float*>(allocation->data()), value });
+            *entry->pSlot = value();
+            std::uint8_t* code = allocation->data() + 16;
+
+            std::vector<std::uint8_t> detour, patch;
+            bool bCompiled = op == Patch::Op::Load ?
+                Patch::CompileLoad((uint64_t)target, stolen.front(), iXmm, (uint64_t)entry->pSlot, patch) :
+                Patch::CompileDetour(op, iXmm, (uint64_t)entry->pSlot, target, (uint64_t)target, stolen, (uint64_t)code, detour, patch);
+            if (!bCompiled)
+                return Fail("Instructions can't be moved");
+
+            memcpy(code, detour.data(), detour.size());
+            FlushInstructionCache(GetCurrentProcess(), code, detour.size());
+
+            std::vector<std::uint8_t> original(target, target + patch.size());
+            bool bArm = !condition || condition();
+            if (bArm && !WriteCodeWhileFrozen(target, patch.data(), patch.size()))
+                return Fail("Target is busy");
+
+            entry->allocation = std::move(*allocation);
+            {
+                std::scoped_lock lock(ConstantPatchesMutex);
+                ConstantPatches.push_back(std::move(entry));
+            }
+            if (condition) {
+                std::scoped_lock lock(ConditionalHooksMutex);
+                ConditionalHooks.push_back({ sName, target, condition, original, patch, bArm, false });
+            }
+            spdlog::info("Constant Patch: {}: {} {} bytes{}.", sName, op == Patch::Op::Load ? "Rewrote" : "Detoured", patch.size(), bArm ? "" : " (disarmed)");
+            });
+    }
+
+    // Writes the current value of every constant patch to its slot
+    void UpdateConstantPatches()
+    {
+        std::scoped_lock lock(ConstantPatchesMutex);
+        for (const auto& entry : ConstantPatches)
+            std::atomic_ref<float>(*entry->pSlot).store(entry->fnValue(), std::memory_order_relaxed);
+    }
+
+    uint32_t ModuleTimestamp(void* module)
+    {
+        PE::Image image;
+        return ModuleImage(module, image) ? image.iTimestamp : 0;
+    }
+
+    // Signature pack, see SigPack.hpp. Stays mapped for the lifetime of the process.
+    SigPack::View SignaturePack;
+
+    bool LoadSignaturePack(const std::filesystem::path& path)
+    {
+        HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile == INVALID_HANDLE_VALUE)
+            return false;
 
-        auto sizeOfImage = ntHeaders->OptionalHeader.SizeOfImage;
-        auto patternBytes = pattern_to_byte(signature);
+        LARGE_INTEGER fileSize{};
+        HANDLE hMapping = NULL;
+        if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0)
+            hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(hFile);
+
+        if (!hMapping)
+            return false;
+
+        auto view = (const std::uint8_t*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(hMapping);
+
+        if (!view || !SignaturePack.Open(view, (size_t)fileSize.QuadPart)) {
+            if (view)
+                UnmapViewOfFile(view);
+            return false;
+        }
+        return true;
+    }
+
+    std::mutex CodeHistogramMutex;
+    std::map<void*, std::unique_ptr<Pattern::ByteHistogram>> CodeHistograms;
+
+    // Byte histogram of a module's code sections, built by the first scan in that module
+    const Pattern::ByteHistogram& CodeHistogram(void* module, const PE::Image& image)
+    {
+        std::scoped_lock lock(CodeHistogramMutex);
+        auto& histogram = CodeHistograms[module];
+        if (!histogram) {
+            histogram = std::make_unique<Pattern::ByteHistogram>(InitArena::Resource());
+            for (const auto& section : image.vSections) {
+                if (section.IsCode() && (std::uint64_t)section.iVirtualAddress + section.iVirtualSize <= image.iSizeOfImage)
+                    histogram->Add(reinterpret_cast<const std::uint8_t*>(module) + section.iVirtualAddress, section.iVirtualSize);
+            }
+        }
+        return *histogram;
+    }
+
+    // Once no more scans are coming, they would have to build the histograms again
+    void ReleaseCodeHistograms()
+    {
+        std::scoped_lock lock(CodeHistogramMutex);
+        CodeHistograms.clear();
+    }
+
+    using ScanStrategy = Pattern::Strategy;
+
+    // Based on CSGOSimple's pattern scan, parsing and matching are in Pattern.hpp
+    // https://github.com/OneshotGH/CSGOSimple-master/blob/master/CSGOSimple/helpers/utils.cpp
+    // Approximate search for signatures that weren't found, see FuzzyScan.hpp. Only logs, set from the ini.
+    struct FuzzyRecoverySettings
+    {
+        bool bEnabled = false;
+        size_t iMaxMismatches = 0;
+        double dBudgetMs = 2000.0;
+    };
+    FuzzyRecoverySettings FuzzyRecovery;
+
+    void RecoverSignature(std::uint8_t* scanBytes, const PE::Image& image, const Pattern::Signature& pattern, const char* signature, size_t iHookOffset)
+    {
+        Fuzzy::Search search(pattern, { FuzzyRecovery.iMaxMismatches, 8, FuzzyRecovery.dBudgetMs });
+        for (const auto& section : image.vSections) {
+            if (section.IsCode() && !search.Scan(scanBytes + section.iVirtualAddress, section.iVirtualSize, section.iVirtualAddress))
+                break;
+        }
+
+        size_t iWalk = std::max(pattern.Size(), iHookOffset + 1) + ZYDIS_MAX_INSTRUCTION_LENGTH;
+        auto candidates = search.Rank([&](size_t rva) {
+            return rva + iWalk <= image.iSizeOfImage && Fuzzy::LandsOnBoundary(scanBytes + rva, iWalk, iHookOffset, InstructionLength);
+            });
+
+        spdlog::warn("Signature Recovery: {} candidates with up to {} of {} bytes different ({:.0f}ms{}): {}", candidates.size(), search.MaxMismatches(),
+            search.Literals(), search.ElapsedMs(), search.TimedOut() ? ", out of time" : "", signature);
+        for (const auto& candidate : candidates) {
+            spdlog::warn("Signature Recovery:     +{:x}: {} bytes differ, hook offset +{:x} {} an instruction, confidence {:.2f}", candidate.iOffset,
+                candidate.iMismatches, iHookOffset, candidate.bBoundary ? "starts" : "does not start", candidate.dConfidence);
+        }
+    }
+
+    std::uint8_t* PatternScan(void* module, const char* signature, ScanStrategy strategy = ScanStrategy::Auto)
+    {
+        Pipeline::ScopedPhase phase(Pipeline::Phase::Scan);
+        Trace::Zone zone(Trace::Scan, Trace::IsEnabled(Trace::Scan) ? Trace::Intern(signature) : signature);
+
+        PE::Image image;
+        if (!ModuleImage(module, image))
+            return nullptr;
+
+        auto sizeOfImage = image.iSizeOfImage;
         auto scanBytes = reinterpret_cast<std::uint8_t*>(module);
 
-        auto s = patternBytes.size();
-        auto d = patternBytes.data();
+        // A pack hint for this build means there's nothing to scan for
+        std::uint64_t packKey = 0;
+        if (SignaturePack.IsOpen()) {
+            packKey = SigPack::Key(signature);
+            if (auto hint = SignaturePack.FindHint(image.iTimestamp, packKey)) {
+                const auto& entry = SignaturePack.Entries()[hint->entryIndex];
+                std::int64_t matchRva = (std::int64_t)hint->rva - entry.adjust;
+                if (matchRva >= 0 && matchRva + entry.length <= sizeOfImage && SignaturePack.Matches(entry, scanBytes + matchRva)) {
+                    return scanBytes + hint->rva;
+                }
+            }
+        }
+
+        auto pattern = Pattern::Parse(signature, InitArena::Resource());
+        auto horspool = Pattern::BuildHorspool(pattern);
+        if (strategy == ScanStrategy::Auto)
+            strategy = Pattern::ChooseStrategy(pattern, horspool);
+
+        const std::uint8_t* match = nullptr;
+        if (strategy == ScanStrategy::Horspool) {
+            spdlog::info("Pattern Scan: Horspool on {} byte run at +{:x}: {}", horspool.iRunLength, horspool.iRunOffset, signature);
+            match = Pattern::Find(scanBytes, sizeOfImage, pattern, horspool);
+        }
+        else if (strategy == ScanStrategy::Anchor) {
+            // Search for the rarest byte in the signature instead of its first one
+            auto anchor = Pattern::ChooseAnchor(pattern, CodeHistogram(module, image));
+            if (anchor.bValid) {
+                auto sAnchor = anchor.iPairOffset == SIZE_MAX ? fmt::format("{:02X}", anchor.iByte) :
+                    fmt::format("{:02X} {:02X}", pattern.bytes[std::min(anchor.iOffset, anchor.iPairOffset)], pattern.bytes[std::max(anchor.iOffset, anchor.iPairOffset)]);
+                spdlog::info("Pattern Scan: Anchor {} at +{:x}, ~{} candidates: {}", sAnchor, std::min(anchor.iOffset, anchor.iPairOffset), anchor.iCandidates, signature);
+            }
+            match = Pattern::Find(scanBytes, sizeOfImage, pattern, anchor);
+        }
+        else {
+            match = Pattern::Find(scanBytes, sizeOfImage, pattern);
+        }
 
-        for (auto i = 0ul; i < sizeOfImage - s; ++i) {
-            bool found = true;
-            for (auto j = 0ul; j < s; ++j) {
-                if (scanBytes[i + j] != d[j] && d[j] != -1) {
-                    found = false;
-                    break;
+        if (match) {
+            return const_cast<std::uint8_t*>(match);
+        }
+
+        // Alternates for other builds, already compiled to bytes/masks
+        if (packKey != 0) {
+            auto [entry, end] = SignaturePack.Find(packKey);
+            for (; entry != end; ++entry) {
+                if (entry->flags & SigPack::Primary)
+                    continue;
+
+                if (auto match = SignaturePack.Scan(*entry, scanBytes, sizeOfImage)) {
+                    return const_cast<std::uint8_t*>(match) + entry->adjust;
                 }
             }
-            if (found) {
-                return &scanBytes[i];
+        }
+
+        if (FuzzyRecovery.bEnabled) {
+            // The pack knows where the call site hooks, otherwise check the start of the signature
+            size_t iHookOffset = 0;
+            if (packKey != 0) {
+                auto [entry, end] = SignaturePack.Find(packKey);
+                for (; entry != end; ++entry) {
+                    if (entry->flags & SigPack::Primary)
+                        iHookOffset = entry->hookOffset;
+                }
             }
+            RecoverSignature(scanBytes, image, pattern, signature, iHookOffset);
         }
         return nullptr;
     }
@@ -75,12 +484,6 @@ namespace Memory
         return len ? (HMODULE)info.AllocationBase : NULL;
     }
 
-    uint32_t ModuleTimestamp(void* module)
-    {
-        auto dosHeader = (PIMAGE_DOS_HEADER)module;
-        auto ntHeaders = (PIMAGE_NT_HEADERS)((std::uint8_t*)module + dosHeader->e_lfanew);
-        return ntHeaders->FileHeader.TimeDateStamp;
-    }
 }
 
 namespace Util
@@ -99,4 +502,120 @@ namespace Util
         ss >> num;
         return num;
     }
+
+    // Logical processors with their core, efficiency class and L3 domain
+    ThreadPolicy::Topology GetCpuTopology() {
+        ThreadPolicy::Topology topology;
+        DWORD dwSize = 0;
+        GetLogicalProcessorInformationEx(RelationAll, nullptr, &dwSize);
+        std::vector<std::uint8_t> buffer(dwSize);
+        if (!dwSize || !GetLogicalProcessorInformationEx(RelationAll, reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &dwSize))
+            return topology;
+
+        auto ForEach = [&](LOGICAL_PROCESSOR_RELATIONSHIP relationship, auto fn) {
+            for (DWORD offset = 0; offset < dwSize;) {
+                auto info = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data() + offset);
+                if (info->Relationship == relationship)
+                    fn(*info);
+                offset += info->Size;
+            }
+        };
+
+        std::uint32_t iCore = 0;
+        ForEach(RelationProcessorCore, [&](const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& info) {
+            bool bFirst = true;
+            for (WORD i = 0; i < info.Processor.GroupCount; i++) {
+                const GROUP_AFFINITY& affinity = info.Processor.GroupMask[i];
+                for (std::uint8_t bit = 0; bit < 64; bit++) {
+                    if (affinity.Mask & (1ull << bit)) {
+                        topology.vProcessors.push_back({ affinity.Group, bit, iCore, info.Processor.EfficiencyClass, 0, bFirst });
+                        bFirst = false;
+                    }
+                }
+            }
+            iCore++;
+        });
+
+        std::uint32_t iL3 = 0;
+        ForEach(RelationCache, [&](const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& info) {
+            if (info.Cache.Level != 3)
+                return;
+            for (auto& processor : topology.vProcessors) {
+                if (processor.iGroup == info.Cache.GroupMask.Group && (info.Cache.GroupMask.Mask & (1ull << processor.iNumber)))
+                    processor.iL3 = iL3;
+            }
+            iL3++;
+        });
+        return topology;
+    }
+
+    std::vector<DWORD> GetProcessThreadIds() {
+        std::vector<DWORD> threadIds;
+        HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+        if (hSnapshot == INVALID_HANDLE_VALUE)
+            return threadIds;
+
+        THREADENTRY32 te32{ .dwSize = sizeof(THREADENTRY32) };
+        if (Thread32First(hSnapshot, &te32)) {
+            do {
+                if (te32.th32OwnerProcessID == GetCurrentProcessId())
+                    threadIds.push_back(te32.th32ThreadID);
+            } while (Thread32Next(hSnapshot, &te32));
+        }
+        CloseHandle(hSnapshot);
+        return threadIds;
+    }
+
+    // Thread description (SetThreadDescription), empty if it has none
+    std::string GetThreadName(HANDLE hThread) {
+        PWSTR pName = nullptr;
+        if (FAILED(GetThreadDescription(hThread, &pName)) || !pName)
+            return {};
+
+        int iLength = WideCharToMultiByte(CP_UTF8, 0, pName, -1, nullptr, 0, nullptr, nullptr);
+        std::string sName(iLength > 0 ? iLength - 1 : 0, '\0');
+        if (iLength > 1)
+            WideCharToMultiByte(CP_UTF8, 0, pName, -1, sName.data(), iLength, nullptr, nullptr);
+        LocalFree(pName);
+        return sName;
+    }
+
+    void SetThreadName(const std::string& sName) {
+        std::wstring sWideName(sName.begin(), sName.end());
+        SetThreadDescription(GetCurrentThread(), sWideName.c_str());
+    }
+
+    // Module containing the thread's start routine, needs THREAD_QUERY_INFORMATION.
+    // Threads started through the CRT (std::thread) report the CRT here, not the module that created them.
+    HMODULE GetThreadStartModule(HANDLE hThread) {
+        using NtQueryInformationThread_t = LONG(NTAPI*)(HANDLE ThreadHandle, ULONG ThreadInformationClass, PVOID ThreadInformation, ULONG ThreadInformationLength, PULONG ReturnLength);
+        constexpr ULONG ThreadQuerySetWin32StartAddress = 9;
+        static auto NtQueryInformationThread_fn = (NtQueryInformationThread_t)GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "NtQueryInformationThread");
+
+        PVOID pStartAddress = nullptr;
+        if (!NtQueryInformationThread_fn || NtQueryInformationThread_fn(hThread, ThreadQuerySetWin32StartAddress, &pStartAddress, sizeof(pStartAddress), nullptr) < 0)
+            return NULL;
+
+        HMODULE module = NULL;
+        GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, reinterpret_cast<LPCWSTR>(pStartAddress), &module);
+        return module;
+    }
+
+    std::string GetModuleName(HMODULE module) {
+        WCHAR sPath[MAX_PATH] = {};
+        if (!module || !GetModuleFileNameW(module, sPath, MAX_PATH))
+            return {};
+        return std::filesystem::path(sPath).filename().string();
+    }
+
+    // memcpy that returns false instead of crashing if source isn't readable
+    bool SafeCopy(void* destination, const void* source, size_t size) {
+        __try {
+            memcpy(destination, source, size);
+            return true;
+        }
+        __except (GetExceptionCode() == EXCEPTION_ACCESS_VIOLATION ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+            return false;
+        }
+    }
 }
\ No newline at end of file
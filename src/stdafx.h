@@ -4,8 +4,10 @@
 
 #include <cassert>
 #include <windows.h>
+#include <winternl.h>
 #include <fstream>
 #include <iostream>
 #include <inttypes.h>
 #include <filesystem>
+#include <map>
 #include <string>
\ No newline at end of file
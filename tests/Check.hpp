@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+// Minimal test harness, each test executable is a list of TEST()s and returns the number of failed checks.
+namespace Check
+{
+    struct Test
+    {
+        const char* sName;
+        std::function<void()> fn;
+    };
+
+    inline std::vector<Test>& Tests()
+    {
+        static std::vector<Test> tests;
+        return tests;
+    }
+
+    inline int iFailures = 0;
+
+    struct Register
+    {
+        Register(const char* sName, std::function<void()> fn) { Tests().push_back({ sName, std::move(fn) }); }
+    };
+
+    inline void Fail(const char* sFile, int iLine, const char* sExpression)
+    {
+        printf("%s:%d: check failed: %s\n", sFile, iLine, sExpression);
+        iFailures++;
+    }
+
+    inline int Run()
+    {
+        for (const auto& test : Tests()) {
+            int iBefore = iFailures;
+            test.fn();
+            printf("%s %s\n", iFailures == iBefore ? "[ OK ]" : "[FAIL]", test.sName);
+        }
+        return iFailures;
+    }
+}
+
+#define CHECK_CONCAT_(a, b) a##b
+#define CHECK_CONCAT(a, b) CHECK_CONCAT_(a, b)
+
+#define TEST(name)                                                                          \
+    static void name();                                                                     \
+    static Check::Register CHECK_CONCAT(register_, name)(#name, name);                      \
+    static void name()
+
+#define CHECK(expression)                                                                   \
+    do {                                                                                    \
+        if (!(expression))                                                                  \
+            Check::Fail(__FILE__, __LINE__, #expression);                                   \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) CHECK(std::fabs((double)(a) - (double)(b)) <= (tolerance))
+
+#define TEST_MAIN()                                                                         \
+    int main() { return Check::Run() == 0 ? 0 : 1; }
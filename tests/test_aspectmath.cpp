@@ -0,0 +1,40 @@
+#include "Check.hpp"
+#include "AspectMath.hpp"
+
+namespace
+{
+    constexpr float kNative = 16.0f / 9.0f;
+}
+
+TEST(NativeAspect)
+{
+    auto layout = Aspect::Calculate(1920, 1080, kNative);
+    CHECK_NEAR(layout.fAspectRatio, kNative, 1e-6);
+    CHECK_NEAR(layout.fAspectMultiplier, 1.0, 1e-6);
+    CHECK_NEAR(layout.fHUDWidth, 1920, 1e-3);
+    CHECK_NEAR(layout.fHUDHeight, 1080, 1e-3);
+    CHECK_NEAR(layout.fHUDWidthOffset, 0, 1e-3);
+    CHECK_NEAR(layout.fHUDHeightOffset, 0, 1e-3);
+}
+
+TEST(UltrawidePillarboxesHUD)
+{
+    auto layout = Aspect::Calculate(3440, 1440, kNative);
+    CHECK_NEAR(layout.fAspectRatio, 3440.0 / 1440.0, 1e-6);
+    CHECK_NEAR(layout.fHUDWidth, 2560, 1e-3);
+    CHECK_NEAR(layout.fHUDHeight, 1440, 1e-3);
+    CHECK_NEAR(layout.fHUDWidthOffset, 440, 1e-3);
+    CHECK_NEAR(layout.fHUDHeightOffset, 0, 1e-3);
+}
+
+TEST(NarrowLetterboxesHUD)
+{
+    auto layout = Aspect::Calculate(1920, 1200, kNative);
+    CHECK(layout.fAspectMultiplier < 1.0f);
+    CHECK_NEAR(layout.fHUDWidth, 1920, 1e-3);
+    CHECK_NEAR(layout.fHUDHeight, 1080, 1e-3);
+    CHECK_NEAR(layout.fHUDWidthOffset, 0, 1e-3);
+    CHECK_NEAR(layout.fHUDHeightOffset, 60, 1e-3);
+}
+
+TEST_MAIN()
@@ -0,0 +1,138 @@
+#include "Check.hpp"
+#include "CombatLog.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+    bool SameEvent(const CombatLog::Event& a, const CombatLog::Event& b)
+    {
+        // The timer is only stored for stagger events
+        bool bTimer = a.kind != CombatLog::Kind::Stagger || memcmp(&a.timer, &b.timer, sizeof(a.timer)) == 0;
+        return a.timestamp == b.timestamp && a.combat == b.combat && a.tableIndex == b.tableIndex && a.delta == b.delta &&
+            a.before == b.before && a.after == b.after && a.kind == b.kind && a.staggerType == b.staggerType && bTimer;
+    }
+
+    std::vector<uint8_t> EncodeAll(const std::vector<CombatLog::Event>& events)
+    {
+        std::vector<uint8_t> out;
+        // A record is at most 50 bytes: three 10 byte varints, three 5 byte ones, kind and timer
+        out.reserve(sizeof(CombatLog::FileHeader) + events.size() * 64);
+        CombatLog::Encoder encoder;
+        encoder.Header(out, 10000000);
+        for (const auto& event : events)
+            encoder.Encode(out, event);
+        return out;
+    }
+
+    // Decodes everything it can, returns false if the header was rejected
+    bool DecodeAll(const uint8_t* data, size_t size, std::vector<CombatLog::Event>& events)
+    {
+        events.clear();
+        CombatLog::Decoder decoder(data, size);
+        CombatLog::FileHeader header;
+        if (!decoder.Header(header))
+            return false;
+
+        CombatLog::Event event;
+        while (decoder.Next(event))
+            events.push_back(event);
+        return true;
+    }
+
+    bool SameEvents(const std::vector<CombatLog::Event>& a, const std::vector<CombatLog::Event>& b, size_t iCount)
+    {
+        if (a.size() < iCount || b.size() < iCount)
+            return false;
+        for (size_t i = 0; i < iCount; i++) {
+            if (!SameEvent(a[i], b[i]))
+                return false;
+        }
+        return true;
+    }
+
+    // Two game threads interleaving, timestamps jump back and forth and deltas go both ways
+    std::vector<CombatLog::Event> Events()
+    {
+        using CombatLog::Kind;
+        return {
+            { 1000, 0x7FF612340000, 0x1A, -250, 5000, 4750, 0.0f, Kind::Health, 0 },
+            { 990, 0x7FF612340000, 0x1A, -40, 900, 860, 0.0f, Kind::Will, 0 },
+            { 1500, 0x7FF600001000, 0, 300, 4750, 5050, 0.0f, Kind::Health, 0 },
+            { 1200, 0x7FF612340000, 0x1A, 0, 0, 1, 7.5f, Kind::Stagger, 1 },
+            { 1200, 0x7FF612340000, 0x1A, 0, 1, 2, -0.25f, Kind::Stagger, 2 },
+            // Largest pointer and table index, then straight back down to a small one
+            { 1300, UINT64_MAX, UINT64_MAX, INT32_MIN, UINT32_MAX, 0, 0.0f, Kind::Health, 0 },
+            { 1301, 0x10000, 1, INT32_MAX, 0, UINT32_MAX, 0.0f, Kind::Will, 0 },
+            { 0, 0x10000, 1, 0, 0, 0, 0.0f, Kind::Health, 0 },
+            { UINT64_MAX, 0x7FFFFFFFFFFF, 2, -1, 1, 0, 3.0f, Kind::Stagger, 3 },
+            { 5, 0x7FFFFFFFFFFF, 2, 1, 0, 1, 0.0f, Kind::Will, 0 },
+        };
+    }
+}
+
+TEST(RoundTrip)
+{
+    std::vector<CombatLog::Event> events = Events();
+    std::vector<uint8_t> data = EncodeAll(events);
+
+    std::vector<CombatLog::Event> decoded;
+    CHECK(DecodeAll(data.data(), data.size(), decoded));
+    CHECK(decoded.size() == events.size());
+    CHECK(SameEvents(decoded, events, events.size()));
+}
+
+TEST(SmallDeltasStaySmall)
+{
+    using CombatLog::Kind;
+    // Same entity 1 tick later, every field but the pointer and table index fits a single byte
+    std::vector<CombatLog::Event> events = {
+        { 1000, 0x7FF612340000, 0x1A, -1, 10, 9, 0.0f, Kind::Health, 0 },
+        { 1001, 0x7FF612340000, 0x1A, -1, 9, 8, 0.0f, Kind::Health, 0 },
+    };
+    std::vector<uint8_t> first = EncodeAll({ events[0] });
+    std::vector<uint8_t> both = EncodeAll(events);
+    CHECK(both.size() - first.size() == 7);
+}
+
+TEST(RejectsBadHeader)
+{
+    std::vector<uint8_t> data = EncodeAll(Events());
+    std::vector<CombatLog::Event> decoded;
+    CHECK(!DecodeAll(data.data(), sizeof(CombatLog::FileHeader) - 1, decoded));
+
+    data[0] ^= 1;
+    CHECK(!DecodeAll(data.data(), data.size(), decoded));
+}
+
+// The game can close in the middle of a write. Cutting the last record anywhere keeps every record before it and drops
+// the partial one, including a stagger event missing part of its timer.
+TEST(TruncatedFinalRecord)
+{
+    std::vector<CombatLog::Event> events = Events();
+    std::vector<uint8_t> data = EncodeAll(events);
+    std::vector<uint8_t> withoutLast = EncodeAll({ events.begin(), events.end() - 1 });
+    CHECK(withoutLast.size() < data.size());
+
+    bool bKeepsEarlier = true;
+    for (size_t iSize = withoutLast.size(); iSize < data.size(); iSize++) {
+        std::vector<CombatLog::Event> decoded;
+        bKeepsEarlier &= DecodeAll(data.data(), iSize, decoded);
+        bKeepsEarlier &= decoded.size() == events.size() - 1 && SameEvents(decoded, events, events.size() - 1);
+    }
+    CHECK(bKeepsEarlier);
+
+    // Stagger event last, its timer is the last 4 bytes
+    std::vector<CombatLog::Event> stagger(events.begin(), events.begin() + 4);
+    std::vector<uint8_t> staggerData = EncodeAll(stagger);
+    std::vector<CombatLog::Event> decoded;
+    for (size_t iCut = 1; iCut <= sizeof(float); iCut++) {
+        CHECK(DecodeAll(staggerData.data(), staggerData.size() - iCut, decoded));
+        CHECK(decoded.size() == 3);
+    }
+    CHECK(DecodeAll(staggerData.data(), staggerData.size(), decoded) && decoded.size() == 4);
+    CHECK(SameEvents(decoded, stagger, 4));
+}
+
+TEST_MAIN()
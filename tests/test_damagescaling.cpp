@@ -0,0 +1,93 @@
+#include "Check.hpp"
+#include "DamageScaling.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+    // What the damage hooks computed before the fixed point change
+    int FloatScale(s32 delta, float scale)
+    {
+        return static_cast<int>(delta * scale);
+    }
+
+    std::vector<s32> Deltas()
+    {
+        std::vector<s32> deltas = { 0, 1, -1, 2, -2, 3, -3, 7, -7, 99, -99, 9999, -9999, 65535, -65536, 1 << 20, -(1 << 20) };
+        for (s32 delta = -100000; delta <= 100000; delta += 37)
+            deltas.push_back(delta);
+        return deltas;
+    }
+}
+
+TEST(FixedPointValues)
+{
+    CHECK(DamageScaling::ToFixed(1.0f) == DamageScaling::kOne);
+    CHECK(DamageScaling::ToFixed(0.0f) == 0);
+    CHECK(DamageScaling::ToFixed(0.5f) == DamageScaling::kOne / 2);
+    CHECK(DamageScaling::ToFixed(-2.0f) == -2 * DamageScaling::kOne);
+    CHECK(DamageScaling::ToFixed(100.0f) == 100 * DamageScaling::kOne);
+    // Rounded to the nearest step, not truncated
+    CHECK(DamageScaling::ToFixed(0.1f) == 6554);
+    CHECK(DamageScaling::ToFixed(1.0f / 3.0f) == 21845);
+}
+
+TEST(TruncatesTowardZero)
+{
+    s32 iHalf = DamageScaling::ToFixed(0.5f);
+    CHECK(DamageScaling::Apply(3, iHalf) == 1);
+    CHECK(DamageScaling::Apply(-3, iHalf) == -1);
+    CHECK(DamageScaling::Apply(1, iHalf) == 0);
+    CHECK(DamageScaling::Apply(-1, iHalf) == 0);
+    CHECK(DamageScaling::Apply(-3, -iHalf) == 1);
+}
+
+// Scales with a short binary fraction are exact in 16.16 and, for these deltas, in the float multiply too
+TEST(ExactScalesMatchFloat)
+{
+    const float scales[] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f, 1.5f, 2.0f, 3.0f, 100.0f, -0.5f, -1.0f, -2.5f };
+    bool bMatch = true;
+    for (float scale : scales) {
+        s32 iScale = DamageScaling::ToFixed(scale);
+        for (s32 delta : Deltas())
+            bMatch &= DamageScaling::Apply(delta, iScale) == FloatScale(delta, scale);
+    }
+    CHECK(bMatch);
+}
+
+// ToFixed rounds scales like 0.1 or 1/3 to the nearest 1/65536, off by at most 2^-17. Over a delta that is |delta| * 2^-17,
+// and the float multiply rounds to 24 bits on its side, so the two may land on neighbouring integers past a few thousand
+TEST(InexactScalesStayWithinRounding)
+{
+    const float scales[] = { 0.1f, 1.0f / 3.0f, 0.7f, 1.1f, 3.3f, 99.9f, -0.1f, -1.0f / 3.0f };
+    bool bWithin = true;
+    bool bSmallOffByOne = true;
+    for (float scale : scales) {
+        s32 iScale = DamageScaling::ToFixed(scale);
+        for (s32 delta : Deltas()) {
+            double fProduct = std::abs((double)delta * scale);
+            long long iAllowed = (long long)(std::abs((double)delta) / (1 << 17) + fProduct / (1 << 24)) + 1;
+            long long iDiff = std::llabs((long long)DamageScaling::Apply(delta, iScale) - FloatScale(delta, scale));
+            bWithin &= iDiff <= iAllowed;
+            // Ordinary hits are off by at most one
+            if (std::abs(delta) <= 1000)
+                bSmallOffByOne &= iDiff <= 1;
+        }
+    }
+    CHECK(bWithin);
+    CHECK(bSmallOffByOne);
+}
+
+TEST(LargestSafeDelta)
+{
+    s32 iMax = DamageScaling::ToFixed(100.0f);
+    CHECK(DamageScaling::Apply(21474836, iMax) == 2147483600);
+    CHECK(DamageScaling::Apply(-21474836, iMax) == -2147483600);
+    CHECK(DamageScaling::Apply(INT32_MAX, DamageScaling::kOne) == INT32_MAX);
+    CHECK(DamageScaling::Apply(INT32_MIN, DamageScaling::kOne) == INT32_MIN);
+}
+
+TEST_MAIN()
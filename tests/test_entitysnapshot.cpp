@@ -0,0 +1,151 @@
+#include "Check.hpp"
+#include "EntitySnapshot.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace
+{
+    // Stand-in for the game's object table, laid out the way the iterator hook sees it
+    struct Table
+    {
+        std::unique_ptr<CombatDetail[]> combat;
+        std::unique_ptr<Unk9f30Struct[]> entries;
+        std::unique_ptr<Unk9f30Struct*[]> pointers;
+        Struct_Param2_Field0x00 inner{};
+        Struct_Param2 param{};
+
+        explicit Table(size_t iCount)
+            : combat(new CombatDetail[iCount]()), entries(new Unk9f30Struct[iCount]()), pointers(new Unk9f30Struct*[iCount]())
+        {
+            for (size_t i = 0; i < iCount; i++) {
+                entries[i].TableIndex = 100 + i;
+                entries[i].Combat = &combat[i];
+                pointers[i] = &entries[i];
+            }
+            inner.unk_0x08 = pointers.get();
+            param.unk_0x00 = &inner;
+            param.unk_0x08 = iCount;
+        }
+
+        void SetAll(u32 iValue)
+        {
+            for (size_t i = 0; i < param.unk_0x08; i++) {
+                combat[i].Health = iValue;
+                combat[i].Will = iValue;
+                combat[i].StaggerType = iValue;
+                combat[i].StaggerTimer = (float)iValue;
+            }
+        }
+    };
+}
+
+TEST(EmptyBufferFindsNothing)
+{
+    auto buffer = std::make_unique<Entities::SnapshotBuffer>();
+    Table table(1);
+    Entities::Record record{};
+    CHECK(!buffer->Find(&table.combat[0], record));
+    CHECK(buffer->Frame() == 0);
+
+    buffer->Build(nullptr);
+    Struct_Param2 empty{};
+    buffer->Build(&empty);
+    CHECK(buffer->Frame() == 0);
+}
+
+TEST(BuildSkipsMissingAndDuplicateEntries)
+{
+    auto buffer = std::make_unique<Entities::SnapshotBuffer>();
+    Table table(5);
+    table.SetAll(1);
+    table.pointers[1] = nullptr;
+    table.entries[2].Combat = nullptr;
+    table.entries[4].Combat = &table.combat[0];
+    buffer->Build(&table.param);
+
+    const Entities::Snapshot& snapshot = buffer->Latest();
+    CHECK(snapshot.iCount == 2);
+    CHECK(snapshot.TableIndex[0] == 100 && snapshot.TableIndex[1] == 103);
+
+    Entities::Record record{};
+    CHECK(buffer->Find(&table.combat[0], record) && record.TableIndex == 100);
+    CHECK(buffer->Find(&table.combat[3], record) && record.TableIndex == 103);
+    CHECK(!buffer->Find(&table.combat[1], record));
+    CHECK(!buffer->Find(&table.combat[2], record));
+}
+
+TEST(BuildPublishesNewGeneration)
+{
+    auto buffer = std::make_unique<Entities::SnapshotBuffer>();
+    Table table(3);
+    table.SetAll(10);
+    buffer->Build(&table.param);
+    CHECK(buffer->Frame() == 1);
+    CHECK(buffer->Latest().iFrame == 1);
+
+    Entities::Record record{};
+    CHECK(buffer->Find(&table.combat[2], record));
+    CHECK(record.TableIndex == 102 && record.Combat == &table.combat[2] && record.Health == 10 && record.Will == 10);
+
+    // Values are copied, the live object changing doesn't show until the next build
+    table.SetAll(20);
+    CHECK(buffer->Find(&table.combat[2], record) && record.Health == 10);
+
+    const Entities::Snapshot* previous = &buffer->Latest();
+    buffer->Build(&table.param);
+    CHECK(buffer->Frame() == 2);
+    CHECK(&buffer->Latest() != previous);
+    CHECK(buffer->Latest().iFrame == 2);
+    CHECK(buffer->Find(&table.combat[2], record) && record.Health == 20 && record.StaggerTimer == 20.0f);
+
+    // Entities that left the table are gone from the new generation
+    table.param.unk_0x08 = 1;
+    buffer->Build(&table.param);
+    CHECK(buffer->Find(&table.combat[0], record));
+    CHECK(!buffer->Find(&table.combat[2], record));
+}
+
+// One thread builds back to back like the iterator hook while another looks entities up. Every field of a row comes from
+// the same build, a lookup that overlaps a build of the same buffer has to fail instead of returning a mix.
+TEST(ReadDuringBuildFailsInsteadOfTearing)
+{
+    constexpr u32 kBuilds = 20000;
+    auto buffer = std::make_unique<Entities::SnapshotBuffer>();
+    Table table(64);
+    table.SetAll(1);
+    buffer->Build(&table.param);
+
+    std::atomic<bool> bDone = false;
+    std::thread builder([&] {
+        for (u32 i = 2; i <= kBuilds; i++) {
+            table.SetAll(i);
+            buffer->Build(&table.param);
+        }
+        bDone.store(true, std::memory_order_release);
+        });
+
+    bool bConsistent = true;
+    bool bOrdered = true;
+    u32 iLast = 0;
+    Entities::Record record{};
+    while (!bDone.load(std::memory_order_acquire)) {
+        for (size_t i = 0; i < 64; i++) {
+            if (!buffer->Find(&table.combat[i], record))
+                continue;
+            bConsistent &= record.Will == record.Health && record.StaggerType == record.Health && record.StaggerTimer == (float)record.Health;
+            bConsistent &= record.Combat == &table.combat[i] && record.TableIndex == 100 + i;
+            bOrdered &= record.Health >= iLast;
+            iLast = record.Health;
+        }
+    }
+    builder.join();
+
+    CHECK(bConsistent);
+    CHECK(bOrdered);
+    CHECK(buffer->Frame() == kBuilds);
+    CHECK(buffer->Find(&table.combat[63], record) && record.Health == kBuilds);
+}
+
+TEST_MAIN()
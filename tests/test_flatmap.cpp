@@ -0,0 +1,119 @@
+#include "Check.hpp"
+#include "FlatMap.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+    // Same slot as FlatMap::Hash picks
+    template<size_t Capacity>
+    size_t SlotOf(uint64_t key)
+    {
+        return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (Capacity - 1);
+    }
+
+    // Keys that all hash to the slot of the first one
+    template<size_t Capacity>
+    std::vector<uint64_t> CollidingKeys(size_t iCount)
+    {
+        std::vector<uint64_t> keys;
+        size_t iSlot = SlotOf<Capacity>(1);
+        for (uint64_t key = 1; keys.size() < iCount; key++) {
+            if (SlotOf<Capacity>(key) == iSlot)
+                keys.push_back(key);
+        }
+        return keys;
+    }
+}
+
+TEST(InsertAndFind)
+{
+    FlatMap<uint64_t, int, 16> map;
+    CHECK(map.Size() == 0);
+    CHECK(map.Find(7) == nullptr);
+
+    CHECK(map.Insert(7, 70));
+    CHECK(map.Insert(0, 1));
+    CHECK(map.Insert(1000000007, 3));
+    CHECK(map.Size() == 3);
+
+    CHECK(map.Find(7) && *map.Find(7) == 70);
+    CHECK(map.Find(0) && *map.Find(0) == 1);
+    CHECK(map.Find(1000000007) && *map.Find(1000000007) == 3);
+    CHECK(map.Find(8) == nullptr);
+}
+
+TEST(DuplicateKeepsFirstValue)
+{
+    FlatMap<uint64_t, int, 16> map;
+    CHECK(map.Insert(5, 1));
+    CHECK(!map.Insert(5, 2));
+    CHECK(map.Size() == 1);
+    CHECK(*map.Find(5) == 1);
+}
+
+TEST(FullTableRejectsInsert)
+{
+    // Kept at most 3/4 full, 6 of 8 slots
+    FlatMap<uint64_t, int, 8> map;
+    for (int i = 0; i < 6; i++)
+        CHECK(map.Insert(100 + i, i));
+    CHECK(!map.Insert(200, 0));
+    CHECK(map.Size() == 6);
+    for (int i = 0; i < 6; i++)
+        CHECK(map.Find(100 + i) && *map.Find(100 + i) == i);
+    CHECK(map.Find(200) == nullptr);
+}
+
+TEST(CollidingKeysProbe)
+{
+    FlatMap<uint64_t, int, 16> map;
+    std::vector<uint64_t> keys = CollidingKeys<16>(5);
+    for (size_t i = 0; i < keys.size(); i++)
+        CHECK(map.Insert(keys[i], (int)i));
+    CHECK(!map.Insert(keys[2], 99));
+
+    for (size_t i = 0; i < keys.size(); i++)
+        CHECK(map.Find(keys[i]) && *map.Find(keys[i]) == (int)i);
+
+    // Same slot but never inserted, the probe stops at the first empty slot after the run
+    std::vector<uint64_t> more = CollidingKeys<16>(6);
+    CHECK(map.Find(more[5]) == nullptr);
+}
+
+TEST(ProbeWrapsAround)
+{
+    FlatMap<uint64_t, int, 8> map;
+    // Fill the last slot first so the next key with the same slot wraps to 0
+    std::vector<uint64_t> keys;
+    for (uint64_t key = 1; keys.size() < 3; key++) {
+        if (SlotOf<8>(key) == 7)
+            keys.push_back(key);
+    }
+    for (size_t i = 0; i < keys.size(); i++)
+        CHECK(map.Insert(keys[i], (int)i));
+    for (size_t i = 0; i < keys.size(); i++)
+        CHECK(map.Find(keys[i]) && *map.Find(keys[i]) == (int)i);
+}
+
+TEST(ClearForgetsEverything)
+{
+    FlatMap<const int*, int, 8> map;
+    int values[6] = {};
+    for (int i = 0; i < 6; i++)
+        CHECK(map.Insert(&values[i], i));
+    CHECK(!map.Insert(&values[0], 0));
+
+    map.Clear();
+    CHECK(map.Size() == 0);
+    for (int i = 0; i < 6; i++)
+        CHECK(map.Find(&values[i]) == nullptr);
+
+    // Slots from the last generation count as empty
+    CHECK(map.Insert(&values[3], 30));
+    CHECK(map.Find(&values[3]) && *map.Find(&values[3]) == 30);
+    CHECK(map.Find(&values[0]) == nullptr);
+}
+
+TEST_MAIN()
@@ -0,0 +1,99 @@
+#include "Check.hpp"
+#include "FrameLimiter.hpp"
+#include "WindowFocus.hpp"
+
+namespace
+{
+    constexpr int64_t kMs = 1000000;
+
+    // A game that renders a frame every iFrameNs and then waits as long as the limiter says, on a simulated clock
+    struct Game
+    {
+        FrameLimit::Limiter limiter;
+        Focus::StateMachine focus;
+        int64_t iNowNs = 0;
+        int64_t iFrameNs = 2 * kMs;
+
+        // Returns the wait for this frame
+        int64_t Frame()
+        {
+            iNowNs += iFrameNs;
+            int64_t iWaitNs = limiter.OnFrame(!focus.IsForeground(), iNowNs);
+            iNowNs += iWaitNs;
+            return iWaitNs;
+        }
+    };
+}
+
+TEST(PacedInBackground)
+{
+    Game game;
+    game.limiter.SetFramerate(20.0f);
+    game.focus.OnEvent(Focus::Event::Foreground);
+    for (int i = 0; i < 10; i++)
+        CHECK(game.Frame() == 0);
+
+    game.focus.OnEvent(Focus::Event::Background);
+    CHECK(game.Frame() == 0); // First limited frame isn't held
+    CHECK(game.limiter.IsLimiting());
+
+    int64_t iStart = game.iNowNs;
+    for (int i = 0; i < 20; i++)
+        CHECK(game.Frame() == 50 * kMs - game.iFrameNs);
+    CHECK(game.iNowNs - iStart == 20 * 50 * kMs);
+}
+
+TEST(RefocusLiftsLimitNextFrame)
+{
+    Game game;
+    game.limiter.SetFramerate(10.0f);
+    game.focus.OnEvent(Focus::Event::Background);
+    for (int i = 0; i < 5; i++)
+        game.Frame();
+    CHECK(game.limiter.IsLimiting());
+
+    game.focus.OnEvent(Focus::Event::Foreground);
+    CHECK(game.Frame() == 0);
+    CHECK(!game.limiter.IsLimiting());
+    CHECK(game.Frame() == 0);
+}
+
+TEST(LateFrameResetsDeadline)
+{
+    Game game;
+    game.limiter.SetFramerate(20.0f);
+    game.focus.OnEvent(Focus::Event::Background);
+    game.Frame();
+    game.Frame();
+
+    // A hitch of several intervals, e.g. a loading stall
+    game.iNowNs += 300 * kMs;
+    CHECK(game.Frame() == 0);
+
+    // The frames after it are paced again instead of running back to back to catch up
+    for (int i = 0; i < 5; i++)
+        CHECK(game.Frame() == 50 * kMs - game.iFrameNs);
+}
+
+TEST(SlightlyLateFrameKeepsAverage)
+{
+    // Less than an interval late, the next wait is shorter so the cap holds on average
+    FrameLimit::Limiter limiter;
+    limiter.SetFramerate(20.0f);
+    CHECK(limiter.OnFrame(true, 0) == 0);
+    CHECK(limiter.OnFrame(true, 60 * kMs) == 0);
+    CHECK(limiter.OnFrame(true, 70 * kMs) == 30 * kMs);
+}
+
+TEST(ZeroFramerateDoesNothing)
+{
+    Game game;
+    game.limiter.SetFramerate(0.0f);
+    CHECK(game.limiter.IntervalNs() == 0);
+    game.focus.OnEvent(Focus::Event::Background);
+    for (int i = 0; i < 10; i++)
+        CHECK(game.Frame() == 0);
+    CHECK(!game.limiter.IsLimiting());
+}
+
+TEST_MAIN()
@@ -0,0 +1,84 @@
+#include "Check.hpp"
+#include "LodCurve.hpp"
+
+#include <limits>
+#include <random>
+
+TEST(ParsePoints)
+{
+    std::vector<LodCurve::Point> points;
+    CHECK(LodCurve::Parse("0:1, 100:1, 400:2", points));
+    CHECK(points.size() == 3);
+    CHECK_NEAR(points[2].fDistance, 400, 1e-6);
+    CHECK_NEAR(points[2].fMultiplier, 2, 1e-6);
+
+    CHECK(LodCurve::Parse("", points) && points.empty());
+    CHECK(LodCurve::Parse(" 50 : 0.5 ,", points) && points.size() == 1);
+}
+
+TEST(RejectBadPoints)
+{
+    std::vector<LodCurve::Point> points;
+    CHECK(!LodCurve::Parse("100", points));
+    CHECK(!LodCurve::Parse("100:x", points));
+    CHECK(!LodCurve::Parse("100:1 2", points));
+    CHECK(!LodCurve::Parse("-1:1", points));
+    CHECK(!LodCurve::Parse("100:1, 100:2", points));
+    CHECK(!LodCurve::Parse("200:1, 100:2", points));
+
+    std::string sTooMany;
+    for (size_t i = 0; i <= LodCurve::kMaxPoints; i++)
+        sTooMany += std::to_string(i * 10) + ":1,";
+    CHECK(!LodCurve::Parse(sTooMany, points));
+}
+
+TEST(InterpolateAndHoldEnds)
+{
+    std::vector<LodCurve::Point> points = { { 100, 1 }, { 300, 3 } };
+    CHECK_NEAR(LodCurve::Interpolate(points, 0), 1, 1e-6);
+    CHECK_NEAR(LodCurve::Interpolate(points, 100), 1, 1e-6);
+    CHECK_NEAR(LodCurve::Interpolate(points, 200), 2, 1e-6);
+    CHECK_NEAR(LodCurve::Interpolate(points, 1000), 3, 1e-6);
+    CHECK_NEAR(LodCurve::Interpolate({}, 50), 1, 1e-6);
+}
+
+TEST(TableMatchesCurve)
+{
+    std::vector<LodCurve::Point> points;
+    CHECK(LodCurve::Parse("0:1, 100:1, 400:2, 1000:4", points));
+    auto table = LodCurve::Compile(points);
+
+    // Slopes are 0, 1/300 and 1/300, so the largest change is 1/300. Half an entry is 1000/128.
+    const double kTolerance = (1.0 / 300.0) * (1000.0 / 128.0) + 1e-4;
+    std::mt19937 rng(47);
+    std::uniform_real_distribution<float> distance(0.0f, 1200.0f);
+    bool bClose = true;
+    for (int i = 0; i < 10000; i++) {
+        float fDistance = distance(rng);
+        bClose &= std::fabs(table.Evaluate(fDistance) - LodCurve::Interpolate(points, fDistance)) <= kTolerance;
+    }
+    CHECK(bClose);
+
+    CHECK_NEAR(table.Evaluate(0), 1, 1e-6);
+    CHECK_NEAR(table.Evaluate(1000), 4, 1e-5);
+    CHECK_NEAR(table.Evaluate(1e9f), 4, 1e-5);
+}
+
+TEST(TableEdgeCases)
+{
+    auto empty = LodCurve::Compile({});
+    CHECK_NEAR(empty.Evaluate(0), 1, 1e-6);
+    CHECK_NEAR(empty.Evaluate(500), 1, 1e-6);
+
+    // One point is a flat curve
+    auto flat = LodCurve::Compile({ { 250, 1.5f } });
+    CHECK_NEAR(flat.Evaluate(0), 1.5, 1e-6);
+    CHECK_NEAR(flat.Evaluate(10000), 1.5, 1e-6);
+
+    auto table = LodCurve::Compile({ { 0, 2 }, { 100, 1 } });
+    CHECK_NEAR(table.Evaluate(-50), 2, 1e-6);
+    CHECK_NEAR(table.Evaluate(std::numeric_limits<float>::quiet_NaN()), 2, 1e-6);
+    CHECK_NEAR(table.Evaluate(std::numeric_limits<float>::infinity()), 1, 1e-6);
+}
+
+TEST_MAIN()
@@ -0,0 +1,128 @@
+#include "Check.hpp"
+#include "Pattern.hpp"
+
+#include <random>
+
+namespace
+{
+    std::vector<uint8_t> RandomBytes(size_t size, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> data(size);
+        for (auto& b : data)
+            b = (uint8_t)(rng() % 16); // Few distinct values so partial matches are common
+        return data;
+    }
+
+    void Place(std::vector<uint8_t>& data, size_t offset, const Pattern::Signature& signature)
+    {
+        for (size_t i = 0; i < signature.Size(); i++) {
+            if (signature.IsLiteral(i))
+                data[offset + i] = signature.bytes[i];
+        }
+    }
+
+    // Every strategy has to agree with the naive scan
+    void CheckAllStrategies(const std::vector<uint8_t>& data, const Pattern::Signature& signature, const uint8_t* expected)
+    {
+        Pattern::ByteHistogram histogram;
+        histogram.Add(data.data(), data.size());
+        auto anchor = Pattern::ChooseAnchor(signature, histogram);
+        auto horspool = Pattern::BuildHorspool(signature);
+
+        CHECK(Pattern::Find(data.data(), data.size(), signature) == expected);
+        CHECK(Pattern::Find(data.data(), data.size(), signature, anchor) == expected);
+        CHECK(Pattern::Find(data.data(), data.size(), signature, horspool) == expected);
+    }
+}
+
+TEST(ParseLiteralsAndWildcards)
+{
+    auto signature = Pattern::Parse("48 8b ?? ? 05 FF");
+    CHECK(signature.Size() == 6);
+    CHECK(signature.bytes[0] == 0x48 && signature.bytes[1] == 0x8B && signature.bytes[4] == 0x05 && signature.bytes[5] == 0xFF);
+    CHECK(!signature.IsLiteral(2) && !signature.IsLiteral(3));
+    CHECK(signature.bytes[2] == 0 && signature.bytes[3] == 0);
+    CHECK(signature.IsLiteral(0) && signature.IsLiteral(5));
+}
+
+TEST(ParseEmpty)
+{
+    CHECK(Pattern::Parse("").Size() == 0);
+    CHECK(Pattern::Parse("   ").Size() == 0);
+}
+
+TEST(FindFirstMatch)
+{
+    auto data = RandomBytes(1 << 16, 1);
+    auto signature = Pattern::Parse("AB ?? CD EF 12 ?? 34");
+    Place(data, 40000, signature);
+    Place(data, 50000, signature);
+    CheckAllStrategies(data, signature, data.data() + 40000);
+}
+
+TEST(FindAtEnd)
+{
+    auto data = RandomBytes(4096, 2);
+    auto signature = Pattern::Parse("AB CD EF 12 34 56 78 9A BC");
+    Place(data, data.size() - signature.Size(), signature);
+    CheckAllStrategies(data, signature, data.data() + data.size() - signature.Size());
+}
+
+TEST(FindNoMatch)
+{
+    auto data = RandomBytes(4096, 3);
+    CheckAllStrategies(data, Pattern::Parse("AB CD EF 12 ?? 56"), nullptr);
+}
+
+TEST(FindLongerThanData)
+{
+    std::vector<uint8_t> data = { 0x48, 0x8B };
+    CheckAllStrategies(data, Pattern::Parse("48 8B 05"), nullptr);
+}
+
+TEST(FindRandomSignatures)
+{
+    std::mt19937 rng(4);
+    for (int iRound = 0; iRound < 200; iRound++) {
+        auto data = RandomBytes(8192, 100 + iRound);
+        Pattern::Signature signature;
+        size_t iLength = 3 + rng() % 20;
+        for (size_t i = 0; i < iLength; i++) {
+            bool bWildcard = i > 0 && i + 1 < iLength && rng() % 3 == 0;
+            signature.bytes.push_back(bWildcard ? 0 : (uint8_t)(rng() % 16));
+            signature.mask.push_back(bWildcard ? 0 : 0xFF);
+        }
+        CheckAllStrategies(data, signature, Pattern::Find(data.data(), data.size(), signature));
+    }
+}
+
+TEST(HorspoolUsesLongestRun)
+{
+    auto signature = Pattern::Parse("48 ?? 8B 05 11 22 ?? 33");
+    auto horspool = Pattern::BuildHorspool(signature);
+    CHECK(horspool.iRunOffset == 2);
+    CHECK(horspool.iRunLength == 4);
+}
+
+TEST(ChooseStrategy)
+{
+    auto longRun = Pattern::Parse("48 89 5C 24 08 57 48 83 EC ??");
+    CHECK(Pattern::ChooseStrategy(longRun, Pattern::BuildHorspool(longRun)) == Pattern::Strategy::Horspool);
+    auto wildcards = Pattern::Parse("45 ?? ?? 0F 84 ?? ?? ?? ?? 8B ??");
+    CHECK(Pattern::ChooseStrategy(wildcards, Pattern::BuildHorspool(wildcards)) == Pattern::Strategy::Anchor);
+}
+
+TEST(AnchorPicksRarestByte)
+{
+    std::vector<uint8_t> data(1000, 0x90);
+    data[10] = 0xCC;
+    Pattern::ByteHistogram histogram;
+    histogram.Add(data.data(), data.size());
+    auto anchor = Pattern::ChooseAnchor(Pattern::Parse("90 90 CC 90"), histogram);
+    CHECK(anchor.bValid);
+    CHECK(anchor.iByte == 0xCC);
+    CHECK(anchor.iOffset == 2);
+}
+
+TEST_MAIN()
@@ -0,0 +1,87 @@
+#include "Check.hpp"
+#include "PEImage.hpp"
+
+namespace
+{
+    template<typename T>
+    void Put(std::vector<uint8_t>& data, size_t offset, T value)
+    {
+        memcpy(data.data() + offset, &value, sizeof(T));
+    }
+
+    // DOS header, PE32+ headers and one .text section
+    std::vector<uint8_t> MakeImage()
+    {
+        std::vector<uint8_t> data(0x400, 0);
+        constexpr size_t kNt = 0x80;
+        constexpr size_t kOptional = kNt + 4 + 20;
+        constexpr uint16_t kOptionalSize = 0xF0;
+
+        Put<uint16_t>(data, 0x00, 0x5A4D);
+        Put<uint32_t>(data, 0x3C, kNt);
+        Put<uint32_t>(data, kNt, 0x00004550);
+        Put<uint16_t>(data, kNt + 4 + 2, 1);           // NumberOfSections
+        Put<uint32_t>(data, kNt + 4 + 4, 0x65A1B2C3);  // TimeDateStamp
+        Put<uint16_t>(data, kNt + 4 + 16, kOptionalSize);
+        Put<uint16_t>(data, kOptional, 0x20B);
+        Put<uint32_t>(data, kOptional + 56, 0x200000); // SizeOfImage
+        Put<uint32_t>(data, kOptional + 60, 0x400);    // SizeOfHeaders
+
+        size_t iSection = kOptional + kOptionalSize;
+        memcpy(data.data() + iSection, ".text", 5);
+        Put<uint32_t>(data, iSection + 8, 0x1234);
+        Put<uint32_t>(data, iSection + 12, 0x1000);
+        Put<uint32_t>(data, iSection + 16, 0x1400);
+        Put<uint32_t>(data, iSection + 20, 0x400);
+        Put<uint32_t>(data, iSection + 36, PE::kSectionCode | PE::kSectionExecute);
+        return data;
+    }
+}
+
+TEST(ParseHeaders)
+{
+    auto data = MakeImage();
+    PE::Image image;
+    CHECK(PE::Parse(data.data(), data.size(), image));
+    CHECK(image.iTimestamp == 0x65A1B2C3);
+    CHECK(image.iSizeOfImage == 0x200000);
+    CHECK(image.iSizeOfHeaders == 0x400);
+    CHECK(image.vSections.size() == 1);
+    if (image.vSections.size() == 1) {
+        const auto& section = image.vSections[0];
+        CHECK(section.sName == ".text");
+        CHECK(section.iVirtualAddress == 0x1000 && section.iVirtualSize == 0x1234);
+        CHECK(section.iRawOffset == 0x400 && section.iRawSize == 0x1400);
+        CHECK(section.IsCode());
+    }
+}
+
+TEST(RejectBadMagic)
+{
+    auto data = MakeImage();
+    PE::Image image;
+    data[0] = 'X';
+    CHECK(!PE::Parse(data.data(), data.size(), image));
+
+    data = MakeImage();
+    Put<uint16_t>(data, 0x80 + 24, 0x10B); // PE32
+    CHECK(!PE::Parse(data.data(), data.size(), image));
+}
+
+TEST(RejectTruncated)
+{
+    auto data = MakeImage();
+    PE::Image image;
+    for (size_t size : { (size_t)0, (size_t)0x3E, (size_t)0x90, (size_t)0x1A0 })
+        CHECK(!PE::Parse(data.data(), size, image));
+}
+
+TEST(RejectNtOffsetOutOfRange)
+{
+    auto data = MakeImage();
+    PE::Image image;
+    Put<uint32_t>(data, 0x3C, 0xFFFFFFF0);
+    CHECK(!PE::Parse(data.data(), data.size(), image));
+}
+
+TEST_MAIN()
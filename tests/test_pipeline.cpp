@@ -0,0 +1,86 @@
+#include "Check.hpp"
+#include "Pipeline.hpp"
+
+#include <atomic>
+
+TEST(DependenciesRunFirst)
+{
+    Pipeline::Graph graph;
+    std::atomic<int> iScans = 0;
+    int iScansAtCommit = -1;
+    graph.Add("A", [&] { iScans++; });
+    graph.Add("B", [&] { iScans++; });
+    graph.Add("Commit", [&] { iScansAtCommit = iScans; }, { "A", "B" }, Pipeline::Graph::Kind::Other);
+    CHECK(graph.Run());
+
+    CHECK(iScansAtCommit == 2);
+    for (const auto& task : graph.Tasks()) {
+        CHECK(task.bDone);
+        CHECK(task.times.dEndMs >= task.times.dStartMs);
+    }
+}
+
+TEST(UnknownDependencyRefusesToRun)
+{
+    Pipeline::Graph graph;
+    bool bRan = false;
+    graph.Add("A", [&] { bRan = true; });
+    // Dependencies have to be added first, "B" comes after the task waiting on it
+    graph.Add("Commit", [&] { bRan = true; }, { "A", "B" }, Pipeline::Graph::Kind::Other);
+    graph.Add("B", [&] { bRan = true; });
+    CHECK(!graph.Run());
+    CHECK(!bRan);
+    CHECK(graph.Error().find("\"B\"") != std::string::npos);
+    for (const auto& task : graph.Tasks())
+        CHECK(!task.bDone);
+
+    Pipeline::Graph valid;
+    valid.Add("A", [] {});
+    valid.Add("B", [] {}, { "A" });
+    CHECK(valid.Run());
+    CHECK(valid.Error().empty());
+}
+
+TEST(ThreadInitSeesKind)
+{
+    Pipeline::Graph graph;
+    std::atomic<int> iScan = 0, iOther = 0;
+    graph.SetThreadInit([&](const Pipeline::Graph::Task& task) { (task.eKind == Pipeline::Graph::Kind::Scan ? iScan : iOther)++; });
+    graph.Add("Scan", [] {});
+    graph.Add("Wait", [] {}, {}, Pipeline::Graph::Kind::Other);
+    CHECK(graph.Run());
+    CHECK(iScan == 1);
+    CHECK(iOther == 1);
+}
+
+TEST(PhasesAreCountedOnce)
+{
+    Pipeline::Graph graph;
+    graph.Add("Nested", [] {
+        Pipeline::ScopedPhase outer(Pipeline::Phase::Scan);
+        Pipeline::ScopedPhase inner(Pipeline::Phase::Install);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        });
+    CHECK(graph.Run());
+    const auto& times = graph.Tasks()[0].times;
+    CHECK(times.dPhaseMs[(size_t)Pipeline::Phase::Scan] >= 1.0);
+    CHECK(times.dPhaseMs[(size_t)Pipeline::Phase::Install] == 0.0);
+}
+
+// Only one Installer per process, so deferral and commit are checked in one test
+TEST(InstallerQueuesUntilCommit)
+{
+    auto& installer = Pipeline::Installer::Get();
+    std::vector<int> applied;
+    installer.Submit([&] { applied.push_back(1); });
+    installer.Submit([&] { applied.push_back(2); });
+    CHECK(applied.empty());
+
+    CHECK(installer.Commit() == 2);
+    CHECK((applied == std::vector<int>{ 1, 2 }));
+
+    installer.Submit([&] { applied.push_back(3); });
+    CHECK(applied.size() == 3);
+}
+
+TEST_MAIN()
@@ -0,0 +1,114 @@
+#include "Check.hpp"
+#include "Ring.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(SpscOrderAndOverflow)
+{
+    SpscRing<int, 4> ring;
+    for (int i = 0; i < 4; i++)
+        CHECK(ring.Push(i));
+    CHECK(!ring.Push(4));
+    CHECK(ring.Dropped() == 1);
+
+    int item = -1;
+    for (int i = 0; i < 4; i++) {
+        CHECK(ring.Pop(item));
+        CHECK(item == i);
+    }
+    CHECK(!ring.Pop(item));
+}
+
+TEST(MpscOrderAndOverflow)
+{
+    MpscRing<int, 4> ring;
+    int item = -1;
+    for (int iLap = 0; iLap < 3; iLap++) {
+        for (int i = 0; i < 4; i++)
+            CHECK(ring.Push(iLap * 10 + i));
+        CHECK(!ring.Push(99));
+        for (int i = 0; i < 4; i++) {
+            CHECK(ring.Pop(item));
+            CHECK(item == iLap * 10 + i);
+        }
+        CHECK(!ring.Pop(item));
+    }
+    CHECK(ring.Dropped() == 3);
+}
+
+TEST(MpscManyProducers)
+{
+    constexpr int kProducers = 8;
+    constexpr int kPerProducer = 5000;
+    static MpscRing<uint32_t, 1024> ring;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; p++) {
+        producers.emplace_back([p] {
+            for (int i = 0; i < kPerProducer; i++) {
+                while (!ring.Push((uint32_t)(p << 24 | i)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    // Items from one producer have to come out in the order it pushed them
+    std::vector<int> next(kProducers, 0);
+    int iReceived = 0;
+    bool bOrdered = true;
+    uint32_t item;
+    while (iReceived < kProducers * kPerProducer) {
+        if (!ring.Pop(item))
+            continue;
+        int p = item >> 24, i = item & 0xFFFFFF;
+        bOrdered &= next[p] == i;
+        next[p] = i + 1;
+        iReceived++;
+    }
+    for (auto& producer : producers)
+        producer.join();
+
+    CHECK(bOrdered);
+    CHECK(!ring.Pop(item));
+}
+
+TEST(PoolsOfTheSameTypeKeepSeparateRings)
+{
+    using Pool = SpscRingPool<int, 8, 4>;
+    auto first = std::make_unique<Pool>();
+    auto second = std::make_unique<Pool>();
+    CHECK(first->Push(1));
+    CHECK(second->Push(2));
+    CHECK(first->Push(3));
+
+    std::vector<int> items;
+    CHECK(first->Drain([&](int item) { items.push_back(item); }) == 2);
+    CHECK(items == std::vector<int>({ 1, 3 }));
+    items.clear();
+    CHECK(second->Drain([&](int item) { items.push_back(item); }) == 1);
+    CHECK(items == std::vector<int>({ 2 }));
+
+    // A pool created where a destroyed one was doesn't inherit the thread's claim on it
+    first.reset();
+    first = std::make_unique<Pool>();
+    CHECK(first->Push(4));
+    items.clear();
+    CHECK(first->Drain([&](int item) { items.push_back(item); }) == 1);
+    CHECK(items == std::vector<int>({ 4 }));
+}
+
+TEST(PoolDropsThreadsPastTheLimit)
+{
+    static SpscRingPool<int, 8, 2> pool;
+    for (int i = 0; i < 3; i++)
+        std::thread([i] { pool.Push(i); }).join();
+
+    int iDrained = 0;
+    CHECK(pool.Drain([&](int) { iDrained++; }) == 2);
+    CHECK(iDrained == 2);
+    CHECK(pool.Dropped() == 1);
+}
+
+TEST_MAIN()
@@ -0,0 +1,205 @@
+#include "Check.hpp"
+#include "SharedState.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace
+{
+    // Zeroed like a fresh file mapping
+    std::unique_ptr<SharedState::Region> MakeRegion()
+    {
+        return std::make_unique<SharedState::Region>();
+    }
+
+    // Every entity carries the same value and the count is derived from it, so a frame copied halfway through a write
+    // doesn't add up
+    uint32_t FillFrame(SharedState::Entity* entities, uint32_t iMax, uint32_t iValue)
+    {
+        uint32_t iCount = iValue % 50 + 1;
+        for (uint32_t i = 0; i < iCount && i < iMax; i++)
+            entities[i] = { iValue, i, iValue, iValue, 0, 0.0f, 0, 0, {} };
+        return iCount;
+    }
+
+    bool IsConsistent(const SharedState::Frame& frame)
+    {
+        if (frame.iCount == 0)
+            return false;
+        uint32_t iValue = frame.entities[0].iHealth;
+        if (frame.iCount != iValue % 50 + 1)
+            return false;
+        for (uint32_t i = 0; i < frame.iCount; i++) {
+            const auto& entity = frame.entities[i];
+            if (entity.iHealth != iValue || entity.iWill != iValue || entity.iTableIndex != iValue || entity.iId != i)
+                return false;
+        }
+        return true;
+    }
+}
+
+TEST(OpenNeedsMagicAndLayout)
+{
+    auto region = MakeRegion();
+    SharedState::Reader reader;
+    CHECK(!reader.Open(region.get(), sizeof(SharedState::Region)));
+
+    SharedState::Writer writer;
+    writer.Open(region.get(), 10000000);
+    CHECK(reader.Open(region.get(), sizeof(SharedState::Region)));
+    CHECK(!reader.Open(region.get(), sizeof(SharedState::Region) - 1));
+
+    region->header.iVersion = SharedState::kVersion + 1;
+    CHECK(!reader.Open(region.get(), sizeof(SharedState::Region)));
+    SharedState::Frame frame;
+    CHECK(!reader.ReadLatestFrame(frame));
+}
+
+TEST(DisplayRoundTrip)
+{
+    auto region = MakeRegion();
+    SharedState::Writer writer;
+    writer.Open(region.get(), 10000000);
+    SharedState::Reader reader;
+    CHECK(reader.Open(region.get(), sizeof(SharedState::Region)));
+
+    SharedState::Display display{};
+    display.iResX = 3440;
+    display.iResY = 1440;
+    display.fAspectRatio = 3440.0f / 1440.0f;
+    display.iFlags = SharedState::UncapFPS;
+    CHECK(writer.PublishDisplay(display));
+
+    SharedState::Display out{};
+    CHECK(reader.ReadDisplay(out));
+    CHECK(out.iResX == 3440 && out.iResY == 1440);
+    CHECK(out.iFlags == SharedState::UncapFPS);
+    CHECK(region->header.iDisplaySequence == 2);
+}
+
+TEST(FramesWrapAround)
+{
+    auto region = MakeRegion();
+    SharedState::Writer writer;
+    writer.Open(region.get(), 10000000);
+    SharedState::Reader reader;
+    CHECK(reader.Open(region.get(), sizeof(SharedState::Region)));
+
+    SharedState::Frame frame;
+    CHECK(reader.LatestFrame() == 0);
+    CHECK(!reader.ReadLatestFrame(frame));
+
+    for (uint32_t i = 1; i <= 10; i++)
+        CHECK(writer.PublishFrame(i * 100, [&](SharedState::Entity* entities, uint32_t iMax) { return FillFrame(entities, iMax, i); }));
+
+    CHECK(reader.LatestFrame() == 10);
+    CHECK(reader.ReadLatestFrame(frame));
+    CHECK(frame.iFrame == 10 && frame.iTimestamp == 1000 && IsConsistent(frame));
+
+    // Frames 3 to 10 are still in the ring, 2 was overwritten by 10
+    CHECK(reader.ReadFrame(3, frame) && frame.iFrame == 3);
+    CHECK(!reader.ReadFrame(2, frame));
+    CHECK(!reader.ReadFrame(0, frame));
+    CHECK(!reader.ReadFrame(11, frame));
+}
+
+TEST(FrameCountIsClamped)
+{
+    auto region = MakeRegion();
+    SharedState::Writer writer;
+    writer.Open(region.get(), 10000000);
+    SharedState::Reader reader;
+    CHECK(reader.Open(region.get(), sizeof(SharedState::Region)));
+
+    CHECK(writer.PublishFrame(1, [](SharedState::Entity*, uint32_t iMax) { return iMax + 100; }));
+    SharedState::Frame frame;
+    CHECK(reader.ReadLatestFrame(frame));
+    CHECK(frame.iCount == SharedState::kMaxEntities);
+}
+
+TEST(TornFrameIsRejected)
+{
+    auto region = MakeRegion();
+    SharedState::Writer writer;
+    writer.Open(region.get(), 10000000);
+    SharedState::Reader reader;
+    CHECK(reader.Open(region.get(), sizeof(SharedState::Region)));
+    CHECK(writer.PublishFrame(1, [](SharedState::Entity* entities, uint32_t iMax) { return FillFrame(entities, iMax, 7); }));
+
+    // An odd sequence is a writer in the middle of the block
+    SharedState::Frame frame;
+    uint32_t& iSequence = region->frames[1].iSequence;
+    iSequence++;
+    CHECK(!reader.ReadFrame(1, frame));
+    iSequence++;
+    CHECK(reader.ReadFrame(1, frame) && IsConsistent(frame));
+}
+
+TEST(SecondWriterIsDropped)
+{
+    auto region = MakeRegion();
+    SharedState::Writer writer;
+    writer.Open(region.get(), 10000000);
+
+    bool bNested = true;
+    CHECK(writer.PublishFrame(1, [&](SharedState::Entity* entities, uint32_t iMax) {
+        bNested = writer.PublishFrame(2, [&](SharedState::Entity* nested, uint32_t iNestedMax) { return FillFrame(nested, iNestedMax, 9); });
+        return FillFrame(entities, iMax, 3);
+        }));
+    CHECK(!bNested);
+
+    // The dropped publish didn't use up a frame number
+    CHECK(writer.PublishFrame(3, [](SharedState::Entity* entities, uint32_t iMax) { return FillFrame(entities, iMax, 4); }));
+    CHECK(region->header.iLatestFrame == 2);
+    CHECK(region->frames[1].entities[0].iHealth == 3 && region->frames[2].entities[0].iHealth == 4);
+}
+
+// Two writers race to publish, like the game's object table workers, while a reader copies the newest frame
+TEST(ConcurrentWritersAndReader)
+{
+    constexpr uint32_t kPublishes = 20000;
+    auto region = MakeRegion();
+    SharedState::Writer writer;
+    writer.Open(region.get(), 10000000);
+
+    std::atomic<int> iWritersDone = 0;
+    std::atomic<uint64_t> iPublished = 0;
+    auto write = [&](uint32_t iSeed) {
+        for (uint32_t i = 0; i < kPublishes; i++) {
+            uint32_t iValue = iSeed + i;
+            if (writer.PublishFrame(i, [&](SharedState::Entity* entities, uint32_t iMax) { return FillFrame(entities, iMax, iValue); }))
+                iPublished.fetch_add(1, std::memory_order_relaxed);
+        }
+        iWritersDone.fetch_add(1, std::memory_order_release);
+    };
+    std::thread first(write, 0u);
+    std::thread second(write, 1000000u);
+
+    SharedState::Reader reader;
+    while (!reader.Open(region.get(), sizeof(SharedState::Region)))
+        std::this_thread::yield();
+
+    auto frame = std::make_unique<SharedState::Frame>();
+    uint64_t iLast = 0;
+    bool bConsistent = true;
+    bool bOrdered = true;
+    while (iWritersDone.load(std::memory_order_acquire) < 2) {
+        uint64_t iLatest = reader.LatestFrame();
+        if (!reader.ReadFrame(iLatest, *frame))
+            continue;
+        bConsistent &= IsConsistent(*frame) && frame->iFrame == iLatest;
+        bOrdered &= frame->iFrame >= iLast;
+        iLast = frame->iFrame;
+    }
+    first.join();
+    second.join();
+
+    CHECK(bConsistent);
+    CHECK(bOrdered);
+    CHECK(iPublished.load() > 0);
+    CHECK(reader.LatestFrame() == iPublished.load());
+    CHECK(reader.ReadLatestFrame(*frame) && IsConsistent(*frame));
+}
+
+TEST_MAIN()
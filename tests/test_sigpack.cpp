@@ -0,0 +1,153 @@
+#include "Check.hpp"
+#include "SigPack.hpp"
+
+#include <vector>
+
+namespace
+{
+    struct SourceEntry
+    {
+        SigPack::Entry entry;
+        std::vector<uint8_t> bytes; // Pattern bytes then mask bytes
+    };
+
+    // Lays a pack out the way tools/sigpack does, in whatever order it's given
+    std::vector<uint8_t> BuildPack(std::vector<SourceEntry> entries, const std::vector<SigPack::Hint>& hints)
+    {
+        std::vector<uint8_t> bytes;
+        for (auto& source : entries) {
+            source.entry.bytesOffset = (uint32_t)bytes.size();
+            bytes.insert(bytes.end(), source.bytes.begin(), source.bytes.end());
+        }
+
+        SigPack::Header header{};
+        header.magic = SigPack::kMagic;
+        header.version = SigPack::kVersion;
+        header.entryCount = (uint32_t)entries.size();
+        header.hintCount = (uint32_t)hints.size();
+        header.byteCount = (uint32_t)bytes.size();
+        header.entriesOffset = sizeof(SigPack::Header);
+        header.hintsOffset = header.entriesOffset + header.entryCount * sizeof(SigPack::Entry);
+        header.bytesOffset = header.hintsOffset + header.hintCount * sizeof(SigPack::Hint);
+
+        std::vector<uint8_t> pack(header.bytesOffset + bytes.size());
+        memcpy(pack.data(), &header, sizeof(header));
+        for (size_t i = 0; i < entries.size(); i++)
+            memcpy(pack.data() + header.entriesOffset + i * sizeof(SigPack::Entry), &entries[i].entry, sizeof(SigPack::Entry));
+        if (!hints.empty())
+            memcpy(pack.data() + header.hintsOffset, hints.data(), hints.size() * sizeof(SigPack::Hint));
+        if (!bytes.empty())
+            memcpy(pack.data() + header.bytesOffset, bytes.data(), bytes.size());
+        return pack;
+    }
+
+    // "48 8B ?? 05" with the anchor on 05
+    SourceEntry MakeEntry(uint64_t key, bool bPrimary, int32_t adjust = 0)
+    {
+        SourceEntry source{};
+        source.entry.key = key;
+        source.entry.length = 4;
+        source.entry.anchorOffset = 3;
+        source.entry.anchorByte = 0x05;
+        source.entry.flags = bPrimary ? SigPack::Primary : 0;
+        source.entry.adjust = adjust;
+        source.bytes = { 0x48, 0x8B, 0x00, 0x05, 0xFF, 0xFF, 0x00, 0xFF };
+        return source;
+    }
+
+    SigPack::Hint MakeHint(uint32_t timestamp, uint64_t key, uint32_t entryIndex)
+    {
+        return { key, timestamp, 0x1000, entryIndex, 0 };
+    }
+
+    bool Opens(const std::vector<uint8_t>& pack)
+    {
+        SigPack::View view;
+        return view.Open(pack.data(), pack.size());
+    }
+}
+
+TEST(KeyIgnoresFormatting)
+{
+    CHECK(SigPack::Normalise("48 8b ? ??  05") == "48 8B ?? ?? 05");
+    CHECK(SigPack::Key("48 8b ?? 05") == SigPack::Key("48  8B ? 05"));
+    CHECK(SigPack::Key("48 8B ?? 05") != SigPack::Key("48 8B ?? 06"));
+}
+
+TEST(OpenAndLookUp)
+{
+    auto pack = BuildPack({ MakeEntry(1, true), MakeEntry(2, true), MakeEntry(2, false, -4), MakeEntry(3, true) },
+        { MakeHint(100, 2, 2), MakeHint(100, 3, 3), MakeHint(200, 1, 0) });
+    SigPack::View view;
+    CHECK(view.Open(pack.data(), pack.size()));
+
+    auto [begin, end] = view.Find(2);
+    CHECK(end - begin == 2);
+    CHECK((begin->flags & SigPack::Primary) && begin[1].adjust == -4);
+    CHECK(view.Find(4).first == view.Find(4).second);
+
+    const SigPack::Hint* hint = view.FindHint(100, 3);
+    CHECK(hint && hint->entryIndex == 3);
+    CHECK(view.FindHint(200, 1) != nullptr);
+    CHECK(view.FindHint(200, 2) == nullptr);
+    CHECK(view.FindHint(150, 1) == nullptr);
+}
+
+TEST(RejectUnsortedEntries)
+{
+    CHECK(!Opens(BuildPack({ MakeEntry(2, true), MakeEntry(1, true) }, {})));
+
+    // An alternate ahead of its primary
+    CHECK(!Opens(BuildPack({ MakeEntry(1, false), MakeEntry(1, true) }, {})));
+    CHECK(Opens(BuildPack({ MakeEntry(1, true), MakeEntry(1, false) }, {})));
+}
+
+TEST(RejectUnsortedHints)
+{
+    std::vector<SourceEntry> entries = { MakeEntry(1, true), MakeEntry(2, true) };
+    CHECK(Opens(BuildPack(entries, { MakeHint(100, 1, 0), MakeHint(100, 2, 1) })));
+    CHECK(!Opens(BuildPack(entries, { MakeHint(100, 2, 1), MakeHint(100, 1, 0) })));
+    CHECK(!Opens(BuildPack(entries, { MakeHint(200, 1, 0), MakeHint(100, 2, 1) })));
+    CHECK(!Opens(BuildPack(entries, { MakeHint(100, 1, 0), MakeHint(100, 1, 0) })));
+
+    // Pointing at another signature's entry
+    CHECK(!Opens(BuildPack(entries, { MakeHint(100, 1, 1) })));
+}
+
+TEST(RejectBadAnchor)
+{
+    auto wildcard = MakeEntry(1, true);
+    wildcard.entry.anchorOffset = 2;
+    wildcard.entry.anchorByte = 0x00;
+    CHECK(!Opens(BuildPack({ wildcard }, {})));
+
+    auto wrongByte = MakeEntry(1, true);
+    wrongByte.entry.anchorByte = 0x48;
+    CHECK(!Opens(BuildPack({ wrongByte }, {})));
+
+    auto outside = MakeEntry(1, true);
+    outside.entry.anchorOffset = 4;
+    CHECK(!Opens(BuildPack({ outside }, {})));
+}
+
+TEST(ScanAndMatch)
+{
+    auto pack = BuildPack({ MakeEntry(1, true) }, {});
+    SigPack::View view;
+    CHECK(view.Open(pack.data(), pack.size()));
+    const SigPack::Entry& entry = view.Entries()[0];
+
+    std::vector<uint8_t> data(256, 0x05);
+    data[200] = 0x48;
+    data[201] = 0x8B;
+    data[202] = 0x77;
+    data[203] = 0x05;
+    CHECK(view.Scan(entry, data.data(), data.size()) == data.data() + 200);
+    CHECK(view.Matches(entry, data.data() + 200));
+    CHECK(!view.Matches(entry, data.data() + 199));
+
+    data[203] = 0x06;
+    CHECK(view.Scan(entry, data.data(), data.size()) == nullptr);
+}
+
+TEST_MAIN()
@@ -0,0 +1,140 @@
+#include "Check.hpp"
+#include "ThreadPolicy.hpp"
+
+using namespace ThreadPolicy;
+
+namespace
+{
+    // 8 P-cores with SMT (logical 0-15) and 8 E-cores (16-23), one L3
+    Topology Hybrid()
+    {
+        Topology topology;
+        for (uint8_t i = 0; i < 16; i++)
+            topology.vProcessors.push_back({ 0, i, (uint32_t)(i / 2), 1, 0, i % 2 == 0 });
+        for (uint8_t i = 16; i < 24; i++)
+            topology.vProcessors.push_back({ 0, i, (uint32_t)(8 + i - 16), 0, 0, true });
+        return topology;
+    }
+
+    // 16 cores with SMT over two L3 domains (logical 0-15 on L3 0, 16-31 on L3 1)
+    Topology TwoCcd()
+    {
+        Topology topology;
+        for (uint8_t i = 0; i < 32; i++)
+            topology.vProcessors.push_back({ 0, i, (uint32_t)(i / 2), 0, (uint32_t)(i / 16), i % 2 == 0 });
+        return topology;
+    }
+
+    // 96 logical processors, split into processor groups of 64 and 32
+    Topology TwoGroups()
+    {
+        Topology topology;
+        for (uint32_t i = 0; i < 96; i++)
+            topology.vProcessors.push_back({ (uint16_t)(i / 64), (uint8_t)(i % 64), i, 0, 0, true });
+        return topology;
+    }
+
+    Rule Parsed(const char* key, const char* value)
+    {
+        Rule rule;
+        CHECK(ParseRule(key, value, rule));
+        return rule;
+    }
+}
+
+TEST(GlobMatching)
+{
+    CHECK(GlobMatch("*render*", "MainRenderThread"));
+    CHECK(GlobMatch("RENDER?", "render1"));
+    CHECK(GlobMatch("*", ""));
+    CHECK(GlobMatch("a*b*c", "aXXbYYc"));
+    CHECK(!GlobMatch("a*b*c", "aXXbYY"));
+    CHECK(!GlobMatch("render", "render1"));
+}
+
+TEST(ParseRules)
+{
+    Rule rule;
+    CHECK(ParseRule("fix", "efficiency, below_normal", rule));
+    CHECK(rule.eKind == MatchKind::Fix && rule.action.eCores == CoreSet::Efficiency && rule.action.iPriority == kPriorityBelowNormal);
+
+    CHECK(ParseRule(" Name: *Render* ", "performance-nosmt", rule));
+    CHECK(rule.eKind == MatchKind::Name && rule.sPattern == "*Render*" && rule.action.eCores == CoreSet::PerformanceNoSmt);
+    CHECK(!rule.action.iPriority);
+
+    CHECK(ParseRule("module:jxl_threads.dll", "L3:1, idle", rule));
+    CHECK(rule.eKind == MatchKind::Module && rule.action.eCores == CoreSet::L3 && rule.action.iL3 == 1 && rule.action.iPriority == kPriorityIdle);
+}
+
+TEST(RejectBadRules)
+{
+    Rule rule;
+    CHECK(!ParseRule("thread", "all", rule));
+    CHECK(!ParseRule("name:", "all", rule));
+    CHECK(!ParseRule("fix", "fast", rule));
+    CHECK(!ParseRule("fix", "l3:", rule));
+    CHECK(!ParseRule("fix", "l3:x", rule));
+    CHECK(!ParseRule("fix", "all, urgent", rule));
+}
+
+TEST(MatchOrder)
+{
+    std::vector<Rule> rules = { Parsed("module:*", "all"), Parsed("name:*", "all"), Parsed("name:*render*", "all"), Parsed("jxl", "all"), Parsed("fix", "all") };
+    CHECK(Match(rules, { "MainRenderThread", "game.exe", false, false }) == &rules[2]); // Longest name pattern
+    CHECK(Match(rules, { "", "game.exe", false, false }) == &rules[0]);                // Unnamed, falls through to module
+    CHECK(Match(rules, { "Worker", "", false, true }) == &rules[3]);                   // JXL before name
+    CHECK(Match(rules, { "Worker", "", true, true }) == &rules[4]);                    // Fix before everything
+    CHECK(Match({}, { "Worker", "game.exe", false, false }) == nullptr);
+}
+
+TEST(EvaluateHybrid)
+{
+    auto topology = Hybrid();
+    CHECK(topology.IsHybrid());
+
+    auto decision = Evaluate(topology, { Parsed("name:render", "performance, highest") }, { "render", "", false, false });
+    CHECK(decision.bAffinity && decision.iGroup == 0 && decision.iMask == 0xFFFF);
+    CHECK(decision.bPriority && decision.iPriority == kPriorityHighest);
+
+    decision = Evaluate(topology, { Parsed("name:render", "performance-nosmt") }, { "render", "", false, false });
+    CHECK(decision.iMask == 0x5555);
+    CHECK(!decision.bPriority);
+
+    decision = Evaluate(topology, { Parsed("jxl", "efficiency, lowest") }, { "", "", false, true });
+    CHECK(decision.bAffinity && decision.iMask == 0xFF0000);
+    CHECK(decision.iPriority == kPriorityLowest);
+}
+
+TEST(EvaluateNonHybrid)
+{
+    auto topology = TwoCcd();
+    CHECK(!topology.IsHybrid());
+
+    // Efficiency means nothing without E-cores, affinity is left alone
+    auto decision = Evaluate(topology, { Parsed("fix", "efficiency, below_normal") }, { "", "", true, false });
+    CHECK(!decision.bAffinity);
+    CHECK(decision.bPriority);
+
+    decision = Evaluate(topology, { Parsed("name:*", "l3:1") }, { "x", "", false, false });
+    CHECK(decision.bAffinity && decision.iMask == 0xFFFF0000ull);
+
+    decision = Evaluate(topology, { Parsed("name:*", "l3:5") }, { "x", "", false, false });
+    CHECK(!decision.bAffinity);
+
+    decision = Evaluate(topology, { Parsed("name:*", "keep, normal") }, { "x", "", false, false });
+    CHECK(!decision.bAffinity && decision.bPriority);
+}
+
+TEST(EvaluateProcessorGroups)
+{
+    auto decision = Evaluate(TwoGroups(), { Parsed("name:*", "all") }, { "x", "", false, false });
+    CHECK(decision.bAffinity && decision.iGroup == 0 && decision.iMask == ~0ull);
+}
+
+TEST(EvaluateNoRule)
+{
+    auto decision = Evaluate(Hybrid(), { Parsed("name:render", "performance") }, { "audio", "", false, false });
+    CHECK(decision.pRule == nullptr && !decision.bAffinity && !decision.bPriority);
+}
+
+TEST_MAIN()
@@ -0,0 +1,158 @@
+#include "Check.hpp"
+#include "TraceZones.hpp"
+
+#include <thread>
+
+namespace
+{
+    uint32_t TestThreadId()
+    {
+        static std::atomic<uint32_t> iNext = 100;
+        thread_local uint32_t iId = iNext++;
+        return iId;
+    }
+
+    std::string TestThreadName(uint32_t iThreadId)
+    {
+        return "Worker " + std::to_string(iThreadId);
+    }
+
+    void EnableAll()
+    {
+        Trace::Enable(Trace::Startup | Trace::Scan | Trace::Install | Trace::Hooks, std::chrono::steady_clock::now(), TestThreadId, TestThreadName);
+    }
+
+    size_t CountOf(const std::string& text, const std::string& part)
+    {
+        size_t iCount = 0;
+        for (size_t i = text.find(part); i != std::string::npos; i = text.find(part, i + 1))
+            iCount++;
+        return iCount;
+    }
+
+    // Each test records on a thread of its own, so it gets a buffer of its own
+    template<typename F>
+    uint32_t OnThread(F fn)
+    {
+        uint32_t iId = 0;
+        std::thread([&] { fn(); iId = TestThreadId(); }).join();
+        return iId;
+    }
+}
+
+TEST(ParseCategories)
+{
+    CHECK(Trace::ParseCategories("startup, scan, install, hooks") == (Trace::Startup | Trace::Scan | Trace::Install | Trace::Hooks));
+    CHECK(Trace::ParseCategories(" hooks ,\tscan") == (Trace::Hooks | Trace::Scan));
+    CHECK(Trace::ParseCategories("hooks, frames") == Trace::Hooks);
+    CHECK(Trace::ParseCategories("") == 0);
+}
+
+TEST(NothingRecordedUntilEnabled)
+{
+    uint32_t iId = OnThread([] { Trace::Zone zone(Trace::Hooks, "Before Enable"); });
+    CHECK(iId != 0);
+    CHECK(Trace::Global.iClaimed.load() == 0);
+    CHECK(Trace::Global.iUnrecorded.load() == 0);
+}
+
+TEST(ZonesAndThreadNames)
+{
+    EnableAll();
+    uint32_t iId = OnThread([] {
+        Trace::Zone zone(Trace::Scan, "Scan \"quoted\"", 0x1234);
+        Trace::Record({ "Startup task", Trace::Startup, 10, 20, 0 });
+    });
+
+    std::string sJson;
+    Trace::ExportJson(sJson);
+    CHECK(sJson.find("\"name\":\"Worker " + std::to_string(iId) + "\"") != std::string::npos);
+    CHECK(sJson.find("Scan \\\"quoted\\\"") != std::string::npos);
+    CHECK(sJson.find("\"address\":\"1234\"") != std::string::npos);
+    CHECK(sJson.find("\"name\":\"Startup task\",\"cat\":\"startup\"") != std::string::npos);
+    CHECK(sJson.find("\"ts\":0.010,\"dur\":0.020") != std::string::npos);
+}
+
+TEST(RegisteredThreadKeepsItsName)
+{
+    EnableAll();
+    size_t iBefore = Trace::Global.iClaimed.load();
+    OnThread([] {
+        Trace::RegisterThread();
+        Trace::Global.fnThreadName = [](uint32_t) { return std::string("Renamed"); };
+        Trace::Record({ "Registered", Trace::Startup, 0, 1, 0 });
+    });
+    Trace::Global.fnThreadName = TestThreadName;
+    CHECK(Trace::Global.iClaimed.load() == iBefore + 1);
+
+    std::string sJson;
+    Trace::ExportJson(sJson);
+    CHECK(sJson.find("Renamed") == std::string::npos);
+}
+
+TEST(RingKeepsNewestZones)
+{
+    EnableAll();
+    constexpr size_t kRecorded = Trace::kEventsPerThread * 2 + 10;
+    uint64_t iLostBefore = 0;
+    std::string sJson;
+    Trace::ExportJson(sJson, &iLostBefore);
+
+    OnThread([] {
+        for (size_t i = 0; i < kRecorded; i++)
+            Trace::Record({ "Ring", Trace::Hooks, (int64_t)i * 1000, 1000, 0 });
+    });
+
+    uint64_t iLost = 0;
+    Trace::ExportJson(sJson, &iLost);
+    // The slot the owner writes next is left out, it could be half written
+    constexpr size_t kKept = Trace::kEventsPerThread - 1;
+    CHECK(CountOf(sJson, "\"name\":\"Ring\"") == kKept);
+    CHECK(iLost - iLostBefore == kRecorded - kKept);
+
+    // Zone i was recorded at i microseconds
+    std::string sOldest = "\"ts\":" + std::to_string(kRecorded - kKept) + ".000";
+    std::string sDropped = "\"ts\":" + std::to_string(kRecorded - kKept - 1) + ".000";
+    CHECK(sJson.find(sOldest) != std::string::npos);
+    CHECK(sJson.find(sDropped) == std::string::npos);
+}
+
+TEST(ExportWhileRecording)
+{
+    EnableAll();
+    std::atomic<bool> bStop = false;
+    std::thread recorder([&] {
+        while (!bStop.load(std::memory_order_relaxed))
+            Trace::Record({ "Busy", Trace::Hooks, 1, 1, 0 });
+    });
+
+    bool bBounded = true;
+    for (int i = 0; i < 20; i++) {
+        std::string sJson;
+        Trace::ExportJson(sJson);
+        bBounded &= CountOf(sJson, "\"name\":\"Busy\"") <= Trace::kEventsPerThread;
+    }
+    bStop = true;
+    recorder.join();
+    CHECK(bBounded);
+}
+
+TEST(ThreadsPastTheLimitAreCounted)
+{
+    EnableAll();
+    while (Trace::Global.iClaimed.load() < Trace::kMaxThreads)
+        OnThread([] { Trace::RegisterThread(); });
+
+    uint64_t iBefore = Trace::Global.iUnrecorded.load();
+    OnThread([] {
+        Trace::Record({ "Unrecorded", Trace::Hooks, 0, 1, 0 });
+        Trace::Record({ "Unrecorded", Trace::Hooks, 0, 1, 0 });
+    });
+    CHECK(Trace::Global.iUnrecorded.load() == iBefore + 2);
+
+    std::string sJson;
+    Trace::ExportJson(sJson);
+    CHECK(sJson.find("Unrecorded") == std::string::npos);
+}
+
+TEST_MAIN()
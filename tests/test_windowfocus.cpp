@@ -0,0 +1,125 @@
+#include "Check.hpp"
+#include "WindowFocus.hpp"
+
+#include <vector>
+
+namespace
+{
+    using Focus::Action;
+    using Focus::Event;
+
+    struct Step
+    {
+        Event event;
+        Action expected;
+        bool bActive;
+        bool bForeground;
+    };
+
+    // Feeds the events in order and checks the action and state after each one
+    void Run(Focus::StateMachine& state, const std::vector<Step>& steps)
+    {
+        for (const auto& step : steps) {
+            CHECK(state.OnEvent(step.event) == step.expected);
+            CHECK(state.IsActive() == step.bActive);
+            CHECK(state.IsForeground() == step.bForeground);
+        }
+    }
+}
+
+TEST(StartsInactive)
+{
+    Focus::StateMachine state;
+    CHECK(!state.IsActive());
+    CHECK(!state.IsForeground());
+}
+
+TEST(AltTabOutAndBack)
+{
+    Focus::StateMachine state;
+    Run(state, {
+        { Event::Foreground, Action::Activate, true, true },
+        { Event::Background, Action::Deactivate, false, false },
+        { Event::Foreground, Action::Activate, true, true },
+    });
+}
+
+TEST(RepeatedEventsAreIgnored)
+{
+    // Several focus messages arrive for one change (WM_ACTIVATE, WM_NCACTIVATE, WM_SETFOCUS, the wake-up message)
+    Focus::StateMachine state;
+    Run(state, {
+        { Event::Foreground, Action::Activate, true, true },
+        { Event::Foreground, Action::None, true, true },
+        { Event::Foreground, Action::None, true, true },
+        { Event::Background, Action::Deactivate, false, false },
+        { Event::Background, Action::None, false, false },
+    });
+}
+
+TEST(StartsInBackground)
+{
+    // The game was never told it's active, so there's nothing to take back
+    Focus::StateMachine state;
+    Run(state, {
+        { Event::Background, Action::None, false, false },
+        { Event::Foreground, Action::Activate, true, true },
+    });
+}
+
+TEST(BackgroundAudioStaysActive)
+{
+    Focus::StateMachine state;
+    state.SetKeepActiveInBackground(true);
+    Run(state, {
+        { Event::Foreground, Action::Activate, true, true },
+        { Event::Background, Action::None, true, false },
+        { Event::Background, Action::None, true, false },
+        { Event::Foreground, Action::None, true, true },
+    });
+}
+
+TEST(BackgroundAudioTurnedOff)
+{
+    // Switching the option while in the background takes effect on the next event
+    Focus::StateMachine state;
+    state.SetKeepActiveInBackground(true);
+    Run(state, {
+        { Event::Foreground, Action::Activate, true, true },
+        { Event::Background, Action::None, true, false },
+    });
+    state.SetKeepActiveInBackground(false);
+    Run(state, {
+        { Event::Background, Action::Deactivate, false, false },
+        { Event::Foreground, Action::Activate, true, true },
+    });
+}
+
+TEST(FocusMessages)
+{
+    CHECK(Focus::IsFocusMessage(Focus::Message::Activate, 0xC123));
+    CHECK(Focus::IsFocusMessage(Focus::Message::KillFocus, 0xC123));
+    CHECK(Focus::IsFocusMessage(0xC123, 0xC123));
+    CHECK(!Focus::IsFocusMessage(0x0113, 0xC123)); // WM_TIMER
+
+    // Wake-up message that failed to register
+    CHECK(!Focus::IsFocusMessage(0x0000, 0));
+}
+
+TEST(CheckedWindowsOnce)
+{
+    Focus::CheckedWindows checked;
+    auto window = (const void*)0x20F0E;
+    CHECK(checked.CheckOnce(window));
+    CHECK(!checked.CheckOnce(window));
+    CHECK(!checked.CheckOnce(window));
+
+    // Handles 32 slots apart share a slot, the newer one takes it
+    auto first = (const void*)0x10000;
+    auto second = (const void*)(0x10000 + 32 * 16);
+    CHECK(checked.CheckOnce(first));
+    CHECK(checked.CheckOnce(second));
+    CHECK(checked.CheckOnce(first));
+}
+
+TEST_MAIN()
@@ -0,0 +1,146 @@
+// combatlog - summarises a combat log recorded by the fix (see src/CombatLog.hpp).
+//
+// Build: g++ -std=c++20 -O2 -o combatlog combatlog.cpp
+// Usage: combatlog <FFXVIFix_combat.fxcl> [bucket seconds]
+//
+// Prints:
+//   - health damage per bucket (default 1 second) and the DPS over it
+//   - stagger uptime per entity, from the stagger timers as they were set
+//   - will breaks, a will change that empties the bar or refills it (the bar resets when a half breaks)
+
+#include "../../src/CombatLog.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <vector>
+
+namespace
+{
+    struct Entity
+    {
+        uint64_t tableIndex = 0;
+        uint64_t healthDamage = 0;
+        std::vector<std::pair<double, double>> staggers; // [start, end) seconds
+        size_t willBreaks = 0;
+    };
+
+    double MergedLength(std::vector<std::pair<double, double>> intervals)
+    {
+        std::sort(intervals.begin(), intervals.end());
+        double total = 0.0, start = 0.0, end = -1.0;
+        for (const auto& [s, e] : intervals) {
+            if (s > end) {
+                if (end > start)
+                    total += end - start;
+                start = s;
+                end = e;
+            }
+            else {
+                end = std::max(end, e);
+            }
+        }
+        if (end > start)
+            total += end - start;
+        return total;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s <combat log> [bucket seconds]\n", argv[0]);
+        return 1;
+    }
+
+    double bucketSeconds = argc == 3 ? atof(argv[2]) : 1.0;
+    if (bucketSeconds <= 0.0) {
+        fprintf(stderr, "error: invalid bucket size\n");
+        return 1;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input) {
+        fprintf(stderr, "error: could not open %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    CombatLog::Decoder decoder(data.data(), data.size());
+    CombatLog::FileHeader header;
+    if (!decoder.Header(header)) {
+        fprintf(stderr, "error: %s is not a combat log\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<CombatLog::Event> events;
+    CombatLog::Event event;
+    while (decoder.Next(event))
+        events.push_back(event);
+
+    if (events.empty()) {
+        printf("No events.\n");
+        return 0;
+    }
+
+    // Events from different game threads are interleaved
+    std::stable_sort(events.begin(), events.end(), [](const auto& a, const auto& b) { return a.timestamp < b.timestamp; });
+    const uint64_t origin = events.front().timestamp;
+    auto Seconds = [&](uint64_t timestamp) { return (double)(timestamp - origin) / (double)header.ticksPerSecond; };
+    const double duration = Seconds(events.back().timestamp);
+
+    std::map<uint64_t, Entity> entities;
+    std::vector<uint64_t> buckets((size_t)(duration / bucketSeconds) + 1);
+    std::vector<std::pair<double, uint64_t>> willBreaks;
+
+    for (const auto& e : events) {
+        Entity& entity = entities[e.combat];
+        if (e.tableIndex)
+            entity.tableIndex = e.tableIndex;
+
+        double t = Seconds(e.timestamp);
+        switch (e.kind) {
+        case CombatLog::Kind::Health:
+            if (e.before > e.after) {
+                buckets[(size_t)(t / bucketSeconds)] += e.before - e.after;
+                entity.healthDamage += e.before - e.after;
+            }
+            break;
+        case CombatLog::Kind::Will:
+            if (e.before != 0 && (e.after == 0 || e.after > e.before)) {
+                entity.willBreaks++;
+                willBreaks.emplace_back(t, e.combat);
+            }
+            break;
+        case CombatLog::Kind::Stagger:
+            if (e.timer > 0.0f)
+                entity.staggers.emplace_back(t, t + e.timer);
+            break;
+        }
+    }
+
+    printf("%zu events over %.2fs, %zu entities\n\n", events.size(), duration, entities.size());
+
+    printf("Damage timeline (%.2fs buckets)\n", bucketSeconds);
+    for (size_t i = 0; i < buckets.size(); i++) {
+        if (buckets[i])
+            printf("  %8.2fs  %10llu  %10.1f dps\n", i * bucketSeconds, (unsigned long long)buckets[i], buckets[i] / bucketSeconds);
+    }
+
+    printf("\nEntities\n");
+    printf("  %-18s  %-18s  %10s  %10s  %8s  %6s\n", "combat", "class", "damage", "staggered", "uptime", "breaks");
+    for (const auto& [combat, entity] : entities) {
+        double staggered = MergedLength(entity.staggers);
+        printf("  %#018llx  %#018llx  %10llu  %9.2fs  %7.1f%%  %6zu\n", (unsigned long long)combat, (unsigned long long)entity.tableIndex,
+            (unsigned long long)entity.healthDamage, staggered, duration > 0.0 ? 100.0 * std::min(staggered, duration) / duration : 0.0, entity.willBreaks);
+    }
+
+    printf("\nWill breaks\n");
+    for (const auto& [t, combat] : willBreaks)
+        printf("  %8.2fs  %#018llx\n", t, (unsigned long long)combat);
+
+    return 0;
+}
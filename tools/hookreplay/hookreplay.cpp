@@ -0,0 +1,148 @@
+// hookreplay - replays a hook trace recorded by the fix (see src/HookTrace.hpp) through the same callbacks the fix
+// uses (src/HookLogic.hpp), to check a change to one of them still does what it did in game and to time it.
+//
+// Build: g++ -std=c++23 -O2 -I../../external/safetyhook -o hookreplay hookreplay.cpp
+// Usage: hookreplay <FFXVIFix_hooks.fxht> [timing passes]
+//
+// Prints, per hook:
+//   - how many recorded calls came out different (registers or memory), and what differed for the first few
+//   - nanoseconds per call over all of its recorded calls, including putting the recorded inputs back each time
+
+#include "../../src/HookTrace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+    struct Replayable
+    {
+        HookTrace::Call call;
+        size_t iParams; // Index into the params seen so far
+    };
+
+    constexpr size_t kMaxReported = 5;
+
+    struct RegisterName
+    {
+        const char* sName;
+        size_t iOffset;
+    };
+
+    constexpr RegisterName kRegisters[] = {
+        { "rflags", offsetof(SafetyHookContext, rflags) }, { "r15", offsetof(SafetyHookContext, r15) }, { "r14", offsetof(SafetyHookContext, r14) },
+        { "r13", offsetof(SafetyHookContext, r13) }, { "r12", offsetof(SafetyHookContext, r12) }, { "r11", offsetof(SafetyHookContext, r11) },
+        { "r10", offsetof(SafetyHookContext, r10) }, { "r9", offsetof(SafetyHookContext, r9) }, { "r8", offsetof(SafetyHookContext, r8) },
+        { "rdi", offsetof(SafetyHookContext, rdi) }, { "rsi", offsetof(SafetyHookContext, rsi) }, { "rdx", offsetof(SafetyHookContext, rdx) },
+        { "rcx", offsetof(SafetyHookContext, rcx) }, { "rbx", offsetof(SafetyHookContext, rbx) }, { "rax", offsetof(SafetyHookContext, rax) },
+        { "rbp", offsetof(SafetyHookContext, rbp) }, { "rsp", offsetof(SafetyHookContext, rsp) },
+    };
+
+    void ReportDifferences(const Replayable& replayable, const SafetyHookContext& ctx, const std::vector<uint8_t>& memory)
+    {
+        const HookTrace::Call& call = replayable.call;
+        const SafetyHookContext& expected = call.after;
+        const SafetyHookContext& actual = ctx;
+
+        for (const auto& reg : kRegisters) {
+            uintptr_t iExpected = HookLogic::Register(expected, reg.iOffset);
+            uintptr_t iActual = HookLogic::Register(actual, reg.iOffset);
+            if (iExpected != iActual)
+                printf("    %s: expected %llx, got %llx\n", reg.sName, (unsigned long long)iExpected, (unsigned long long)iActual);
+        }
+        for (int i = 0; i < 16; i++) {
+            const auto& xmmExpected = (&expected.xmm0)[i];
+            const auto& xmmActual = (&actual.xmm0)[i];
+            if (memcmp(&xmmExpected, &xmmActual, sizeof(xmmExpected)) != 0)
+                printf("    xmm%d: expected %g, got %g (low float)\n", i, xmmExpected.f32[0], xmmActual.f32[0]);
+        }
+
+        if (!call.bCaptured)
+            return;
+        uint32_t iOffset = HookLogic::kSites[(size_t)call.eHook].window.iOffset;
+        for (size_t i = 0; i < memory.size(); i++) {
+            if (memory[i] != call.vMemoryAfter[i])
+                printf("    +%zx: expected %02X, got %02X\n", iOffset + i, call.vMemoryAfter[i], memory[i]);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <FFXVIFix_hooks.fxht> [timing passes]\n", argv[0]);
+        return 1;
+    }
+    int iPasses = argc > 2 ? atoi(argv[2]) : 100;
+    if (iPasses < 1)
+        iPasses = 1;
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    HookTrace::Reader reader;
+    if (!reader.Open(data.data(), data.size())) {
+        fprintf(stderr, "%s is not a hook trace from this version of the fix\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<HookLogic::Params> params;
+    std::vector<Replayable> calls[HookLogic::kHookCount];
+    HookTrace::RecordKind kind;
+    HookLogic::Params current{};
+    Replayable replayable;
+    while (reader.Next(kind, current, replayable.call)) {
+        if (kind == HookTrace::RecordKind::Params) {
+            params.push_back(current);
+            continue;
+        }
+        if (params.empty()) {
+            fprintf(stderr, "Call recorded before any aspect ratio, skipped\n");
+            continue;
+        }
+        replayable.iParams = params.size() - 1;
+        calls[(size_t)replayable.call.eHook].push_back(replayable);
+    }
+
+    int iResult = 0;
+    SafetyHookContext ctx;
+    std::vector<uint8_t> memory;
+    for (size_t iHook = 0; iHook < HookLogic::kHookCount; iHook++) {
+        const auto& hookCalls = calls[iHook];
+        const char* sName = HookLogic::kSites[iHook].sName;
+        if (hookCalls.empty()) {
+            printf("%s: not recorded\n", sName);
+            continue;
+        }
+
+        size_t iDifferent = 0;
+        for (size_t i = 0; i < hookCalls.size(); i++) {
+            if (HookTrace::Replay(hookCalls[i].call, params[hookCalls[i].iParams], ctx, memory))
+                continue;
+            if (iDifferent++ < kMaxReported) {
+                printf("%s: call %zu is different\n", sName, i);
+                ReportDifferences(hookCalls[i], ctx, memory);
+            }
+        }
+
+        auto tStart = std::chrono::steady_clock::now();
+        for (int iPass = 0; iPass < iPasses; iPass++) {
+            for (const auto& call : hookCalls)
+                HookTrace::Replay(call.call, params[call.iParams], ctx, memory);
+        }
+        double dNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - tStart).count();
+
+        printf("%s: %zu calls, %zu different, %.1fns per call\n", sName, hookCalls.size(), iDifferent, dNs / ((double)iPasses * hookCalls.size()));
+        if (iDifferent)
+            iResult = 2;
+    }
+    return iResult;
+}
@@ -0,0 +1,316 @@
+// sigpack - compiles a signature pack source file into the binary format read by the fix (see src/SigPack.hpp).
+//
+// Build: g++ -std=c++20 -O2 -o sigpack sigpack.cpp
+// Usage: sigpack <input.txt> <output.sigpack>
+//
+// Source format, one directive per line, '#' starts a comment:
+//   sig "<pattern>" [hook <offset>]
+//       Starts a signature. <pattern> must be the signature text used in dllmain.cpp. <offset> is where the call site
+//       hooks or patches, signature recovery checks its near matches for an instruction boundary there.
+//   alt "<pattern>" adjust <n> [hook <offset>]
+//       Alternate pattern for the current signature. The match address plus <n> must line up with where the primary
+//       signature would have matched, so the offsets used at the call site still work.
+//   hint <timestamp> <rva> [alt <index>]
+//       For the build with this ModuleTimestamp, the scan returns module base + <rva>. The bytes found there are checked
+//       against the primary pattern, or against alternate <index> (1-based) if given.
+// Numbers can be decimal or 0x prefixed hex.
+
+#include "../../src/SigPack.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+    struct SourceEntry
+    {
+        SigPack::Entry entry{};
+        std::vector<uint8_t> bytes;
+        std::vector<uint8_t> mask;
+    };
+
+    struct SourceHint
+    {
+        SigPack::Hint hint{};
+        size_t sourceIndex = 0;
+    };
+
+    // Rough order of how common bytes are in x64 code, most common first. Used to pick anchors.
+    constexpr uint8_t kCommonBytes[] = {
+        0x00, 0xFF, 0x48, 0x89, 0x8B, 0x24, 0x0F, 0x44, 0x4C, 0xE8, 0x01, 0x85, 0x74, 0x75, 0xC3, 0xCC,
+        0xC5, 0x4D, 0x41, 0x83, 0x8D, 0x10, 0x08, 0x20, 0xEB, 0x49, 0x45, 0xC7, 0x40, 0x33, 0x84, 0x80,
+    };
+
+    int ByteRank(uint8_t value)
+    {
+        for (size_t i = 0; i < std::size(kCommonBytes); i++) {
+            if (kCommonBytes[i] == value)
+                return (int)i;
+        }
+        return (int)std::size(kCommonBytes);
+    }
+
+    bool ParseNumber(const std::string& text, int64_t& value)
+    {
+        try {
+            size_t used = 0;
+            value = std::stoll(text, &used, 0);
+            return used == text.size();
+        }
+        catch (...) {
+            return false;
+        }
+    }
+
+    bool ParsePattern(const std::string& text, SourceEntry& out)
+    {
+        std::istringstream tokens(SigPack::Normalise(text));
+        std::string token;
+        while (tokens >> token) {
+            if (token == "??") {
+                out.bytes.push_back(0);
+                out.mask.push_back(0);
+                continue;
+            }
+
+            char* end = nullptr;
+            unsigned long value = strtoul(token.c_str(), &end, 16);
+            if (token.size() != 2 || *end != '\0' || value > 0xFF)
+                return false;
+
+            out.bytes.push_back((uint8_t)value);
+            out.mask.push_back(0xFF);
+        }
+
+        if (out.bytes.empty() || out.bytes.size() > 0xFFFF)
+            return false;
+
+        // The scanner searches for the anchor, so there has to be a literal byte to search for
+        bool bHaveLiteral = false;
+        for (uint8_t mask : out.mask)
+            bHaveLiteral |= mask != 0;
+        if (!bHaveLiteral)
+            return false;
+
+        // Anchor on the least common literal byte
+        int bestRank = -1;
+        for (size_t i = 0; i < out.bytes.size(); i++) {
+            if (out.mask[i] && ByteRank(out.bytes[i]) > bestRank) {
+                bestRank = ByteRank(out.bytes[i]);
+                out.entry.anchorOffset = (uint16_t)i;
+                out.entry.anchorByte = out.bytes[i];
+            }
+        }
+
+        out.entry.length = (uint16_t)out.bytes.size();
+        return true;
+    }
+
+    // Splits a line into words, keeping "quoted strings" together
+    std::vector<std::string> Tokenise(const std::string& line)
+    {
+        std::vector<std::string> tokens;
+        size_t i = 0;
+        while (i < line.size()) {
+            if (isspace((unsigned char)line[i])) {
+                i++;
+            }
+            else if (line[i] == '#') {
+                break;
+            }
+            else if (line[i] == '"') {
+                size_t end = line.find('"', i + 1);
+                if (end == std::string::npos)
+                    end = line.size();
+                tokens.push_back(line.substr(i + 1, end - i - 1));
+                i = end + 1;
+            }
+            else {
+                size_t end = i;
+                while (end < line.size() && !isspace((unsigned char)line[end]))
+                    end++;
+                tokens.push_back(line.substr(i, end - i));
+                i = end;
+            }
+        }
+        return tokens;
+    }
+
+    bool ParseOptions(const std::vector<std::string>& tokens, size_t first, SourceEntry& entry, bool bAlternate)
+    {
+        bool bHaveAdjust = !bAlternate;
+        for (size_t i = first; i < tokens.size(); i += 2) {
+            int64_t value = 0;
+            if (i + 1 >= tokens.size() || !ParseNumber(tokens[i + 1], value))
+                return false;
+
+            if (tokens[i] == "hook" && value >= 0 && value <= UINT32_MAX)
+                entry.entry.hookOffset = (uint32_t)value;
+            else if (tokens[i] == "adjust" && bAlternate && value >= INT32_MIN && value <= INT32_MAX) {
+                entry.entry.adjust = (int32_t)value;
+                bHaveAdjust = true;
+            }
+            else
+                return false;
+        }
+        return bHaveAdjust;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <input.txt> <output.sigpack>\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream input(argv[1]);
+    if (!input) {
+        fprintf(stderr, "error: could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<SourceEntry> entries;
+    std::vector<SourceHint> hints;
+    size_t currentPrimary = SIZE_MAX;
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(input, line); lineNumber++) {
+        auto tokens = Tokenise(line);
+        if (tokens.empty())
+            continue;
+
+        auto fail = [&](const char* what) {
+            fprintf(stderr, "%s:%d: error: %s\n", argv[1], lineNumber, what);
+            return 1;
+        };
+
+        if (tokens[0] == "sig" || tokens[0] == "alt") {
+            bool bAlternate = tokens[0] == "alt";
+            if (bAlternate && currentPrimary == SIZE_MAX)
+                return fail("alt without a sig");
+            if (tokens.size() < 2)
+                return fail("missing pattern");
+
+            SourceEntry entry;
+            if (!ParsePattern(tokens[1], entry))
+                return fail("invalid pattern");
+            if (!ParseOptions(tokens, 2, entry, bAlternate))
+                return fail(bAlternate ? "invalid options (alt needs adjust)" : "invalid options");
+
+            if (bAlternate) {
+                entry.entry.key = entries[currentPrimary].entry.key;
+            }
+            else {
+                entry.entry.key = SigPack::Key(tokens[1]);
+                entry.entry.flags = SigPack::Primary;
+                for (const auto& existing : entries) {
+                    if (existing.entry.key == entry.entry.key)
+                        return fail("duplicate sig");
+                }
+                currentPrimary = entries.size();
+            }
+            entries.push_back(std::move(entry));
+        }
+        else if (tokens[0] == "hint") {
+            if (currentPrimary == SIZE_MAX)
+                return fail("hint without a sig");
+
+            int64_t timestamp = 0, rva = 0, alternate = 0;
+            if (tokens.size() != 3 && tokens.size() != 5)
+                return fail("expected: hint <timestamp> <rva> [alt <index>]");
+            if (!ParseNumber(tokens[1], timestamp) || timestamp < 0 || timestamp > UINT32_MAX ||
+                !ParseNumber(tokens[2], rva) || rva < 0 || rva > UINT32_MAX)
+                return fail("invalid timestamp or rva");
+            if (tokens.size() == 5 && (tokens[3] != "alt" || !ParseNumber(tokens[4], alternate) || alternate < 1))
+                return fail("invalid alt index");
+
+            size_t sourceIndex = currentPrimary + (size_t)alternate;
+            if (sourceIndex >= entries.size() || entries[sourceIndex].entry.key != entries[currentPrimary].entry.key)
+                return fail("alt index out of range");
+
+            SourceHint hint;
+            hint.hint.key = entries[currentPrimary].entry.key;
+            hint.hint.timestamp = (uint32_t)timestamp;
+            hint.hint.rva = (uint32_t)rva;
+            hint.sourceIndex = sourceIndex;
+            hints.push_back(hint);
+        }
+        else {
+            return fail("unknown directive");
+        }
+    }
+
+    // Sort entries by key, keeping the source order (primary first) within a key
+    std::vector<size_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return entries[a].entry.key < entries[b].entry.key; });
+
+    std::vector<uint32_t> packIndex(entries.size());
+    std::vector<SigPack::Entry> packEntries;
+    std::vector<uint8_t> packBytes;
+    for (size_t i : order) {
+        SigPack::Entry entry = entries[i].entry;
+        entry.bytesOffset = (uint32_t)packBytes.size();
+        packBytes.insert(packBytes.end(), entries[i].bytes.begin(), entries[i].bytes.end());
+        packBytes.insert(packBytes.end(), entries[i].mask.begin(), entries[i].mask.end());
+        packIndex[i] = (uint32_t)packEntries.size();
+        packEntries.push_back(entry);
+    }
+
+    std::vector<SigPack::Hint> packHints;
+    for (auto& hint : hints) {
+        hint.hint.entryIndex = packIndex[hint.sourceIndex];
+        packHints.push_back(hint.hint);
+    }
+    std::sort(packHints.begin(), packHints.end(), [](const SigPack::Hint& a, const SigPack::Hint& b) {
+        return a.timestamp != b.timestamp ? a.timestamp < b.timestamp : a.key < b.key;
+        });
+    for (size_t i = 1; i < packHints.size(); i++) {
+        if (packHints[i].timestamp == packHints[i - 1].timestamp && packHints[i].key == packHints[i - 1].key) {
+            fprintf(stderr, "error: more than one hint for a sig in build %u\n", packHints[i].timestamp);
+            return 1;
+        }
+    }
+
+    SigPack::Header header{};
+    header.magic = SigPack::kMagic;
+    header.version = SigPack::kVersion;
+    header.entryCount = (uint32_t)packEntries.size();
+    header.hintCount = (uint32_t)packHints.size();
+    header.byteCount = (uint32_t)packBytes.size();
+    header.entriesOffset = sizeof(SigPack::Header);
+    header.hintsOffset = header.entriesOffset + header.entryCount * sizeof(SigPack::Entry);
+    header.bytesOffset = header.hintsOffset + header.hintCount * sizeof(SigPack::Hint);
+
+    std::ofstream output(argv[2], std::ios::binary | std::ios::trunc);
+    if (!output) {
+        fprintf(stderr, "error: could not open %s\n", argv[2]);
+        return 1;
+    }
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(packEntries.data()), packEntries.size() * sizeof(SigPack::Entry));
+    output.write(reinterpret_cast<const char*>(packHints.data()), packHints.size() * sizeof(SigPack::Hint));
+    output.write(reinterpret_cast<const char*>(packBytes.data()), packBytes.size());
+    output.close();
+    if (!output) {
+        fprintf(stderr, "error: failed writing %s\n", argv[2]);
+        return 1;
+    }
+
+    // Read it back the same way the fix does
+    std::ifstream check(argv[2], std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(check)), std::istreambuf_iterator<char>());
+    SigPack::View view;
+    if (!view.Open(data.data(), data.size())) {
+        fprintf(stderr, "error: written pack failed validation\n");
+        return 1;
+    }
+
+    printf("%s: %u entries, %u hints, %u pattern bytes\n", argv[2], header.entryCount, header.hintCount, header.byteCount / 2);
+    return 0;
+}
@@ -0,0 +1,121 @@
+// sigrecover - looks for near matches of a signature in a game exe, for fixing signatures broken by a game update
+// (see src/FuzzyScan.hpp). The same search runs in the fix when [Signature Recovery] is enabled.
+//
+// Build: gcc -O2 -c ../../external/safetyhook/Zydis.c && g++ -std=c++20 -O2 -o sigrecover sigrecover.cpp Zydis.o
+// Usage: sigrecover <ffxvi.exe> "<pattern>" [hook offset] [max mismatches] [time budget ms]
+//
+// Prints the candidates best first, as RVAs (what the fix logs as "ffxvi.exe+<rva>"), with the bytes found there and
+// which of them differ from the signature.
+
+#include "../../src/FuzzyScan.hpp"
+#include "../../src/PEImage.hpp"
+#include "../../external/safetyhook/Zydis.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+    size_t InstructionLength(const uint8_t* address, size_t size)
+    {
+        static const ZydisDecoder decoder = [] {
+            ZydisDecoder decoder;
+            ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+            return decoder;
+        }();
+
+        ZydisDecodedInstruction instruction;
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&decoder, nullptr, address, size, &instruction)))
+            return 0;
+        return instruction.length;
+    }
+
+    // Raw data of a section in the file, which is what gets scanned. Offsets are turned back into RVAs for output.
+    struct FileSection
+    {
+        const PE::Section* section;
+        size_t iSize;
+    };
+
+    size_t ParseNumber(const char* text)
+    {
+        return (size_t)strtoull(text, nullptr, 0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <ffxvi.exe> \"<pattern>\" [hook offset] [max mismatches] [time budget ms]\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    PE::Image image;
+    if (!PE::Parse(data.data(), data.size(), image)) {
+        fprintf(stderr, "%s is not a PE32+ image\n", argv[1]);
+        return 1;
+    }
+
+    Pattern::Signature signature = Pattern::Parse(argv[2]);
+    size_t iHookOffset = argc > 3 ? ParseNumber(argv[3]) : 0;
+
+    Fuzzy::Options options;
+    if (argc > 4)
+        options.iMaxMismatches = ParseNumber(argv[4]);
+    if (argc > 5)
+        options.dBudgetMs = (double)ParseNumber(argv[5]);
+    options.iMaxCandidates = 16;
+
+    // Candidates are tracked by file offset, sections are mapped back to RVAs when printing
+    std::vector<FileSection> sections;
+    Fuzzy::Search search(signature, options);
+    for (const auto& section : image.vSections) {
+        if (!section.IsCode() || section.iRawOffset >= data.size())
+            continue;
+        size_t iSize = std::min<size_t>({ section.iRawSize, section.iVirtualSize, data.size() - section.iRawOffset });
+        sections.push_back({ &section, iSize });
+        if (!search.Scan(data.data() + section.iRawOffset, iSize, section.iRawOffset))
+            break;
+    }
+
+    size_t iWalk = std::max(signature.Size(), iHookOffset + 1) + ZYDIS_MAX_INSTRUCTION_LENGTH;
+    auto candidates = search.Rank([&](size_t iOffset) {
+        return iOffset + iWalk <= data.size() && Fuzzy::LandsOnBoundary(data.data() + iOffset, iWalk, iHookOffset, InstructionLength);
+    });
+
+    printf("Timestamp %08X, up to %zu of %zu literal bytes different, %.0fms%s\n", image.iTimestamp, search.MaxMismatches(), search.Literals(),
+        search.ElapsedMs(), search.TimedOut() ? " (out of time)" : "");
+    if (candidates.empty()) {
+        printf("No candidates.\n");
+        return 2;
+    }
+
+    for (const auto& candidate : candidates) {
+        uint32_t iRva = 0;
+        for (const auto& mapped : sections) {
+            if (candidate.iOffset >= mapped.section->iRawOffset && candidate.iOffset < mapped.section->iRawOffset + mapped.iSize)
+                iRva = mapped.section->iVirtualAddress + (uint32_t)(candidate.iOffset - mapped.section->iRawOffset);
+        }
+
+        printf("\n+%x: %zu different, hook offset +%zx %s an instruction, confidence %.2f\n  ", iRva, candidate.iMismatches, iHookOffset,
+            candidate.bBoundary ? "starts" : "does not start", candidate.dConfidence);
+        for (size_t i = 0; i < signature.Size(); i++) {
+            uint8_t iByte = data[candidate.iOffset + i];
+            bool bDiffers = signature.IsLiteral(i) && iByte != signature.bytes[i];
+            printf(bDiffers ? "[%02X] " : "%02X ", iByte);
+        }
+        printf("\n");
+    }
+    return 0;
+}